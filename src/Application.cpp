@@ -1,11 +1,18 @@
 #include "Application.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 //////////////////////////////////////////////////////////////////////////////////
 static GLApplication* __glApp = NULL; // TODO - redo to remove this instance
 static void processKeyEvent(GLFWwindow* window, int key, int scan, int action, int mods);
+static void processResizeEvent(GLFWwindow* window, int width, int height);
+static void processRefreshEvent(GLFWwindow* window);
 //////////////////////////////////////////////////////////////////////////////////
 
-GLApplication::GLApplication(const string& appName, size_t topLeftX, size_t topLeftY, size_t width, size_t height)
+GLApplication::GLApplication(const string& appName, size_t topLeftX, size_t topLeftY, size_t width, size_t height, bool headless)
 {
 	_appName = appName.empty() ? "GLApplication" : appName;
 	_width = width < 256 ? 256 : width > 2048 ? 2048 : width;
@@ -20,7 +27,43 @@ GLApplication::GLApplication(const string& appName, size_t topLeftX, size_t topL
 	_rotationAngle = 90.0f;
 	_basicShader = NULL;
 	_fullMapGeometry = NULL;
+	_fullMapTexture = 0;
 	_cameraGeometry = NULL;
+	_cameraIconTexture = 0;
+	_tileArrayShader = NULL;
+	_virtualTextureShader = NULL;
+	_feedbackStale = true;
+	_fadeStarted = false;
+	_currentScene = 0;
+	_renderTileBoundaries = false;
+	_imageSource = NULL;
+	_fullMapBuffer = NULL;
+	_tileCache = NULL;
+	_headless = headless;
+	_offscreenFramebuffer = _offscreenColor = _offscreenDepth = 0;
+	_cancelSceneBuild = false;
+	_sceneBuildFinished = false;
+	_eagerBuild = false;
+	_sceneLoaded = false;
+	_sceneLoadSucceeded = false;
+	_loadedImageSource = NULL;
+	_loadedFullMapBuffer = NULL;
+	_loadedTileCache = NULL;
+	_viewChanged = true;
+	_redrawNeeded = true;
+	_exportPending = false;
+	_exportRunning = false;
+	_overviewFramebuffer = _overviewColor = 0;
+	_overviewMapWidth = _overviewMapHeight = 0;
+	_overviewMapAngle = 0.0f;
+	_overviewMapDirty = true;
+	_overviewPending = false;
+	_cameraJumps = 0;
+
+	_qualityController.initialize(_renderSettings.targetFrameMs, _renderSettings.qualityHysteresis);
+
+	_cameraController.initialize(_configuration.getCameraInitialPos(), _configuration.getCameraInitialDir(), _projectionOrtho,
+								 _configuration.getKeyPressIncrement(), _configuration.getRotationAngleIncrement());
 
 	_xAxis = glm::vec3(1, 0, 0);
 	_yAxis = glm::vec3(0, 1, 0);
@@ -30,26 +73,8 @@ GLApplication::GLApplication(const string& appName, size_t topLeftX, size_t topL
 	_toEnu = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), _xAxis); 
 	//
 
-	if (!glfwInit())
-    {
-        cout << __FUNCTION__ << "Error, Init GLFW failed" << endl;
-        
-		exit(EXIT_FAILURE);
-    }
-
-	glfwWindowHint(GLFW_DEPTH_BITS,  32);
-
-    _glWindow = glfwCreateWindow((int)_width, (int)_height, _appName.c_str(), NULL, NULL);
-    if (!_glWindow)
-    {
-        cout << "Error, GLFW window creation failed" << endl;
-        glfwTerminate();
-        
+	if (!createContext(headless))
 		exit(EXIT_FAILURE);
-    }
-
-    glfwMakeContextCurrent(_glWindow); // make this context current
-    glfwSwapInterval(1);
 
 	/// init gl extensions using extension wrangler - it will to access 3.0 or later gl fuctionalities
 	{
@@ -66,16 +91,17 @@ GLApplication::GLApplication(const string& appName, size_t topLeftX, size_t topL
 	}
 	//
 
-	glfwSetWindowPos(_glWindow, (int)topLeftX, (int)topLeftY); // place the window starting here
+	if (_headless)
+		createOffscreenFramebuffer();
+	else
+		glfwSetWindowPos(_glWindow, (int)topLeftX, (int)topLeftY); // place the window starting here
 	
 	/// setup call backs - TODO: redo using std::function() or something...
 	{
 		glfwSetKeyCallback(_glWindow, processKeyEvent);
 
-		// glfwSetFramebufferSizeCallback(_glWindow, reshape); // not needed for now
-		// int w, h;
-		// glfwGetFramebufferSize(_glWindow, &w, &h);
-		// reshape(_glWindow, w, h);
+		glfwSetFramebufferSizeCallback(_glWindow, processResizeEvent);
+		glfwSetWindowRefreshCallback(_glWindow, processRefreshEvent);
 	}
 	///
 
@@ -106,14 +132,138 @@ GLApplication::GLApplication(const string& appName, size_t topLeftX, size_t topL
 
 GLApplication::~GLApplication()
 {
+	_cameraController.stop();
+
+	/// a swap still loading: wait for its source, it is dropped with the scene
+	if (_sceneLoadThread.joinable())
+	{
+		_sceneLoadThread.join();
+
+		delete _loadedImageSource;
+		delete _loadedFullMapBuffer;
+		delete _loadedTileCache;
+	}
+	///
+
 	release();
+	releasePersistentObjects();
+
+	_tileTextureStore.release(); // the pages and the upload ring outlive release(), but not the gl context
+	_tileStreamer.release();
+
+	releaseOffscreenFramebuffer();
+
+	_profiler.release();
 
 	glfwTerminate();
 
+	AsyncLogger::getInstance().flush();
+
 	cout << __FUNCTION__ << " application ended." << endl;
 	cout << "Thank you" << endl;
 }
 
+/// glfw window and gl context
+///		- headless: glfw's null platform (no display), the context from egl, or osmesa when there
+///		  is no egl; both run on llvmpipe without a gpu
+///
+bool GLApplication::createContext(bool headless)
+{
+	if (headless)
+	{
+#ifdef GLFW_PLATFORM_NULL
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+	}
+
+	if (!glfwInit())
+    {
+        cout << __FUNCTION__ << "Error, Init GLFW failed" << endl;
+		return false;
+    }
+
+	glfwWindowHint(GLFW_DEPTH_BITS,  32);
+
+	if (headless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	}
+
+    _glWindow = glfwCreateWindow((int)_width, (int)_height, _appName.c_str(), NULL, NULL);
+
+	if (!_glWindow && headless)
+	{
+		cout << __FUNCTION__ << " no egl context, trying osmesa" << endl;
+
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+
+		_glWindow = glfwCreateWindow((int)_width, (int)_height, _appName.c_str(), NULL, NULL);
+	}
+
+    if (!_glWindow)
+    {
+        cout << "Error, GLFW window creation failed" << endl;
+        glfwTerminate();
+
+		return false;
+    }
+
+    glfwMakeContextCurrent(_glWindow); // make this context current
+    glfwSwapInterval(headless ? 0 : 1); // a benchmark must not wait for vsync
+
+	return true;
+}
+
+/// headless render target, in place of the window's framebuffer 0; the overview map, the virtual
+/// texture feedback and exportView() bind their own targets, renderPass() binds
+/// _offscreenFramebuffer again every frame
+///
+void GLApplication::createOffscreenFramebuffer()
+{
+	glGenRenderbuffers(1, &_offscreenColor);
+	glBindRenderbuffer(GL_RENDERBUFFER, _offscreenColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, (GLsizei)_width, (GLsizei)_height);
+
+	glGenRenderbuffers(1, &_offscreenDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, _offscreenDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, (GLsizei)_width, (GLsizei)_height);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	MemoryTracker::getInstance().allocate(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, _offscreenColor), _width * _height * 4);
+	MemoryTracker::getInstance().allocate(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, _offscreenDepth), _width * _height * 4);
+
+	glGenFramebuffers(1, &_offscreenFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, _offscreenFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _offscreenColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _offscreenDepth);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cout << __FUNCTION__ << "Error, offscreen framebuffer incomplete" << endl;
+
+	cout << __FUNCTION__ << " headless, rendering to a " << _width << " x " << _height << " offscreen framebuffer" << endl;
+
+	logGLError(__FUNCTION__);
+}
+
+void GLApplication::releaseOffscreenFramebuffer()
+{
+	if (_offscreenFramebuffer == 0)
+		return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	MemoryTracker::getInstance().releaseOwner(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, _offscreenColor));
+	MemoryTracker::getInstance().releaseOwner(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, _offscreenDepth));
+
+	glDeleteFramebuffers(1, &_offscreenFramebuffer);
+	glDeleteRenderbuffers(1, &_offscreenColor);
+	glDeleteRenderbuffers(1, &_offscreenDepth);
+
+	_offscreenFramebuffer = _offscreenColor = _offscreenDepth = 0;
+}
+
 void GLApplication::printVersionHistory()
 {
 	_version = "GLApplication ver: 1.0 by M Pai (c) M Pai 06/18/2017 mpai@hotmail.com";
@@ -134,8 +284,15 @@ void GLApplication::getWindowSize(size_t& width, size_t& height)
 
 void GLApplication::switchTileBoundariesRendering()
 {
-	for (TileGeometry* tile : _tileGeometryObjects)
-		tile->switchTileBoundariesRendering();
+	_renderTileBoundaries = !_renderTileBoundaries;
+}
+
+void GLApplication::setRenderSettings(const RenderSettings& renderSettings)
+{
+	_renderSettings = renderSettings;
+
+	_qualityController.initialize(_renderSettings.targetFrameMs, _renderSettings.qualityHysteresis);
+	requestRedraw();
 }
 
  
@@ -166,349 +323,1943 @@ void GLApplication::initStates()
 	logGLError(__FUNCTION__);
 }
 
-void GLApplication::release()
+void GLApplication::stopSceneBuild()
 {
-	for (TileGeometry* tile : _tileGeometryObjects)
-		delete tile;
+	_cancelSceneBuild = true;
+	_tileStreamer.cancel(); // unblocks the build thread if it waits for queue space
 
-	_tileGeometryObjects.clear();
+	if (_sceneBuildThread.joinable())
+		_sceneBuildThread.join();
 
-	if (_fullMapGeometry)
-		delete _fullMapGeometry;
+	_jobSystem.wait(_tileLoads); // reloads fail their push() quickly once cancelled
 
-	_fullMapGeometry = NULL;
+	releaseFailedLoads(); // and the tiles dropped from the queue with cancel() go with the scene
 
-	if (_cameraGeometry != NULL)
-		delete _cameraGeometry;
+	_tileStreamer.reset();
+	_cancelSceneBuild = false;
+	_eagerBuild = false;
 
-	if (_basicShader)
-		delete _basicShader;
+	{
+		lock_guard<mutex> guard(_overviewLock);
 
-	_cameraGeometry = NULL;
-	_basicShader = NULL;
+		_overviewPixels.clear();
+		_overviewPending = false;
+	}
 }
 
-void GLApplication::buildScene(const string& imageFilename)
+void GLApplication::release()
 {
-	glfwHideWindow(_glWindow); // hide the window, until the scene is built
-
-	release(); // to delete old geometry, if any
+	stopSceneBuild();
 
-	ImageBuffer* fullMapBuffer = ImageFactory::getImage(imageFilename);
+	if (_imageSource)
+		delete _imageSource;
 
-	if (fullMapBuffer == NULL || fullMapBuffer->getBuffer() == NULL)
+	if (_fullMapBuffer)
 	{
-		cout << __FUNCTION__ << "Error, input image file " << imageFilename << " not read properly" << endl;
-		return;
+		MemoryTracker::getInstance().releaseOwner(MEMORY_SOURCE_IMAGE, (uint64_t)(uintptr_t)_fullMapBuffer);
+		delete _fullMapBuffer;
 	}
 
-	size_t	texWidth, texHeight;
-	float	pixelSize = _configuration.getPixelSize();
-
-	fullMapBuffer->getBufferDimension(texWidth, texHeight);
-
-	float fullTileWidth  = (float)texWidth * pixelSize;
-	float fullTileHeight = (float)texHeight * pixelSize;
-
-	glm::vec3   fullTileDimension(fullTileWidth, fullTileHeight, 0.0f);
-	
-	glm::vec3	fullTileLL(0.0f, 0.0f, 0.0f);
-	glm::vec3	fullTileUR = fullTileLL + fullTileDimension;  
-
-	_fullMapGeometry = new TileGeometry(fullTileLL, fullTileUR, fullMapBuffer->generateTextureId());
-
-	float tileTexSize = (float) _configuration.getTileTexSize();
-
-	float tilesX = fullTileWidth  / (tileTexSize * pixelSize);
-	float tilesY = fullTileHeight / (tileTexSize * pixelSize);
-
-	float tileWidth  = fullTileWidth / tilesX;
-	float tileHeight = fullTileWidth / tilesY;
+	if (_tileCache)
+		delete _tileCache;
 
-	glm::vec3 tileDimension = glm::vec3(tileWidth, tileHeight, 0.0f);
+	_imageSource = NULL;
+	_fullMapBuffer = NULL;
+	_tileCache = NULL;
 
-	// construct row x col tiles bottom up
-	//
-	for (size_t row = 0; row < tilesY; row++)
-	{	
-		for (size_t col = 0; col < tilesX; col++)
-		{
-			///
-			size_t rowPixelIndex = row * (size_t) tileTexSize;
-			size_t colPixelIndex = col * (size_t) tileTexSize;
-				
-			GLuint subTexId = fullMapBuffer->getTile(rowPixelIndex, colPixelIndex, (size_t) tileTexSize, (size_t) tileTexSize);
-			///
+	_tileTable.reset(); // the arena is kept for the next scene
 
-			///
-			glm::vec3 ll = glm::vec3(row * tileWidth, col * tileHeight, 0.0f); // REDO: enu coord system
-			glm::vec3 ur = ll + tileDimension;
+	/// hand the layers back to the store, its pages are reused by the next scene
+	for (size_t tile = 0; tile < _tileBatchRenderer.getTileCount(); tile++)
+		_tileTextureStore.releaseLayer(_tileBatchRenderer.getTileSlot(tile));
+	///
 
-			TileGeometry* tileGeometry = new TileGeometry(ll, ur, subTexId);
-			///
+	_tilePyramid.release();
+	_tileBatchRenderer.reset(); // its buffers are respecified by the next scene
+	_visibleTiles.clear();
+	_missingTiles.clear();
+	_prefetchTiles.clear();
+	_prefetchMissing.clear();
+	_motionPredictor.reset();
+	_tileResidency.release();
+	_virtualTexture.release();
+	_feedbackTiles.clear();
 
-			if (tileGeometry != NULL)
-				_tileGeometryObjects.push_back(tileGeometry);
+	if (_fullMapGeometry)
+		delete _fullMapGeometry;
 
-			if (_tileGeometryObjects.size() % 25 == 0)
-				cout << __FUNCTION__ << " Constructed: " << _tileGeometryObjects.size() << " tiles..." << endl;
-		}
-	}
+	MemoryTracker::getInstance().releaseOwner(MEMORY_OVERVIEW, MemoryTracker::getGLOwner(GL_TEXTURE, _fullMapTexture));
 
-	cout << __FUNCTION__ << " Final tile count: " << _tileGeometryObjects.size() << endl;
+	_fullMapGeometry = NULL;
+	_fullMapTexture = 0;
+	_overviewMapDirty = true; // the framebuffer is kept, but not shown until the new overview is there
+}
 
-	/// build camara icon geometry
+/// the gl objects that do not depend on the scene: shaders and the camera icon, created by
+/// the first buildScene() and kept until the application ends
+///
+void GLApplication::createPersistentObjects()
+{
+	if (_cameraGeometry == NULL)
 	{
+		/// build camara icon geometry
 		glm::vec3 black(32, 32, 32);
 
 		ImageBuffer* flatImageBlack = ImageFactory::getFlatColorImage(black, 32, 32);
 
-		_cameraGeometry = new CameraGeometry(flatImageBlack->generateTextureId(), 24.0f);
+		_cameraIconTexture = flatImageBlack->generateTextureId();
+		_cameraGeometry = new CameraGeometry(_cameraIconTexture, 24.0f);
 
 		delete flatImageBlack;
+
+		MemoryTracker::getInstance().allocate(MEMORY_CAMERA_ICON, MemoryTracker::getGLOwner(GL_TEXTURE, _cameraIconTexture), 32 * 32 * 3);
 	
 		cout << __FUNCTION__ << " built the camara icon geometry " << endl;
+		///
 	}
-	///
 
-	_basicShader = new BasicShader();
+	if (_basicShader == NULL)
+	{
+		_basicShader = new BasicShader();
+		_tileArrayShader = new TileArrayShader();
 
-	cout << __FUNCTION__ << " built the shader " << endl;
+		cout << __FUNCTION__ << " built the shader " << endl;
+	}
 
-	delete fullMapBuffer; // no longer needed so release it
+	if (_renderSettings.virtualTexturing && _virtualTextureShader == NULL)
+		_virtualTextureShader = new VirtualTextureShader();
+}
 
-	/// all set, set background color to be black
-	_readyToRun = true;
-	glClearColor(0.0f, 0.0f, 0.0f, 0.0f); 
-	///
+void GLApplication::releasePersistentObjects()
+{
+	releaseFadingTiles();
+	_fadingBatchRenderer.release();
+
+	releaseOverviewMap();
+
+	if (_cameraGeometry != NULL)
+	{
+		MemoryTracker::getInstance().releaseOwner(MEMORY_CAMERA_ICON, MemoryTracker::getGLOwner(GL_TEXTURE, _cameraIconTexture));
+		delete _cameraGeometry;
+	}
+
+	if (_basicShader)
+		delete _basicShader;
+
+	if (_tileArrayShader)
+		delete _tileArrayShader;
 
-	glfwShowWindow(_glWindow); // unhide the window, now that the scene is built
+	if (_virtualTextureShader)
+		delete _virtualTextureShader;
+
+	_cameraGeometry = NULL;
+	_cameraIconTexture = 0;
+	_basicShader = NULL;
+	_tileArrayShader = NULL;
+	_virtualTextureShader = NULL;
 }
 
-void
-GLApplication::updatePass()
+/// small gl texture for the overview map
+///		- the width x height lower left part of a tileSize x tileSize rgb tile, box filtered down 
+///		  by a whole factor until it fits maxSize; it is only drawn into the hud sized overview
+///		  cache, more texels would stay resident for nothing
+///
+GLuint GLApplication::createOverviewTexture(const vector<unsigned char>& tilePixels, size_t tileSize, size_t width, size_t height, size_t maxSize)
 {
-	static glm::mat4	identity(1.0f);
-	int					winWidth, winHeight;
+	size_t factor = 1;
 
-	/// take care of viewport first
-	glfwGetFramebufferSize(_glWindow, &winWidth, &winHeight);
-	
-	_width  = (size_t)winWidth;
-	_height = (size_t)winHeight;
+	while (maxSize > 0 && ((width + factor - 1) / factor > maxSize || (height + factor - 1) / factor > maxSize))
+		factor++;
 
-	glViewport(0, 0, (GLsizei)_width, (GLsizei)_height);
-	///
+	size_t sourceWidth = width, sourceHeight = height;
 
-	/// begin - compute model, view and projection matrices next
-	///
-	if (_projectionOrtho == true)
-	{
-		float mapSize = _configuration.getMapSize();
-		float mapSizeB2 = mapSize / 2.0f;
-	
-		_projection = glm::ortho(0.0f, mapSize, 0.0f, mapSize, -mapSize, mapSize);
+	width  = (sourceWidth  + factor - 1) / factor;
+	height = (sourceHeight + factor - 1) / factor;
 
-		glm::mat4 transMinus = glm::translate(identity, glm::vec3(-mapSizeB2, -mapSizeB2, 0));
-		glm::mat4 rotate     = glm::rotate(identity, glm::radians(_rotationAngle), _zAxis);
-		glm::mat4 transPlus  = glm::translate(identity, glm::vec3(mapSizeB2, mapSizeB2, 0));
+	vector<unsigned char> pixels(width * height * 3);
 
-		_view =  transPlus * rotate * transMinus;
-		_model = identity;
-	}
-	else
+	for (size_t y = 0; y < height; y++)
 	{
-		GLfloat aspect = (GLfloat) winHeight / (GLfloat) winWidth;
+		size_t y0 = y * factor, y1 = min(y0 + factor, sourceHeight);
 
-		_projection = glm::perspective(_configuration.getFOV(), aspect, _configuration.getNear(), _configuration.getFar());
+		for (size_t x = 0; x < width; x++)
+		{
+			size_t x0 = x * factor, x1 = min(x0 + factor, sourceWidth);
+			size_t sum[3] = { 0, 0, 0 };
 
-		/// begin - calculation are in enu from now on
-		///
-		glm::vec3 cameraDir = glm::normalize(glm::vec3(_cameraDir.x, 0.0, _cameraDir.z));
+			for (size_t sy = y0; sy < y1; sy++)
+			{
+				const unsigned char* source = &tilePixels[(sy * tileSize + x0) * 3];
 
-		glm::vec3 cameraPos = glm::vec3(_cameraPos.x, -_cameraPos.z, _cameraPos.y); // in enu
-		
-		_view = glm::lookAt(cameraPos, cameraPos - cameraDir, _yAxis);
+				for (size_t sx = x0; sx < x1; sx++, source += 3)
+				{
+					sum[0] += source[0];
+					sum[1] += source[1];
+					sum[2] += source[2];
+				}
+			}
 
-		_model = _toEnu; // this will render all 3d geometry models in enu coord sys
-		///
-		/// end - calculation are in enu from now on
+			size_t count = (y1 - y0) * (x1 - x0);
 
-		_cameraGeometry->setLocationDirection(_cameraPos, _cameraDir); // 
+			for (size_t c = 0; c < 3; c++)
+				pixels[(y * width + x) * 3 + c] = (unsigned char)((sum[c] + count / 2) / count);
+		}
 	}
-	/// end - compute model, view and projection matrices next
-}
 
-void
-GLApplication::cullPass()
-{
-	// TODO: implement culling to buy performance
-	
-	// emtpy for now
-
-	//	logGLError(__FUNCTION__);
-}
-
-void
-GLApplication::preRenderPass()
-{
-	// TODO: implement pre render - as in multi target rendering etc
-	
-	// empty for now
+	GLuint texId = 0;
 
-	// logGLError(__FUNCTION__);
-}
+	glGenTextures(1, &texId);
+	glBindTexture(GL_TEXTURE_2D, texId);
 
-void
-GLApplication::renderPass()
-{
-	/// must clear color and depth buffer
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	///
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, (GLsizei)width, (GLsizei)height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
 
-	/// begin - render all small tiles
-	glm::mat4 modelView = _view * _model;
+	MemoryTracker::getInstance().allocate(MEMORY_OVERVIEW, MemoryTracker::getGLOwner(GL_TEXTURE, texId), pixels.size());
 
-	/// update the shader uniforms
-	_basicShader->enable();
-	_basicShader->setProjectionMatrix(_projection);
-	_basicShader->setModelViewMatrix(modelView);
-	///
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	for (TileGeometry* tile : _tileGeometryObjects)
-		tile->render();
-	
-	_basicShader->disable();
-	/// end - render all small tiles
+	glBindTexture(GL_TEXTURE_2D, 0);
 
 	logGLError(__FUNCTION__);
+
+	return texId;
 }
 
-void
-GLApplication::postRenderPass()
+void GLApplication::buildScene(const string& imageFilename)
 {
-	// render camera icon geomentry
-	// render large preview map tile geomentry near lower left
-
-	static glm::mat4 identity = glm::mat4(1.0f);
-
-	bool enableHUD = true; // still a wip
+	release(); // to delete old geometry, if any
 
-	if (_projectionOrtho)
-	{
-		// float aspect = (float)_width / (float) _height;
+	MemoryTracker::getInstance().resetPeaks(); // the peak of this build from here on
 
-		glm::vec3 cameraPos = glm::vec3(_width / 2.0f, _height / 5.0f, _configuration.getCameraInitialPos().z);
+	openSceneSource(imageFilename, _imageSource, _fullMapBuffer, _tileCache);
 
-		_cameraGeometry->setLocationDirection(cameraPos, _cameraDir);
+	setupScene(imageFilename);
+}
 
-		float mapSize = _configuration.getMapSize();
+/// the pixels of a scene, no gl: a current tile cache replaces the image; else the image file
+/// is mapped when its layout is known, otherwise all of it is decoded; a mosaic manifest reads
+/// the image headers only
+///		- false, and all three NULL, when there is nothing to show
+///
+bool GLApplication::openSceneSource(const string& imageFilename, ImageSource*& imageSource, ImageBuffer*& fullMapBuffer, TileCache*& tileCache)
+{
+	imageSource = NULL;
+	fullMapBuffer = NULL;
+	tileCache = openTileCache(imageFilename);
 
-		_projection = glm::ortho(0.0f, mapSize, 0.0f, mapSize, -mapSize, mapSize);
+	if (tileCache)
+		return true;
 
-		glm::mat4 modelRotate = glm::rotate(identity, glm::radians(_rotationAngle), _zAxis);
+	imageSource = MosaicImageSource::isManifest(imageFilename) ? (ImageSource*)MosaicImageSource::open(imageFilename) 
+															   : (ImageSource*)MappedImageSource::open(imageFilename);
 
-		glm::mat4 modelView = glm::translate(identity, cameraPos) * modelRotate;
+	if (imageSource)
+		return true;
 
-		_basicShader->enable();
-		_basicShader->setProjectionMatrix(_projection);
-		_basicShader->setModelViewMatrix(modelView);
-		_cameraGeometry->render();
-		_basicShader->disable();
+	if (MosaicImageSource::isManifest(imageFilename))
+		return false; // nothing to decode, the reason is out already
 
-		logGLError(__FUNCTION__);
-	}
+	fullMapBuffer = ImageFactory::getImage(imageFilename);
 
-	if (enableHUD)
+	if (fullMapBuffer == NULL || fullMapBuffer->getBuffer() == NULL)
 	{
-		// WIP, not ready
-		// TODO: re-implement HUD to enable preview
-		// for debugging also
-
-		GLsizei previewWidth =  (GLsizei) _width  / 8;
-		GLsizei previewHeight = (GLsizei) _height / 8;
+		cout << __FUNCTION__ << "Error, input image file " << imageFilename << " not read properly" << endl;
 
-		float mapSize = _configuration.getMapSize();
-		float mapSizeB2 = mapSize / 2.0f;
-	
-		_projection = glm::ortho(0.0f, mapSize, 0.0f, mapSize, -mapSize, mapSize);
+		delete fullMapBuffer;
+		fullMapBuffer = NULL;
 
-		glm::mat4 transMinus = glm::translate(identity, glm::vec3(-mapSizeB2, -mapSizeB2, 0));
-		glm::mat4 rotate     = glm::rotate(identity, glm::radians(_rotationAngle), _zAxis);
-		glm::mat4 transPlus  = glm::translate(identity, glm::vec3(mapSizeB2, mapSizeB2, 0));
+		return false;
+	}
 
-		_model = identity;
-		_view =  transPlus * rotate * transMinus;
+	imageSource = new MemoryImageSource(fullMapBuffer);
 
-		glm::mat4 modelView = _view * _model;
+	size_t imageWidth, imageHeight;
 
-		glDisable(GL_DEPTH_TEST);
+	fullMapBuffer->getBufferDimension(imageWidth, imageHeight);
 
-		glViewport((GLsizei)_width - previewWidth, (GLsizei)0, (GLsizei)previewWidth, (GLsizei)previewHeight);
+	MemoryTracker::getInstance().allocate(MEMORY_SOURCE_IMAGE, (uint64_t)(uintptr_t)fullMapBuffer, imageWidth * imageHeight * 3);
 
-		_basicShader->enable();
-		_basicShader->setProjectionMatrix(_projection);
-		_basicShader->setModelViewMatrix(modelView);
-		_fullMapGeometry->render();
-		_basicShader->disable();
-			
-		glEnable(GL_DEPTH_TEST);
-	
-		logGLError(__FUNCTION__);
-	}
+	return true;
+}
+
+/// the gl side of a scene on the opened source: pyramid, tile table and quads, texture store,
+/// residency, then the build thread (or the pinned loads) for the pixels
+///
+void GLApplication::setupScene(const string& imageFilename)
+{
+	if (_tileCache == NULL && _imageSource == NULL)
+		return;
+
+	size_t	texWidth, texHeight;
+	float	pixelSize = _configuration.getPixelSize();
+
+	if (_tileCache)
+	{
+		texWidth = _tileCache->getHeader().imageWidth;
+		texHeight = _tileCache->getHeader().imageHeight;
+	}
+	else
+		_imageSource->getDimension(texWidth, texHeight);
+
+	float fullTileWidth  = (float)texWidth * pixelSize;
+	float fullTileHeight = (float)texHeight * pixelSize;
+
+	float tileTexSize = (float) _configuration.getTileTexSize();
+
+	float tilesX = fullTileWidth  / (tileTexSize * pixelSize);
+	float tilesY = fullTileHeight / (tileTexSize * pixelSize);
+
+	float tileWidth  = fullTileWidth / tilesX;
+	float tileHeight = fullTileWidth / tilesY;
+
+	glm::vec3 tileDimension = glm::vec3(tileWidth, tileHeight, 0.0f);
+
+	/// tile textures go to texture array layers, block compressed if possible, streamed in through the upload ring;
+	/// the cached tiles are uploaded as they are, the store takes their format
+	TileCompression	compression = _tileCache ? _tileCache->getCompression() : getTileCompression();
+
+	/// virtual texturing: one page of vtPhysicalPages layers is all the texture memory there is
+	size_t layersPerPage = _renderSettings.virtualTexturing ? _renderSettings.vtPhysicalPages : 256;
+
+	if (!_tileTextureStore.keepsLayout((size_t) tileTexSize, compression))
+		releaseFadingTiles(); // their layers go with the pages
+
+	_tileTextureStore.initialize((size_t) tileTexSize, compression, layersPerPage);
+	_tileTextureStore.setMaxPages(_renderSettings.virtualTexturing ? 1 : 0); // render() of the virtual texture binds page 0 only
+
+	size_t tileBytes = _tileTextureStore.getLayerBytes();
+	size_t ringSlots = 3 * _renderSettings.uploadBytesPerFrame / tileBytes; // about three frames in flight
+
+	_tileStreamer.initialize(tileBytes, ringSlots < 4 ? 4 : ringSlots, _renderSettings.maxQueuedTileUploads);
+	///
+
+	/// construct the tile pyramid, row x col full resolution tiles at level 0; no pixels yet
+	size_t baseRows, baseCols;
+
+	TilePyramid::getBaseGrid(texWidth, texHeight, (size_t) tileTexSize, baseRows, baseCols);
+
+	_tilePyramid.build(baseRows, baseCols, tileDimension, pixelSize, (size_t) tileTexSize);
+
+	_tileTable.reserve(_tilePyramid.getNodeCount());
+
+	for (size_t node = 0; node < _tilePyramid.getNodeCount(); node++)
+	{
+		const TilePyramidNode& tileNode = _tilePyramid.getNode(node);
+
+		_tileBatchRenderer.addTile(tileNode.ll, tileNode.ur, TileTextureSlot(), tileNode.texCoordScale);
+
+		bool partial = tileNode.texCoordScale.x < 1.0f || tileNode.texCoordScale.y < 1.0f;
+
+		_tileTable.add(tileNode.ll, tileNode.ur, tileNode.level, 
+			(unsigned char)((tileNode.level == 0 ? TILE_FLAG_BASE : 0) | (partial ? TILE_FLAG_PARTIAL : 0)));
+	}
+
+	cout << __FUNCTION__ << " Final tile count: " << baseRows * baseCols << " full resolution, " 
+		 << _tilePyramid.getNodeCount() << " in all levels" << endl;
+
+	_tileBatchRenderer.build();
+
+	trackSceneTables();
+	///
+
+	/// residency: the coarsest levels are pinned, they are the fallback while tiles reload
+	size_t maxInFlight = min(_renderSettings.maxTileLoadsInFlight, _renderSettings.maxQueuedTileUploads); // a reload never waits in push()
+
+	size_t budgetBytes = _renderSettings.tileTextureBudgetBytes;
+
+	if (_renderSettings.virtualTexturing) // loads in flight get their layers before the eviction makes room
+		budgetBytes = (layersPerPage > maxInFlight ? layersPerPage - maxInFlight : 1) * tileBytes;
+
+	_tileResidency.initialize(_tilePyramid.getNodeCount(), tileBytes, budgetBytes, maxInFlight);
+
+	for (size_t node = 0; node < _tilePyramid.getNodeCount(); node++)
+	{
+		if (_tilePyramid.getNode(node).level + _renderSettings.pinnedTileLevels >= _tilePyramid.getLevelCount())
+			_tileResidency.pinTile(node);
+	}
+	///
+
+	createPersistentObjects(); // camera icon and shaders, the first scene only
+
+	if (_renderSettings.virtualTexturing)
+	{
+		_virtualTexture.initialize(_tilePyramid, _renderSettings.vtFeedbackScale);
+
+		_virtualTextureShader->setPyramid(_tilePyramid, (size_t) tileTexSize);
+		_virtualTextureShader->setLodErrorThreshold(getLodErrorThreshold());
+	}
+
+	_tileTextureStore.setAnisotropy(_qualityController.getLevel().maxAnisotropy);
+
+	/// the cached root tile is the overview right away, decoded if the cache holds blocks
+	if (_tileCache)
+	{
+		size_t					bytes;
+		const unsigned char*	rootPixels = _tileCache->getTile(_tilePyramid.getRootNode(), bytes);
+		vector<unsigned char>	pixels;
+
+		if (compression == TILE_COMPRESSION_NONE)
+			pixels.assign(rootPixels, rootPixels + bytes);
+		else
+		{
+			pixels.resize((size_t) tileTexSize * (size_t) tileTexSize * 3);
+
+			if (!BlockCompressor::decompress(rootPixels, (size_t) tileTexSize, (size_t) tileTexSize, compression, pixels.data()))
+				pixels.clear();
+		}
+
+		if (!pixels.empty())
+		{
+			lock_guard<mutex> guard(_overviewLock);
+
+			_overviewPixels.swap(pixels);
+			_overviewPending = true;
+		}
+	}
+	///
+
+	/// the whole pyramid fits the budget: build all of it in the background, the render loop
+	/// uploads the tiles as they come; otherwise tiles are only loaded once the lod (or the
+	/// virtual texture feedback) wants them
+	_sceneBuildFinished = false;
+	_eagerBuild = !_renderSettings.virtualTexturing && _tilePyramid.getNodeCount() <= _tileResidency.getMaxResidentCount();
+
+	if (_eagerBuild)
+		_sceneBuildThread = _tileCache ? thread(&GLApplication::readCachedTiles, this) : thread(&GLApplication::buildTilePixels, this);
+	else
+	{
+		_tileResidency.requestPinned([this](size_t node) { loadTile(node); });
+		_sceneBuildFinished = true;
+	}
+	///
+
+	/// 'N' flips through the images shown so far
+	_currentScene = find(_sceneFilenames.begin(), _sceneFilenames.end(), imageFilename) - _sceneFilenames.begin();
+
+	if (_currentScene == _sceneFilenames.size())
+		_sceneFilenames.push_back(imageFilename);
+	///
+
+	/// all set, set background color to be black
+	_readyToRun = true;
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f); 
+	///
+
+	MemoryTracker::getInstance().printBreakdown("buildScene " + imageFilename);
+
+	if (!_headless)
+		glfwShowWindow(_glWindow); // tiles fill in progressively
+}
+
+void GLApplication::swapScene(const string& imageFilename)
+{
+	if (!_loadingScene.empty())
+	{
+		LogStream() << __FUNCTION__ << " " << _loadingScene << " is still loading, " << imageFilename << " not swapped in" << endl;
+		return;
+	}
+
+	_loadingScene = imageFilename;
+	_sceneLoaded = false;
+
+	/// the old build goes on, a file that does not open leaves the current scene as it is; the
+	/// swap cancels the build in release()
+	_sceneLoadThread = thread(&GLApplication::loadSceneSource, this, imageFilename);
+}
+
+/// scene load thread of swapScene(): maps, opens or decodes the new image, rendering goes on
+///
+void GLApplication::loadSceneSource(string imageFilename)
+{
+	_sceneLoadSucceeded = openSceneSource(imageFilename, _loadedImageSource, _loadedFullMapBuffer, _loadedTileCache);
+
+	_sceneLoaded = true; // publishes the four above
+
+	wakeRenderLoop();
+}
+
+/// gl thread, the frame after the new source is open: the old scene's visible tiles move to
+/// the fading batch, the new scene is set up on the source and fades in once its root tile is
+/// resident (updateCrossfade())
+///
+void GLApplication::finishSceneSwap()
+{
+	_sceneLoadThread.join(); // done, it only published its source
+
+	string imageFilename;
+
+	imageFilename.swap(_loadingScene);
+	_sceneLoaded = false;
+
+	/// nothing opened: keep showing the current scene
+	if (!_sceneLoadSucceeded || (_loadedImageSource == NULL && _loadedFullMapBuffer == NULL && _loadedTileCache == NULL))
+	{
+		LogStream() << __FUNCTION__ << " Error, " << imageFilename << " could not be opened, the current scene stays" << endl;
+		return;
+	}
+	///
+
+	releaseFadingTiles(); // a swap during a fade drops the older scene right away
+
+	/// the virtual texture's physical cache is one page, held layers would push tiles past it
+	if (_readyToRun && !_renderSettings.virtualTexturing)
+		retireVisibleTiles();
+	///
+
+	release();
+
+	MemoryTracker::getInstance().resetPeaks();
+
+	_imageSource = _loadedImageSource;
+	_fullMapBuffer = _loadedFullMapBuffer;
+	_tileCache = _loadedTileCache;
+
+	_loadedImageSource = NULL;
+	_loadedFullMapBuffer = NULL;
+	_loadedTileCache = NULL;
+
+	setupScene(imageFilename);
+	computeBoundingBox();
+
+	_fadeStarted = false;
+
+	requestRedraw(true);
+}
+
+/// the visible tiles of the scene going away get quads of their own in the fading batch, and
+/// keep their texture layers: release() only hands back the layers the batch renderer still has
+///
+void GLApplication::retireVisibleTiles()
+{
+	for (size_t node : _visibleTiles)
+	{
+		TileTextureSlot slot = _tileBatchRenderer.getTileSlot(node);
+
+		if (!slot.isValid())
+			continue;
+
+		const TilePyramidNode& tileNode = _tilePyramid.getNode(node);
+
+		_fadingTiles.push_back(_fadingBatchRenderer.addTile(tileNode.ll, tileNode.ur, slot, tileNode.texCoordScale));
+		_tileBatchRenderer.setTileSlot(node, TileTextureSlot());
+	}
+
+	if (!_fadingTiles.empty())
+		_fadingBatchRenderer.build();
+}
+
+void GLApplication::releaseFadingTiles()
+{
+	for (size_t tile = 0; tile < _fadingBatchRenderer.getTileCount(); tile++)
+		_tileTextureStore.releaseLayer(_fadingBatchRenderer.getTileSlot(tile));
+
+	_fadingBatchRenderer.reset();
+	_fadingTiles.clear();
+	_fadeStarted = false;
+}
+
+/// the fade starts once the new scene can cover the view (its root tile is resident, or it
+/// failed to build) and ends crossfadeSeconds later
+///
+void GLApplication::updateCrossfade()
+{
+	if (_fadingTiles.empty())
+		return;
+
+	size_t	root = _tilePyramid.getRootNode();
+	bool	covered = root == TilePyramidNode::INVALID_NODE || _tileResidency.getResidentFlags()[root];
+
+	if (!_fadeStarted)
+	{
+		if (!covered)
+			return; // uploads wake the render loop until then
+
+		_fadeStarted = true;
+		_fadeStart = chrono::steady_clock::now();
+	}
+
+	if (getCrossfadeAlpha() >= 1.0f)
+		releaseFadingTiles();
+
+	requestRedraw(); // next step of the fade
+}
+
+/// opacity of the new scene over the fading one
+///
+float GLApplication::getCrossfadeAlpha()
+{
+	if (!_fadeStarted)
+		return 0.0f;
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - _fadeStart).count();
+
+	return _renderSettings.crossfadeSeconds > 0.0 ? (float)min(seconds / _renderSettings.crossfadeSeconds, 1.0) : 1.0f;
+}
+
+/// scene build thread
+///		- cuts and downsamples every pyramid tile and queues it on the streamer
+///		- no gl in here, the overview texture is made by the render loop from the root pixels
+///
+void GLApplication::buildTilePixels()
+{
+	vector<unsigned char> rootPixels;
+
+	auto queueTile = [this](size_t node, const unsigned char* pixels)
+	{
+		return GLApplication::queueTile(node, pixels, true);
+	};
+
+	_imageSource->setSequential(true); // one sweep, top down; the reloads after it read anywhere
+
+	bool completed = _tilePyramid.generatePixels(*_imageSource, queueTile, rootPixels, &_jobSystem, &_cancelSceneBuild);
+
+	_imageSource->setSequential(false);
+
+	if (completed)
+	{
+		lock_guard<mutex> guard(_overviewLock);
+
+		_overviewPixels.swap(rootPixels);
+		_overviewPending = true;
+	}
+
+	_sceneBuildFinished = true;
+
+	cout << __FUNCTION__ << (completed ? " all tiles built" : " cancelled") << endl;
+
+	MemoryTracker::getInstance().printBreakdown("scene build"); // the peak is the build's
+}
+
+/// scene build thread, with a tile cache
+///		- queues the cached tiles coarsest first, the view fills in from the overview down
+///		- the payloads are in the store's format already, nothing is encoded here
+///		- the pages of a tile come in (on this thread) while it is copied into the streamer
+///
+void GLApplication::readCachedTiles()
+{
+	size_t	bytes;
+	bool	completed = true;
+
+	for (size_t node = _tilePyramid.getNodeCount(); node-- > 0 && completed; )
+	{
+		if (node > 0)
+			_tileCache->prefetchTile(node - 1);
+
+		completed = !_cancelSceneBuild && _tileStreamer.push(node, _tileCache->getTile(node, bytes)) && wakeRenderLoop();
+	}
+
+	_sceneBuildFinished = true;
+
+	cout << __FUNCTION__ << (completed ? " all tiles read" : " cancelled") << endl;
+
+	MemoryTracker::getInstance().printBreakdown("scene build");
+}
+
+/// tile cache of the image, if there is one that still matches the image, the tile size, the
+/// tile compression and the pyramid layout
+///
+TileCache* GLApplication::openTileCache(const string& imageFilename)
+{
+	size_t		tileTexSize = _configuration.getTileTexSize();
+	TileCache*	tileCache = TileCache::open(TileCache::getCacheFilename(imageFilename), imageFilename, tileTexSize, getTileCompression());
+
+	if (tileCache == NULL)
+		return NULL;
+
+	const TileCacheHeader&	header = tileCache->getHeader();
+	size_t					baseRows, baseCols;
+
+	TilePyramid::getBaseGrid(header.imageWidth, header.imageHeight, tileTexSize, baseRows, baseCols);
+
+	if (header.baseRows != baseRows || header.baseCols != baseCols || header.bytesPerPixel != 3)
+	{
+		cout << __FUNCTION__ << " tile cache layout does not match, not used" << endl;
+
+		delete tileCache;
+		return NULL;
+	}
+
+	return tileCache;
+}
+
+/// compression of the tile textures: the setting, if the tile size is made of whole blocks and
+/// the driver can sample it
+///
+TileCompression GLApplication::getTileCompression()
+{
+	TileCompression compression = _configuration.getTileTexSize() % 4 == 0 ? _renderSettings.tileCompression : TILE_COMPRESSION_NONE;
+
+	return TileTextureStore::isCompressionSupported(compression) ? compression : TILE_COMPRESSION_NONE;
+}
+
+/// cut (level 0) or downsample one tile straight from the source on the job system, then
+/// queue it for upload; the pixels match what generatePixels() builds for the node
+///		- the root (pinned, loaded up front) is the overview of a scene without a tile cache
+///
+void GLApplication::loadTile(size_t node)
+{
+	if (_tileCache)
+	{
+		_jobSystem.submit([this, node]()
+		{
+			size_t bytes;
+
+			if (!_tileStreamer.push(node, _tileCache->getTile(node, bytes)) || !wakeRenderLoop()) // faults the pages in here, not on the gl thread
+				loadFailed(node);
+		}, &_tileLoads);
+
+		return;
+	}
+
+	const TilePyramidNode&	tileNode = _tilePyramid.getNode(node);
+	size_t					tileTexSize = _configuration.getTileTexSize();
+	size_t					factor = (size_t)1 << tileNode.level;
+
+	_jobSystem.submit([this, node, tileTexSize, factor, tileNode]()
+	{
+		vector<unsigned char> pixels(_imageSource->getRegionSize(tileTexSize, tileTexSize));
+
+		_imageSource->readRegionDownsampled(tileNode.row * tileTexSize * factor, tileNode.col * tileTexSize * factor, 
+											tileTexSize, tileTexSize, factor, pixels.data());
+
+		if (node == _tilePyramid.getRootNode()) // pinned, loaded once per scene
+		{
+			lock_guard<mutex> guard(_overviewLock);
+
+			_overviewPixels = pixels;
+			_overviewPending = true;
+		}
+
+		if (!queueTile(node, pixels.data(), false))
+			loadFailed(node);
+	}, &_tileLoads);
+}
+
+/// a reload whose push was refused (the streamer is cancelled); its load slot is given back by
+/// the next streamTiles()
+///
+void GLApplication::loadFailed(size_t node)
+{
+	lock_guard<mutex> guard(_failedLoadsLock);
+
+	_failedLoads.push_back(node);
+}
+
+void GLApplication::releaseFailedLoads()
+{
+	lock_guard<mutex> guard(_failedLoadsLock);
+
+	for (size_t node : _failedLoads)
+		_tileResidency.loadCancelled(node);
+
+	_failedLoads.clear();
+}
+
+/// hands rgb tile pixels to the upload streamer, block compressed first when the texture store
+/// is; parallel spreads the blocks over the job system (from the build thread, jobs go serial)
+///
+bool GLApplication::queueTile(size_t node, const unsigned char* pixels, bool parallel)
+{
+	TileCompression compression = _tileTextureStore.getCompression();
+
+	if (compression == TILE_COMPRESSION_NONE)
+		return _tileStreamer.push(node, pixels) && wakeRenderLoop();
+
+	/// per call: a parallel compress waits on the job system, which can run another loadTile()
+	/// job, and so another queueTile(), on this thread before the outer one has pushed its blocks
+	vector<unsigned char> blocks(_tileTextureStore.getLayerBytes());
+	///
+
+	size_t tileTexSize = _tileTextureStore.getLayerSize();
+
+	BlockCompressor::compress(pixels, tileTexSize, tileTexSize, 3, compression, _renderSettings.tileCompressionQuality, 
+							  blocks.data(), parallel ? &_jobSystem : NULL);
+
+	return _tileStreamer.push(node, blocks.data()) && wakeRenderLoop();
+}
+
+/// the eager build queues every tile itself, a demand or prefetch load of a tile it has not
+/// delivered yet would decode and compress it a second time; once its last tile is uploaded the
+/// tiles evicted later are loaded on demand again
+///
+bool GLApplication::isEagerBuildPending()
+{
+	if (_eagerBuild && _sceneBuildFinished && _tileStreamer.getQueuedTileCount() == 0)
+		_eagerBuild = false;
+
+	return _eagerBuild;
+}
+
+/// an idle render loop sleeps in glfwWaitEventsTimeout(), a queued tile has to wake it up
+///
+bool GLApplication::wakeRenderLoop()
+{
+	glfwPostEmptyEvent(); // any thread
+
+	return true;
+}
+
+void GLApplication::evictTile(size_t node)
+{
+	_tileTextureStore.releaseLayer(_tileBatchRenderer.getTileSlot(node));
+	_tileBatchRenderer.setTileSlot(node, TileTextureSlot());
+	_tileTable.setTexture(node, TileTextureSlot());
+
+	if (_virtualTexture.isInitialized())
+		_virtualTexture.clearPage(node);
+}
+
+void
+GLApplication::updatePass()
+{
+	int winWidth, winHeight;
+
+	if (_sceneLoaded)
+		finishSceneSwap(); // sets _viewChanged
+
+	/// take care of viewport first
+	if (_headless)
+	{
+		winWidth = (int)_width; // the offscreen framebuffer does not resize
+		winHeight = (int)_height;
+	}
+	else
+		glfwGetFramebufferSize(_glWindow, &winWidth, &winHeight);
+
+	if ((size_t)winWidth != _width || (size_t)winHeight != _height)
+		_viewChanged = true;
+
+	consumeCameraState(); // the camera thread's newest state, for the whole frame
+	
+	_width  = (size_t)winWidth;
+	_height = (size_t)winHeight;
+
+	glViewport(0, 0, (GLsizei)_width, (GLsizei)_height);
+	///
+
+	/// model, view and projection matrices only change with the view
+	if (_viewChanged)
+	{
+		computeMatrices();
+
+		_viewChanged = false;
+		_feedbackStale = true; // the nodes wanted only depend on the view
+	}
+	///
+}
+
+/// model, view and projection matrices of the scene, and the ones of the camera icon and the
+/// overview map, for the current view; cached until the view changes
+///
+void GLApplication::computeMatrices()
+{
+	static glm::mat4	identity(1.0f);
+
+	glm::mat4 hudModel;
+
+	/// the ortho map view, also used by the overlays in either projection
+	getSceneMatrices(_cameraPos, _cameraDir, _rotationAngle, true, _hudProjection, _hudView, hudModel);
+	///
+
+	getSceneMatrices(_cameraPos, _cameraDir, _rotationAngle, _projectionOrtho, _projection, _view, _model);
+
+	if (_projectionOrtho == true)
+	{
+		/// camera icon, fixed near the bottom of the screen
+		glm::vec3 cameraPos = glm::vec3(_width / 2.0f, _height / 5.0f, _configuration.getCameraInitialPos().z);
+
+		_cameraGeometry->setLocationDirection(cameraPos, _cameraDir);
+
+		_cameraIconModelView = glm::translate(identity, cameraPos) * glm::rotate(identity, glm::radians(_rotationAngle), _zAxis);
+		///
+	}
+	else
+		_cameraGeometry->setLocationDirection(_cameraPos, _cameraDir); // 
+}
+
+/// model, view and projection matrices of the scene seen from a camera; computeMatrices() for the
+/// current one, the prefetch for a predicted one
+///
+void GLApplication::getSceneMatrices(const glm::vec3& cameraPosition, const glm::vec3& cameraDirection, float rotationAngle, bool ortho,
+									 glm::mat4& projection, glm::mat4& view, glm::mat4& model)
+{
+	static glm::mat4	identity(1.0f);
+
+	/// begin - compute model, view and projection matrices next
+	///
+	if (ortho == true)
+	{
+		float mapSize = _configuration.getMapSize();
+		float mapSizeB2 = mapSize / 2.0f;
+
+		glm::mat4 transMinus = glm::translate(identity, glm::vec3(-mapSizeB2, -mapSizeB2, 0));
+		glm::mat4 rotate     = glm::rotate(identity, glm::radians(rotationAngle), _zAxis);
+		glm::mat4 transPlus  = glm::translate(identity, glm::vec3(mapSizeB2, mapSizeB2, 0));
+
+		projection = glm::ortho(0.0f, mapSize, 0.0f, mapSize, -mapSize, mapSize);
+		view = transPlus * rotate * transMinus;
+		model = identity;
+	}
+	else
+	{
+		GLfloat aspect = (GLfloat) _height / (GLfloat) _width;
+
+		projection = glm::perspective(_configuration.getFOV(), aspect, _configuration.getNear(), 
+									  _configuration.getFar() * _qualityController.getLevel().farScale);
+
+		/// begin - calculation are in enu from now on
+		///
+		glm::vec3 cameraDir = glm::normalize(glm::vec3(cameraDirection.x, 0.0, cameraDirection.z));
+
+		glm::vec3 cameraPos = glm::vec3(cameraPosition.x, -cameraPosition.z, cameraPosition.y); // in enu
+		
+		view = glm::lookAt(cameraPos, cameraPos - cameraDir, _yAxis);
+
+		model = _toEnu; // this will render all 3d geometry models in enu coord sys
+		///
+		/// end - calculation are in enu from now on
+	}
+	/// end - compute model, view and projection matrices next
+}
+
+void
+GLApplication::cullPass()
+{
+	size_t finestLevel = selectTiles();
+
+	_frameStats.frameCount++;
+	_frameStats.visibleTiles = _visibleTiles.size();
+	_frameStats.culledTiles  = _virtualTexture.isInitialized() ? 0 : _tilePyramid.getLodStats().culledNodes; // the rasterizer clips the map quad
+	_frameStats.finestLevel  = finestLevel;
+
+	prefetchTiles(); // after the stats, its select() has its own
+}
+
+/// the tiles to draw and the loads of the missing ones, for the current matrices; the finest
+/// level drawn is returned
+///		- no frame stats and no prefetch, exportView() settles its squares with this alone
+///
+size_t GLApplication::selectTiles()
+{
+	/// planes are taken from the same matrices renderPass() uses, so the test happens in tile space
+	/// for both the ortho and the perspective projection
+	_frustum.update(_projection * _view * _model);
+
+	size_t finestLevel;
+
+	if (_virtualTexture.isInitialized())
+		finestLevel = selectVirtualPages();
+	else
+	{
+		_tilePyramid.select(_frustum, _projection, _view * _model, _height, getLodErrorThreshold(), _renderSettings.maxTilesPerFrame, 
+							_visibleTiles, &_tileResidency.getResidentFlags(), &_missingTiles);
+
+		finestLevel = _tilePyramid.getLodStats().finestLevel;
+	}
+	///
+
+	/// keep what is drawn, ask for what the lod wanted but had to fall back for
+	_tileResidency.beginFrame();
+	_tileResidency.touch(_visibleTiles);
+
+	if (!isEagerBuildPending())
+		_tileResidency.requestMissing(_missingTiles, [this](size_t node) { loadTile(node); });
+	///
+
+	return finestLevel;
+}
+
+/// selectTiles() of the virtual texture: the feedback says which nodes the fragments wanted, the
+/// resident ones (or the ancestors standing in for them) are drawn, the others are missing
+///		- the last feedback is kept until a newer one is collected, the readback lags a frame or two
+///		- _visibleTiles are the nodes the page table points at, for the residency and the boundaries
+///		- the wanted set is coarsened to the layers the budget leaves next to the pinned tiles, so
+///		  the drawn tiles never push the physical page over
+///
+size_t GLApplication::selectVirtualPages()
+{
+	_virtualTexture.collectFeedback(_feedbackTiles);
+
+	size_t maxResident = _tileResidency.getMaxResidentCount();
+	size_t pinned      = _tileResidency.getPinnedCount();
+
+	coarsenFeedback(maxResident > pinned ? maxResident - pinned : 0);
+
+	const vector<unsigned char>& resident = _tileResidency.getResidentFlags();
+
+	_visibleTiles.clear();
+	_missingTiles.clear();
+
+	size_t finestLevel = _tilePyramid.getLevelCount();
+
+	for (size_t node : _feedbackTiles)
+	{
+		size_t drawn = node;
+
+		while (drawn != TilePyramidNode::INVALID_NODE && !resident[drawn])
+			drawn = _tilePyramid.getNode(drawn).parent;
+
+		if (drawn != node)
+			_missingTiles.push_back(node);
+
+		if (drawn != TilePyramidNode::INVALID_NODE)
+		{
+			_visibleTiles.push_back(drawn);
+			finestLevel = min(finestLevel, _tilePyramid.getNode(drawn).level);
+		}
+	}
+
+	/// ancestors standing in for several nodes are listed once
+	sort(_visibleTiles.begin(), _visibleTiles.end());
+	_visibleTiles.erase(unique(_visibleTiles.begin(), _visibleTiles.end()), _visibleTiles.end());
+	///
+
+	return _visibleTiles.empty() ? 0 : finestLevel;
+}
+
+/// replaces the finest wanted nodes by their parents until at most capacity of them are not pinned,
+/// the count left is returned
+///
+size_t GLApplication::coarsenFeedback(size_t capacity)
+{
+	while (true)
+	{
+		size_t unpinned = 0;
+		size_t finestLevel = _tilePyramid.getLevelCount();
+
+		for (size_t node : _feedbackTiles)
+		{
+			if (_tileResidency.isPinned(node))
+				continue;
+
+			unpinned++;
+			finestLevel = min(finestLevel, _tilePyramid.getNode(node).level);
+		}
+
+		if (unpinned <= capacity)
+			return unpinned;
+
+		for (size_t& node : _feedbackTiles)
+		{
+			const TilePyramidNode& tileNode = _tilePyramid.getNode(node);
+
+			if (tileNode.level == finestLevel && !_tileResidency.isPinned(node) && tileNode.parent != TilePyramidNode::INVALID_NODE)
+				node = tileNode.parent;
+		}
+
+		sort(_feedbackTiles.begin(), _feedbackTiles.end());
+		_feedbackTiles.erase(unique(_feedbackTiles.begin(), _feedbackTiles.end()), _feedbackTiles.end());
+	}
+}
+
+/// loads the tiles the camera will want prefetchFramesAhead frames from now, going on as it did
+/// over the last frames; they get the load slots the visible misses left
+///		- virtual texturing: no more than the layers the (coarsened) wanted set left free
+///
+void GLApplication::prefetchTiles()
+{
+	_motionPredictor.addFrame(_cameraPos, _rotationAngle, _cameraJumps);
+
+	glm::vec3	position;
+	float		rotationAngle;
+
+	if (isEagerBuildPending() || !_motionPredictor.predict(_renderSettings.prefetchFramesAhead, position, rotationAngle))
+		return;
+
+	/// the frustum of the predicted camera
+	glm::vec3 direction = glm::normalize(glm::vec3(cos(glm::radians(rotationAngle)), sin(glm::radians(rotationAngle)), 0.0f));
+	glm::mat4 projection, view, model;
+
+	getSceneMatrices(position, direction, rotationAngle, _projectionOrtho, projection, view, model);
+
+	Frustum frustum;
+
+	frustum.update(projection * view * model);
+	///
+
+	_prefetchTiles.clear();
+	_prefetchMissing.clear();
+
+	_tilePyramid.select(frustum, projection, view * model, _height, getLodErrorThreshold(), _renderSettings.maxTilesPerFrame, 
+						_prefetchTiles, &_tileResidency.getResidentFlags(), &_prefetchMissing);
+
+	size_t maxPrefetch = _renderSettings.maxPrefetchInFlight;
+
+	if (_virtualTexture.isInitialized())
+	{
+		size_t maxResident = _tileResidency.getMaxResidentCount();
+		size_t wanted      = _tileResidency.getPinnedCount() + coarsenFeedback((size_t)-1);
+
+		maxPrefetch = min(maxPrefetch, maxResident > wanted ? maxResident - wanted : 0);
+	}
+
+	if (maxPrefetch == 0)
+		return;
+
+	_tileResidency.requestPrefetch(_prefetchMissing, [this](size_t node) { loadTile(node); }, maxPrefetch);
+}
+
+void
+GLApplication::preRenderPass()
+{
+	streamTiles();
+
+	/// the overview map uses the root of the pyramid instead of a full resolution texture
+	if (_overviewPending)
+	{
+		lock_guard<mutex> guard(_overviewLock);
+
+		const TilePyramidNode& root = _tilePyramid.getNode(_tilePyramid.getRootNode());
+
+		size_t tileTexSize    = _configuration.getTileTexSize();
+		size_t overviewWidth  = (size_t)(root.texCoordScale.x * tileTexSize); // s: pixel columns
+		size_t overviewHeight = (size_t)(root.texCoordScale.y * tileTexSize); // t: pixel rows
+
+		_fullMapTexture = createOverviewTexture(_overviewPixels, tileTexSize, overviewWidth, overviewHeight, _renderSettings.overviewSourceSize);
+		_fullMapGeometry = new TileGeometry(root.ll, root.ur, _fullMapTexture);
+
+		_overviewPixels.clear();
+		_overviewPending = false;
+		_overviewMapDirty = true;
+
+		requestRedraw();
+	}
+	///
+
+	updateOverviewMap();
+
+	updateCrossfade();
+
+	logGLError(__FUNCTION__);
+}
+
+/// the tile side of the pre render pass: uploads, evictions and the virtual texture feedback;
+/// exportView() runs it on its own, without the hud
+///
+void GLApplication::streamTiles()
+{
+	releaseFailedLoads();
+
+	/// stream in the tiles the build thread has queued, within the per frame budget
+	auto tileUploaded = [this](size_t node, const TileTextureSlot& slot)
+	{
+		if (_tileBatchRenderer.getTileSlot(node).isValid())
+			_tileTextureStore.releaseLayer(_tileBatchRenderer.getTileSlot(node)); // loaded twice, keep the new one
+
+		_tileBatchRenderer.setTileSlot(node, slot);
+		_tileTable.setTexture(node, slot);
+		_tileResidency.tileArrived(node);
+
+		if (_virtualTexture.isInitialized())
+			_virtualTexture.setPage(node, slot);
+	};
+
+	_frameStats.uploadedTiles = _tileStreamer.pump(_renderSettings.uploadBytesPerFrame, _tileTextureStore, GL_RGB, GL_UNSIGNED_BYTE, tileUploaded);
+
+	if (_frameStats.uploadedTiles > 0)
+		requestRedraw(); // the lod picks the new tiles in the next cull pass
+
+	if (_frameStats.uploadedTiles > 0 && _tileStreamer.getUploadedTileCount() == _tilePyramid.getNodeCount())
+		LogStream() << __FUNCTION__ << " Constructed: " << _tileStreamer.getUploadedTileCount() << " tiles, all uploaded" << endl;
+	///
+
+	/// back within the gpu budget, least recently drawn tiles first
+	_tileResidency.evictOverBudget([this](size_t node) { evictTile(node); });
+	///
+
+	/// virtual texturing: the page table follows the arrivals / evictions, then the feedback pass
+	/// reports the nodes a new view wants; the readback is collected by a later cull pass
+	if (_virtualTexture.isInitialized())
+	{
+		_virtualTexture.updatePageTable();
+
+		if (_feedbackStale)
+		{
+			_virtualTextureShader->enable(true, _virtualTexture.getFeedbackScale());
+			_virtualTextureShader->setProjectionMatrix(_projection);
+			_virtualTextureShader->setModelViewMatrix(_view * _model);
+
+			_feedbackStale = !_virtualTexture.renderFeedback(_width, _height, _offscreenFramebuffer);
+
+			_virtualTextureShader->disable();
+		}
+
+		if (_virtualTexture.isFeedbackPending() || _feedbackStale)
+			requestRedraw(); // one more frame to pick it up
+	}
+	///
+}
+
+void
+GLApplication::renderPass()
+{
+	/// the scene's target, whatever an earlier pass left bound; 0 unless headless or exporting
+	glBindFramebuffer(GL_FRAMEBUFFER, _offscreenFramebuffer);
+	///
+
+	/// must clear color and depth buffer
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	///
+
+	/// begin - render all small tiles
+	glm::mat4 modelView = _view * _model;
+
+	/// a swapped out scene is drawn first, the new one blends over it
+	bool fading = !_fadingTiles.empty();
+
+	if (fading)
+	{
+		_tileArrayShader->enable();
+		_tileArrayShader->setProjectionMatrix(_projection);
+		_tileArrayShader->setModelViewMatrix(modelView);
+
+		glDepthMask(GL_FALSE); // same plane as the new tiles, which must not fail the depth test
+		_fadingBatchRenderer.render(_fadingTiles, _tileTextureStore);
+		glDepthMask(GL_TRUE);
+
+		_tileArrayShader->disable();
+
+		glEnable(GL_BLEND);
+		glBlendColor(0.0f, 0.0f, 0.0f, getCrossfadeAlpha());
+		glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+	}
+	///
+
+	if (_virtualTexture.isInitialized())
+	{
+		/// one quad, the page table picks the tile per fragment
+		_virtualTextureShader->enable();
+		_virtualTextureShader->setProjectionMatrix(_projection);
+		_virtualTextureShader->setModelViewMatrix(modelView);
+
+		_virtualTexture.render(_tileTextureStore);
+
+		_virtualTextureShader->disable();
+
+		_frameStats.tileDrawCalls = 1;
+		///
+	}
+
+	/// update the shader uniforms
+	_tileArrayShader->enable();
+	_tileArrayShader->setProjectionMatrix(_projection);
+	_tileArrayShader->setModelViewMatrix(modelView);
+	///
+
+	if (!_virtualTexture.isInitialized())
+	{
+		_tileBatchRenderer.render(_visibleTiles, _tileTextureStore);
+
+		_frameStats.tileDrawCalls = _tileBatchRenderer.getDrawCallCount();
+	}
+
+	if (_renderTileBoundaries)
+	{
+		_tileArrayShader->setBoundaryMode(true);
+		_tileBatchRenderer.renderBoundaries(_visibleTiles);
+		_tileArrayShader->setBoundaryMode(false);
+	}
+	
+	_tileArrayShader->disable();
+
+	if (fading)
+		glDisable(GL_BLEND);
+	/// end - render all small tiles
+
+	logGLError(__FUNCTION__);
+}
+
+void
+GLApplication::postRenderPass()
+{
+	// render camera icon geomentry
+	// render large preview map tile geomentry near lower left
+
+	bool enableHUD = true; // still a wip
+
+	if (_projectionOrtho)
+	{
+		_basicShader->enable();
+		_basicShader->setProjectionMatrix(_hudProjection);
+		_basicShader->setModelViewMatrix(_cameraIconModelView);
+		_cameraGeometry->render();
+		_basicShader->disable();
+
+		logGLError(__FUNCTION__);
+	}
+
+	if (enableHUD && _overviewFramebuffer != 0 && _fullMapGeometry != NULL) // none while the scene's root tile is not there
+	{
+		/// the cached overview, one blit into the lower right corner
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _overviewFramebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _offscreenFramebuffer);
+
+		glBlitFramebuffer(0, 0, _overviewMapWidth, _overviewMapHeight, 
+			(GLint)_width - _overviewMapWidth, 0, (GLint)_width, _overviewMapHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, _offscreenFramebuffer); // 0 unless headless
+		///
+	
+		logGLError(__FUNCTION__);
+	}
+}
+
+/// the overview map is rendered into its own framebuffer, and only again when the map rotated,
+/// the window resized or a new overview arrived; postRenderPass() blits it each frame
+///
+void GLApplication::updateOverviewMap()
+{
+	if (_fullMapGeometry == NULL)
+		return;
+
+	GLsizei mapWidth  = max((GLsizei)_width  / 8, 1);
+	GLsizei mapHeight = max((GLsizei)_height / 8, 1);
+
+	if (mapWidth != _overviewMapWidth || mapHeight != _overviewMapHeight)
+	{
+		releaseOverviewMap();
+
+		_overviewMapWidth = mapWidth;
+		_overviewMapHeight = mapHeight;
+	}
+	else if (!_overviewMapDirty && _overviewMapAngle == _rotationAngle)
+		return;
+	else if (!_overviewMapDirty)
+	{
+		/// rotation only: at most one re-render per hud interval of the quality level, the frame
+		/// after the interval picks up the last angle
+		double interval = _qualityController.getLevel().hudIntervalSeconds;
+
+		if (chrono::duration<double>(chrono::steady_clock::now() - _overviewMapTime).count() < interval)
+		{
+			_redrawNeeded = true;
+			return;
+		}
+		///
+	}
+
+	/// begin - (re)create the target
+	if (_overviewFramebuffer == 0)
+	{
+		glGenTextures(1, &_overviewColor);
+		glBindTexture(GL_TEXTURE_2D, _overviewColor);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, mapWidth, mapHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+		MemoryTracker::getInstance().allocate(MEMORY_OVERVIEW, MemoryTracker::getGLOwner(GL_TEXTURE, _overviewColor), (size_t)mapWidth * mapHeight * 3);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &_overviewFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, _overviewFramebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _overviewColor, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			cout << __FUNCTION__ << "Error, overview framebuffer incomplete" << endl;
+	}
+	else
+		glBindFramebuffer(GL_FRAMEBUFFER, _overviewFramebuffer);
+	/// end - (re)create the target
+
+	/// begin - render the rotated map into it
+	glViewport(0, 0, mapWidth, mapHeight);
+	glDisable(GL_DEPTH_TEST);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	_basicShader->enable();
+	_basicShader->setProjectionMatrix(_hudProjection);
+	_basicShader->setModelViewMatrix(_hudView);
+	_fullMapGeometry->render();
+	_basicShader->disable();
+
+	glEnable(GL_DEPTH_TEST);
+	/// end - render the rotated map into it
+
+	glBindFramebuffer(GL_FRAMEBUFFER, _offscreenFramebuffer); // 0 unless headless
+	glViewport(0, 0, (GLsizei)_width, (GLsizei)_height);
+
+	_overviewMapAngle = _rotationAngle;
+	_overviewMapDirty = false;
+	_overviewMapTime = chrono::steady_clock::now();
+
+	logGLError(__FUNCTION__);
+}
+
+void GLApplication::releaseOverviewMap()
+{
+	if (_overviewFramebuffer != 0)
+		glDeleteFramebuffers(1, &_overviewFramebuffer);
+
+	if (_overviewColor != 0)
+	{
+		MemoryTracker::getInstance().releaseOwner(MEMORY_OVERVIEW, MemoryTracker::getGLOwner(GL_TEXTURE, _overviewColor));
+		glDeleteTextures(1, &_overviewColor);
+	}
+
+	_overviewFramebuffer = _overviewColor = 0;
+	_overviewMapWidth = _overviewMapHeight = 0;
+	_overviewMapDirty = true;
 }
 
 void
 GLApplication::computeBoundingBox()
 {
-	/// begin - compute bounding box here
-	float		bigNum = 10e6;
-	glm::vec3	ll, ur;
-	
-	_bbLL = glm::vec3( bigNum,  bigNum,  bigNum);    // bounding box ll
-	_bbUR = glm::vec3(-bigNum, -bigNum, -bigNum); // bounding box ur
+	/// begin - compute bounding box here
+	float		bigNum = 10e6;
+	
+	_bbLL = glm::vec3( bigNum,  bigNum,  bigNum);    // bounding box ll
+	_bbUR = glm::vec3(-bigNum, -bigNum, -bigNum); // bounding box ur
+
+	/// extents per chunk of tiles on the job system (simd within a chunk), then the chunks are merged
+	size_t				grain = 16384;
+	size_t				chunkCount = (_tileTable.getCount() + grain - 1) / grain;
+	vector<glm::vec3>	chunkLL(chunkCount, _bbLL);
+	vector<glm::vec3>	chunkUR(chunkCount, _bbUR);
+
+	_jobSystem.parallelFor(_tileTable.getCount(), grain, [&](size_t begin, size_t end)
+	{
+		_tileTable.getExtents(begin, end, chunkLL[begin / grain], chunkUR[begin / grain]);
+	});
+
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		UtilityFunctions::getResizeExtents(chunkLL[chunk], _bbLL, _bbUR);
+		UtilityFunctions::getResizeExtents(chunkUR[chunk], _bbLL, _bbUR);
+	}
+	///
+
+	cout << __FUNCTION__ << " bounding box  lower left: " << _bbLL.x << ", " << _bbLL.y << ", " << _bbLL.z << endl;
+	cout << __FUNCTION__ << " bounding box upper right: " << _bbUR.x << ", " << _bbUR.y << ", " << _bbUR.z << endl;
+	/// end - compute bounding box here
+}
+
+void GLApplication::startRendering()
+{
+	computeBoundingBox();
+
+	gotoHomePositionAndView();
+
+	printHelp();
+
+	/// navigation runs on the camera thread from now on, a new camera wakes the render loop
+	_cameraController.start(_renderSettings.cameraMoveStepsPerSecond, _renderSettings.cameraTurnStepsPerSecond, 
+							_renderSettings.cameraTickSeconds, [] { glfwPostEmptyEvent(); });
+	///
+
+	std::cout << __FUNCTION__ << " rendering started... " << endl;
+	
+	while (!glfwWindowShouldClose(_glWindow))
+	{
+		/// nothing changed: sleep until input, a tile arriving (glfwPostEmptyEvent) or the timeout
+		if (!isFrameNeeded())
+		{
+			glfwWaitEventsTimeout(_renderSettings.idleWaitSeconds);
+			continue;
+		}
+		///
+
+		/// 'X': the export holds the loop, it is not a frame of the quality controller
+		if (_exportPending)
+		{
+			runPendingExport();
+			continue;
+		}
+		///
+
+		_redrawNeeded = false;
+
+		chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+
+		renderFrame();
+
+		_profiler.renderOverlay(_width, _height);
+
+		{
+			ProfileScope timing(_profiler, PROFILE_SWAP, false); // mostly the wait for vsync
+
+			glfwSwapBuffers(_glWindow); // swap the buffer to display it
+		}
+
+		/// the frame time, without the idle waits in between, steers the quality level
+		double frameMs = chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+
+		if (_qualityController.addFrame(frameMs))
+		{
+			applyQualityLevel();
+
+			requestRedraw(true); // far plane and lod changed
+		}
+		///
+
+		glfwPollEvents();           // handle next key press event
+	}
+
+	_cameraController.stop();
+
+	AsyncLogger::getInstance().flush();
+
+	std::cout << __FUNCTION__ << " rendering ended... " << endl;
+}
+
+/// a frame is due when the view or the picture changed, or tiles wait for their upload; the
+/// timing overlay keeps the loop running so its bars stay live
+///
+bool GLApplication::isFrameNeeded()
+{
+	return _redrawNeeded || _exportPending || _viewChanged || _sceneLoaded || _cameraController.hasNewState() || _overviewPending || _tileStreamer.getQueuedTileCount() > 0 || _profiler.isOverlayEnabled();
+}
+
+void GLApplication::requestRedraw(bool viewChanged)
+{
+	if (viewChanged)
+		_viewChanged = true;
 
-	for (TileGeometry* tile : _tileGeometryObjects)
+	_redrawNeeded = true;
+}
+
+void GLApplication::renderFrame(BenchmarkRecorder* recorder)
+{
+	if (recorder == NULL)
 	{
-		tile->getBBoxExtents(ll, ur);
+		_profiler.beginFrame();
+
+		{
+			ProfileScope timing(_profiler, PROFILE_UPDATE);
+			updatePass();
+		}
+
+		{
+			ProfileScope timing(_profiler, PROFILE_CULL);
+			cullPass();
+		}
+
+		{
+			ProfileScope timing(_profiler, PROFILE_PRE_RENDER);
+			preRenderPass();
+		}
+
+		{
+			ProfileScope timing(_profiler, PROFILE_RENDER);
+			renderPass();
+		}
+
+		{
+			ProfileScope timing(_profiler, PROFILE_POST_RENDER);
+			postRenderPass();
+		}
 
-		UtilityFunctions::getResizeExtents(ll, _bbLL, _bbUR);
-		UtilityFunctions::getResizeExtents(ur, _bbLL, _bbUR);
+		return;
 	}
 
-	cout << __FUNCTION__ << " bounding box  lower left: " << _bbLL.x << ", " << _bbLL.y << ", " << _bbLL.z << endl;
-	cout << __FUNCTION__ << " bounding box upper right: " << _bbUR.x << ", " << _bbUR.y << ", " << _bbUR.z << endl;
-	/// end - compute bounding box here
+	/// same passes, each one timed on the cpu; the gl work is waited for at the end, so the
+	/// frame time covers the gpu too
+	typedef chrono::steady_clock Clock;
+
+	auto elapsed = [](Clock::time_point begin, Clock::time_point end)
+	{
+		return chrono::duration<double, milli>(end - begin).count();
+	};
+
+	Clock::time_point frameBegin = Clock::now();
+
+	updatePass();
+	Clock::time_point updated = Clock::now();
+
+	cullPass();
+	Clock::time_point culled = Clock::now();
+
+	preRenderPass();
+	Clock::time_point preRendered = Clock::now();
+
+	renderPass();
+	Clock::time_point rendered = Clock::now();
+
+	postRenderPass();
+	Clock::time_point postRendered = Clock::now();
+
+	glFinish();
+	Clock::time_point finished = Clock::now();
+
+	recorder->record("update", elapsed(frameBegin, updated));
+	recorder->record("cull", elapsed(updated, culled));
+	recorder->record("preRender", elapsed(culled, preRendered));
+	recorder->record("render", elapsed(preRendered, rendered));
+	recorder->record("postRender", elapsed(rendered, postRendered));
+	recorder->record("gpuFinish", elapsed(postRendered, finished));
+	recorder->record("frame", elapsed(frameBegin, finished));
+	///
 }
 
-void GLApplication::startRendering()
+bool GLApplication::runBenchmark(const string& scriptFilename, size_t frameCount, const string& reportFilename)
 {
+	if (!_readyToRun)
+	{
+		cout << __FUNCTION__ << "Error, no scene to benchmark" << endl;
+		return false;
+	}
+
+	CameraScript script;
+
+	if (scriptFilename.empty())
+		script.loadDefault();
+	else if (!script.load(scriptFilename))
+		return false;
+
 	computeBoundingBox();
 
 	gotoHomePositionAndView();
 
-	printHelp();
+	/// settle: render at home until the scene build is done and no tile is in flight, so the
+	/// measured frames do not depend on how fast the tiles happened to stream in
+	size_t warmupFrames = 0;
 
-	std::cout << __FUNCTION__ << " rendering started... " << endl;
-	
-	while (!glfwWindowShouldClose(_glWindow))
+	while (!(_sceneBuildFinished && _tileStreamer.getQueuedTileCount() == 0 && _tileResidency.getInFlightCount() == 0))
 	{
-		updatePass();
+		renderFrame();
+		glFinish();
 
-		cullPass();
+		warmupFrames++;
+	}
 
-		preRenderPass();
+	cout << __FUNCTION__ << " scene settled after " << warmupFrames << " frames, running " << frameCount << " frames" << endl;
+	///
 
-		renderPass();
+	BenchmarkRecorder	recorder;
+	vector<int>			keys;
+	size_t				visibleTiles = 0, drawCalls = 0, uploadedTiles = 0;
 
-		postRenderPass();
+	for (size_t frame = 0; frame < frameCount; frame++)
+	{
+		script.getKeys(frame, keys);
 
-		glfwSwapBuffers(_glWindow); // swap the buffer to display it
+		for (int key : keys)
+			handleKey(key);
 
-		glfwPollEvents();           // handle next key press event
+		renderFrame(&recorder);
+
+		visibleTiles += _frameStats.visibleTiles;
+		drawCalls += _frameStats.tileDrawCalls;
+		uploadedTiles += _frameStats.uploadedTiles;
+
+		if (!_headless)
+			glfwSwapBuffers(_glWindow);
+
+		glfwPollEvents();
 	}
 
-	std::cout << __FUNCTION__ << " rendering ended... " << endl;
+	/// report
+	const GLubyte* renderer = glGetString(GL_RENDERER);
+	double frames = frameCount > 0 ? (double)frameCount : 1.0;
+
+	recorder.setInfo("renderer", renderer ? (const char*)renderer : "unknown");
+	recorder.setInfo("headless", _headless ? 1.0 : 0.0);
+	recorder.setInfo("width", (double)_width);
+	recorder.setInfo("height", (double)_height);
+	recorder.setInfo("frames", (double)frameCount);
+	recorder.setInfo("warmupFrames", (double)warmupFrames);
+	recorder.setInfo("script", scriptFilename.empty() ? "default" : scriptFilename);
+	recorder.setInfo("pyramidTiles", (double)_tilePyramid.getNodeCount());
+	recorder.setInfo("meanVisibleTiles", (double)visibleTiles / frames);
+	recorder.setInfo("meanTileDrawCalls", (double)drawCalls / frames);
+	recorder.setInfo("uploadedTiles", (double)uploadedTiles);
+	recorder.setInfo("tileCompression", BlockCompressor::getName(_tileTextureStore.getCompression()));
+	recorder.setInfo("prefetchFramesAhead", (double)_renderSettings.prefetchFramesAhead);
+	recorder.setInfo("prefetchRequests", (double)_tileResidency.getStats().prefetchRequests);
+	recorder.setInfo("prefetchHitRate", _tileResidency.getStats().getPrefetchHitRate());
+	///
+
+	return recorder.writeJson(reportFilename);
+}
+
+/// the current view at any resolution, into a tiled BigTIFF
+///		- the output is cut into exportTileSize squares, each rendered into one framebuffer with
+///		  the part of the projection that covers it; the lod sees the output resolution
+///		- a square is rendered once the lod has every tile it wants resident (or the settle time
+///		  ran out, the coarser fallbacks are drawn then)
+///		- two pixel buffers: the readback of a square runs while the next one renders; a row of
+///		  squares fills the strip, which goes to the writer before the next row starts
+///		- scene only, no camera icon or overview; at full quality
+///		- the squares settle on selectTiles() alone: no prefetch, and the frame stats, the motion
+///		  history and the quality level of the window are as they were before
+///		- blocks until the file is written, see runPendingExport() for the 'X' key
+///
+bool GLApplication::exportView(const string& filename, size_t width, size_t height)
+{
+	if (!_readyToRun)
+	{
+		cout << __FUNCTION__ << "Error, no scene to export" << endl;
+		return false;
+	}
+
+	/// square size: a multiple of the file's tiles, within what the driver can render
+	GLint	maxRenderbufferSize = 0;
+	size_t	fileTileSize = 256;
+
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+
+	size_t tileSize = min(_renderSettings.exportTileSize, (size_t)maxRenderbufferSize) / fileTileSize * fileTileSize;
+
+	tileSize = max(tileSize, fileTileSize);
+	///
+
+	TiledTiffWriter writer;
+
+	if (!writer.create(filename, width, height, fileTileSize))
+		return false;
+
+	cout << __FUNCTION__ << " exporting " << width << " x " << height << " to " << filename << " in " << tileSize << " x " << tileSize << " squares" << endl;
+
+	/// the view as the window shows it now
+	updatePass();
+	///
+
+	/// the window's state, the passes run on the export target meanwhile
+	size_t				windowWidth = _width, windowHeight = _height;
+	GLuint				windowFramebuffer = _offscreenFramebuffer;
+	glm::mat4			windowProjection = _projection;
+	FrameStats			windowFrameStats = _frameStats;
+	MotionPredictor		windowMotion = _motionPredictor;
+	QualityController	windowQuality = _qualityController;
+	///
+
+	/// at full quality
+	_qualityController.reset();
+	applyQualityLevel();
+	///
+
+	/// projection of the whole output, the squares take their part of it
+	glm::mat4 projection, view, model;
+
+	_width = width;
+	_height = height;
+
+	getSceneMatrices(_cameraPos, _cameraDir, _rotationAngle, _projectionOrtho, projection, view, model);
+	///
+
+	/// begin - export target and the readback buffers
+	GLuint exportFramebuffer, exportColor, exportDepth, readbackBuffers[2];
+	GLsync readbackFences[2] = { 0, 0 };
+	size_t readbackBytes = tileSize * tileSize * 4;
+
+	glGenRenderbuffers(1, &exportColor);
+	glBindRenderbuffer(GL_RENDERBUFFER, exportColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, (GLsizei)tileSize, (GLsizei)tileSize);
+
+	glGenRenderbuffers(1, &exportDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, exportDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, (GLsizei)tileSize, (GLsizei)tileSize);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &exportFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, exportFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, exportColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, exportDepth);
+
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	glGenBuffers(2, readbackBuffers);
+
+	for (GLuint buffer : readbackBuffers)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, readbackBytes, NULL, GL_STREAM_READ);
+
+		MemoryTracker::getInstance().allocate(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_BUFFER, buffer), readbackBytes);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	MemoryTracker::getInstance().allocate(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, exportColor), readbackBytes);
+	MemoryTracker::getInstance().allocate(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, exportDepth), readbackBytes);
+	/// end - export target and the readback buffers
+
+	_offscreenFramebuffer = exportFramebuffer;
+	_width = _height = tileSize;
+
+	size_t					tilesAcross = (width + tileSize - 1) / tileSize;
+	size_t					strips = (height + tileSize - 1) / tileSize;
+	size_t					unsettledSquares = 0;
+	vector<unsigned char>	strip(tileSize * width * 3); // the only full width buffer
+	bool					written = complete;
+
+	/// square col of the strip from its pixel buffer; gl rows are bottom up, the file's top down
+	auto collectSquare = [&](size_t col, size_t stripRows)
+	{
+		size_t	slot = col % 2;
+		size_t	columns = min(tileSize, width - col * tileSize);
+
+		while (glClientWaitSync(readbackFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED)
+			;
+
+		glDeleteSync(readbackFences[slot]);
+		readbackFences[slot] = 0;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[slot]);
+
+		const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readbackBytes, GL_MAP_READ_BIT);
+
+		if (pixels)
+		{
+			for (size_t row = 0; row < stripRows; row++)
+			{
+				PixelKernels::contractRGBAToRGB(pixels + (tileSize - 1 - row) * tileSize * 4, columns,
+												&strip[(row * width + col * tileSize) * 3]);
+			}
+
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		else
+			written = false;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	};
+	///
+
+	for (size_t stripIndex = 0; stripIndex < strips && written; stripIndex++)
+	{
+		size_t stripRows = min(tileSize, height - stripIndex * tileSize);
+
+		for (size_t col = 0; col < tilesAcross; col++)
+		{
+			/// the square's window into the output, in normalized device coordinates; squares of
+			/// the last row and column reach past the output, that part is not kept
+			float x0 = 2.0f * (float)(col * tileSize) / (float)width - 1.0f;
+			float x1 = 2.0f * (float)((col + 1) * tileSize) / (float)width - 1.0f;
+			float y1 = 1.0f - 2.0f * (float)(stripIndex * tileSize) / (float)height;
+			float y0 = 1.0f - 2.0f * (float)((stripIndex + 1) * tileSize) / (float)height;
+
+			glm::mat4 crop = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / (x1 - x0), 2.0f / (y1 - y0), 1.0f)) *
+							 glm::translate(glm::mat4(1.0f), glm::vec3(-(x0 + x1) / 2.0f, -(y0 + y1) / 2.0f, 0.0f));
+
+			_projection = crop * projection;
+			_view = view;
+			_model = model;
+			///
+
+			/// settle: select and stream until the lod finds every tile it wants
+			chrono::steady_clock::time_point settleStart = chrono::steady_clock::now();
+
+			_feedbackStale = true;
+
+			while (true)
+			{
+				selectTiles();
+
+				bool settled = _missingTiles.empty() && !(_virtualTexture.isInitialized() && (_feedbackStale || _virtualTexture.isFeedbackPending()));
+
+				if (settled)
+					break;
+
+				if (chrono::duration<double>(chrono::steady_clock::now() - settleStart).count() > _renderSettings.exportSettleSeconds)
+				{
+					unsettledSquares++;
+					break;
+				}
+
+				streamTiles();
+
+				glFlush();
+				this_thread::sleep_for(chrono::milliseconds(1)); // the loads run on the job system
+			}
+
+			streamTiles(); // the page table of the virtual texture follows the last arrivals
+			///
+
+			glViewport(0, 0, (GLsizei)tileSize, (GLsizei)tileSize);
+
+			renderPass(); // into _offscreenFramebuffer, the export target
+
+			/// readback in the background, the last square is collected meanwhile
+			size_t slot = col % 2;
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[slot]);
+			glReadPixels(0, 0, (GLsizei)tileSize, (GLsizei)tileSize, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+			if (col > 0)
+				collectSquare(col - 1, stripRows);
+			///
+		}
+
+		collectSquare(tilesAcross - 1, stripRows);
+
+		written = written && writer.writeRows(strip.data(), stripRows);
+
+		cout << __FUNCTION__ << " strip " << stripIndex + 1 << " of " << strips << endl;
+	}
+
+	/// back to the window
+	for (GLsync& fence : readbackFences)
+	{
+		if (fence != 0)
+			glDeleteSync(fence);
+	}
+
+	MemoryTracker::getInstance().releaseOwner(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, exportColor));
+	MemoryTracker::getInstance().releaseOwner(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_RENDERBUFFER, exportDepth));
+
+	for (GLuint buffer : readbackBuffers)
+		MemoryTracker::getInstance().releaseOwner(MEMORY_RENDER_TARGETS, MemoryTracker::getGLOwner(GL_BUFFER, buffer));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, windowFramebuffer);
+	glDeleteFramebuffers(1, &exportFramebuffer);
+	glDeleteRenderbuffers(1, &exportColor);
+	glDeleteRenderbuffers(1, &exportDepth);
+	glDeleteBuffers(2, readbackBuffers);
+
+	_offscreenFramebuffer = windowFramebuffer;
+	_width = windowWidth;
+	_height = windowHeight;
+	_projection = windowProjection;
+	_frameStats = windowFrameStats;
+	_motionPredictor = windowMotion;
+	_qualityController = windowQuality;
+
+	applyQualityLevel();
+
+	glViewport(0, 0, (GLsizei)_width, (GLsizei)_height);
+
+	requestRedraw(true);
+	///
+
+	logGLError(__FUNCTION__);
+
+	if (!written)
+	{
+		cout << __FUNCTION__ << "Error, export to " << filename << " failed" << endl;
+
+		writer.abort();
+		return false;
+	}
+
+	if (unsettledSquares > 0)
+		cout << __FUNCTION__ << " " << unsettledSquares << " squares did not get all their tiles in time, coarser tiles stand in" << endl;
+
+	return writer.finish();
+}
+
+/// the export of the 'X' key, between two frames; it blocks the window until export.tif is
+/// written, the keys pressed meanwhile are dropped and not replayed once it is done
+///
+void GLApplication::runPendingExport()
+{
+	_exportPending = false;
+	_exportRunning = true;
+
+	LogStream() << __FUNCTION__ << " exporting the view, the window does not respond until it is written" << endl;
+
+	exportView("export.tif", _width * _renderSettings.exportScale, _height * _renderSettings.exportScale);
+
+	glfwPollEvents(); // the events queued meanwhile, presses are ignored by handleKey()
+
+	_exportRunning = false;
+
+	requestRedraw(true);
 }
 
 void
@@ -521,191 +2272,209 @@ GLApplication::run()
 	else
 	{
 		glfwShowWindow(_glWindow);
+		glfwSwapBuffers(_glWindow); // swap the buffer to display it
 
-		while (!glfwWindowShouldClose(_glWindow))
-		{
-			glfwSwapBuffers(_glWindow); // swap the buffer to display it
-			glfwPollEvents();           // handle next key press event
+		std::cout << __FUNCTION__ << " not rendering, press ESC to exit ..." << endl;
 
-			std::this_thread::sleep_for (std::chrono::seconds(1));	
-			std::cout << __FUNCTION__ << " not rendering, press ESC to exit ..." << endl;
-		}
+		while (!glfwWindowShouldClose(_glWindow))
+			glfwWaitEvents(); // blocks until the next event, ESC closes the window
 	}
 
 	std::cout << __FUNCTION__ << " done running, exiting..." << endl;
 }
 
-void GLApplication::moveCameraForward()
+/// the home pose goes straight to the render thread's copy, the camera thread is not running yet
+///
+void GLApplication::gotoHomePositionAndView()
 {
-	// in enu coord sys
-	_cameraPos.x += _configuration.getKeyPressIncrement();
-}
+	_cameraController.goHome();
 
-void GLApplication::moveCameraBackward()
-{
-	// in enu coord sys
-	_cameraPos.x -= _configuration.getKeyPressIncrement();
+	consumeCameraState();
 }
 
-void GLApplication::moveCameraLeft()
+/// takes the newest camera the camera thread published, if any
+///
+bool GLApplication::consumeCameraState()
 {
-	// in enu coord sys
-	_cameraPos.y -= _configuration.getKeyPressIncrement();
+	CameraState camera;
+
+	if (!_cameraController.consume(camera))
+		return false;
+
+	_cameraPos = camera.position;
+	_cameraDir = camera.direction;
+	_rotationAngle = camera.rotationAngle;
+	_projectionOrtho = camera.projectionOrtho;
+	_cameraJumps = camera.jumps;
+
+	_viewChanged = true;
+
+	return true;
 }
 
-void GLApplication::moveCameraRight()
+void GLApplication::printFrameStats()
 {
-	// in enu coord sys
-	_cameraPos.y += _configuration.getKeyPressIncrement();
+	LogStream() << __FUNCTION__ << " frame: " << _frameStats.frameCount
+		 << " visible tiles: " << _frameStats.visibleTiles
+		 << " culled tiles: " << _frameStats.culledTiles
+		 << " finest level: " << _frameStats.finestLevel
+		 << " tile draw calls: " << _frameStats.tileDrawCalls
+		 << " uploaded tiles: " << _tileStreamer.getUploadedTileCount()
+		 << " (of " << _tilePyramid.getNodeCount() << ")" << endl;
+
+	printQualityLevel();
+	printResidencyStats();
 }
 
-void GLApplication::moveCameraUp()
+void GLApplication::printQualityLevel()
 {
-	_cameraPos.z += _configuration.getKeyPressIncrement();
+	const QualityLevel& level = _qualityController.getLevel();
+
+	LogStream quality;
+
+	quality << __FUNCTION__ << " quality: " << level.name << " (" << _qualityController.getLevelIndex() << " of " << QualityController::getLevelCount() - 1 << ")";
+
+	if (_qualityController.isEnabled())
+		quality << " frame: " << _qualityController.getAverageFrameMs() << " ms (target " << _qualityController.getTargetFrameMs() << " ms)";
+	else
+		quality << " (adaptive quality off)";
+
+	quality << " lod error: " << getLodErrorThreshold() << " anisotropy: " << _tileTextureStore.getAnisotropy()
+			<< " far: " << _configuration.getFar() * level.farScale << " hud interval: " << level.hudIntervalSeconds << " s"
+			<< " changes: " << _qualityController.getLevelChanges() << endl;
 }
 
-void GLApplication::moveCameraDown()
+float GLApplication::getLodErrorThreshold()
 {
-	_cameraPos.z -= _configuration.getKeyPressIncrement();
+	return _renderSettings.lodErrorThreshold * _qualityController.getLevel().lodErrorScale;
 }
 
-void GLApplication::updateHeading()
+/// the parts of a quality level that live in gl state; lod, far plane and hud interval are read
+/// where they are used
+///
+void GLApplication::applyQualityLevel()
 {
-	// xy plane
-	_cameraDir.x = cos(glm::radians(_rotationAngle));
-	_cameraDir.y = sin(glm::radians(_rotationAngle));
-	_cameraDir.z = 0.0f;
-	//
+	_tileTextureStore.setAnisotropy(_qualityController.getLevel().maxAnisotropy);
 
-	_cameraDir = glm::normalize(_cameraDir);
+	if (_renderSettings.virtualTexturing && _virtualTextureShader)
+		_virtualTextureShader->setLodErrorThreshold(getLodErrorThreshold());
 
-	cout << __FUNCTION__ << " _rotationAngle: " << _rotationAngle << endl;
-	cout << __FUNCTION__ << " camera Dir: " << _cameraDir.x << ", " << _cameraDir.y << ", "  
-		 << _cameraDir.z << endl << endl;
+	printQualityLevel();
 }
 
-void GLApplication::rotateViewLeft()
+/// the cpu side tables of the scene; their capacity stays with the next, smaller scene
+///
+void GLApplication::trackSceneTables()
 {
-	_rotationAngle += _configuration.getRotationAngleIncrement();
-	updateHeading();
+	MemoryTracker& tracker = MemoryTracker::getInstance();
+
+	tracker.releaseOwner(MEMORY_SCENE_TABLES, (uint64_t)(uintptr_t)&_tilePyramid);
+	tracker.releaseOwner(MEMORY_SCENE_TABLES, (uint64_t)(uintptr_t)&_tileTable);
+
+	tracker.allocate(MEMORY_SCENE_TABLES, (uint64_t)(uintptr_t)&_tilePyramid, _tilePyramid.getReservedBytes());
+	tracker.allocate(MEMORY_SCENE_TABLES, (uint64_t)(uintptr_t)&_tileTable, _tileTable.getReservedBytes());
 }
 
-void GLApplication::rotateViewRight()
+void GLApplication::printResidencyStats()
 {
-	_rotationAngle -= _configuration.getRotationAngleIncrement();
-	updateHeading();
+	const TileResidencyStats& stats = _tileResidency.getStats();
+
+	size_t lookups = stats.hits + stats.misses;
+
+	LogStream() << __FUNCTION__ << " resident tiles: " << _tileResidency.getResidentCount() << " / " << _tileResidency.getMaxResidentCount()
+		 << " (" << _tileResidency.getBudgetBytes() / (1024 * 1024) << " MB budget)"
+		 << " hits: " << stats.hits << " misses: " << stats.misses
+		 << " hit rate: " << (lookups > 0 ? 100.0 * stats.hits / lookups : 100.0) << "%"
+		 << " evictions: " << stats.evictions 
+		 << " loads: " << stats.loadsCompleted << " / " << stats.loadRequests 
+		 << " in flight: " << _tileResidency.getInFlightCount() 
+		 << " prefetched: " << stats.prefetchRequests << " hit rate: " << 100.0 * stats.getPrefetchHitRate() << "%"
+		 << " (" << stats.prefetchHits << " in time, " << stats.prefetchLate << " late, " << stats.prefetchWasted << " wasted)" << endl;
 }
 
-void GLApplication::gotoHomePositionAndView()
+void GLApplication::switchFrameTiming()
 {
-	_cameraPos = _configuration.getCameraInitialPos();
-	_cameraDir = _configuration.getCameraInitialDir();
-
-	if (_cameraDir.x == 0.0f) // TODO: use fuzzy logic to 
-	{
-		_rotationAngle = 90.0;
-	}
-	else
-	{
-		// TODO: test this logic
-		float tanValue = _cameraDir.x / _cameraDir.z;
-		_rotationAngle = glm::degrees(atan(tanValue));
-	}	
+	if (_profiler.isEnabled())
+		_profiler.printSummary();
 
-	updateHeading();
+	_profiler.setEnabled(!_profiler.isEnabled());
 }
 
-void GLApplication::switchProjection()
+void GLApplication::switchTimingOverlay()
 {
-	_projectionOrtho = !_projectionOrtho;
+	_profiler.setOverlayEnabled(!_profiler.isOverlayEnabled());
+
+	if (_profiler.isOverlayEnabled() && !_profiler.isEnabled())
+		_profiler.setEnabled(true);
 }
 
-void GLApplication::printHelp()
+void GLApplication::exportFrameTiming()
 {
-	cout << "------------------------ help ---------------------------------" << endl;
-	cout << "Key press events:" << endl;
-	cout << "'ESC': end the application" << endl << endl; 
-	cout << "' ' : (space bar) toggles between orthographic and perspective projection" << endl;
-	cout << "'L' : rotate clockwise by 10 degrees" << endl;
-	cout << "'R' : rotate counter clockwise by 10 degrees" << endl << endl;
-    cout << "Additional key press events to help in debugging..." << endl;
-	cout << "'H' : reset the view to home position" << endl;
-	cout << "'B' : toggle displaying triangle boundaries (the black lines)"  << endl;
-	cout << "'W' : advances the camera NORTH"  << endl;
-	cout << "'S' : advances the camera SOUTH"  << endl;
-	cout << "'A' : advances the camera WEST"  << endl;
-	cout << "'D' : advances the camera EAST"  << endl;
-	cout << "'Q' : advances the camera UP"  << endl;
-	cout << "'S' : advances the camera DOWN"  << endl << endl;
-	cout << "'P' : print this help"  << endl;
-	cout << "==============================================================" << endl << endl;
+	_profiler.writeCsv("frame_timing.csv");
+	_profiler.writeChromeTrace("frame_timing_trace.json");
 }
-/////////////////////////////////////////////////////////////////////////////////
 
-/////////////////////////////////////////////////////////////////////////////////
-/// TODO: redo this function use: std::function() or something like that
-/////////////////////////////////////////////////////////////////////////////////
-void processKeyEvent(GLFWwindow* window, int key, int scan, int action, int mods)
+void GLApplication::handleKey(int key, bool pressed)
 {
-	if (action == GLFW_RELEASE || __glApp == NULL)
+	/// nothing is pressed while an export runs, releases still go through so no key stays held
+	if (_exportRunning && pressed)
+		return;
+	///
+
+	/// navigation goes to the camera thread, or is applied right away without it (benchmark)
+	if (CameraController::isCameraKey(key))
+	{
+		if (_cameraController.isRunning())
+			_cameraController.keyEvent(key, pressed);
+		else if (pressed)
+			_cameraController.step(vector<int>(1, key));
+
+		return;
+	}
+	///
+
+	if (!pressed || _exportRunning)
 		return;
 
+	requestRedraw(true); // every key changes the view or what is shown
+
 	switch (key) 
 	{
-		case GLFW_KEY_W:
-			__glApp->moveCameraForward();
-		break;
-		
-		case GLFW_KEY_S:
-			__glApp->moveCameraBackward();
-		break;
-		
-		case GLFW_KEY_A:
-			__glApp->moveCameraLeft();
-		break;
-		
-		case GLFW_KEY_D:
-			__glApp->moveCameraRight();
+		case GLFW_KEY_B:
+			switchTileBoundariesRendering();
 		break;
 
-		case GLFW_KEY_ESCAPE:
-			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		case GLFW_KEY_P:
+			printHelp();
 		break;
 
-		case GLFW_KEY_Q:
-		case GLFW_KEY_UP:
-			__glApp->moveCameraUp();
-		break;
-	
-		case GLFW_KEY_Z:
-		case GLFW_KEY_DOWN:
-			__glApp->moveCameraDown();
+		case GLFW_KEY_F:
+			printFrameStats();
 		break;
-		
-		case GLFW_KEY_L:
-			__glApp->rotateViewLeft();
+
+		case GLFW_KEY_T:
+			switchFrameTiming();
 		break;
 
-		case GLFW_KEY_RIGHT:
-		case GLFW_KEY_R:
-			__glApp->rotateViewRight();
+		case GLFW_KEY_O:
+			switchTimingOverlay();
 		break;
 
-		case GLFW_KEY_LEFT:
-		case GLFW_KEY_SPACE:
-			__glApp->switchProjection();
+		case GLFW_KEY_E:
+			exportFrameTiming();
 		break;
 
-		case GLFW_KEY_H:
-			__glApp->gotoHomePositionAndView();
+		case GLFW_KEY_N:
+			if (_sceneFilenames.size() > 1)
+				swapScene(_sceneFilenames[(_currentScene + 1) % _sceneFilenames.size()]);
 		break;
 
-		case GLFW_KEY_B:
-			__glApp->switchTileBoundariesRendering();
+		case GLFW_KEY_M:
+			MemoryTracker::getInstance().printBreakdown("current");
 		break;
 
-		case GLFW_KEY_P:
-			__glApp->printHelp();
+		case GLFW_KEY_X:
+			_exportPending = true; // the render loop runs it, not this callback
 		break;
 
 
@@ -714,4 +2483,65 @@ void processKeyEvent(GLFWwindow* window, int key, int scan, int action, int mods
 		break;
 	}
 }
+
+void GLApplication::printHelp()
+{
+	LogStream help; // one block, not interleaved with other output
+
+	help << "------------------------ help ---------------------------------" << endl;
+	help << "Key press events:" << endl;
+	help << "'ESC': end the application" << endl << endl; 
+	help << "' ' : (space bar) toggles between orthographic and perspective projection" << endl;
+	help << "'L' : rotate clockwise while held" << endl;
+	help << "'R' : rotate counter clockwise while held" << endl << endl;
+	help << "Additional key press events to help in debugging..." << endl;
+	help << "'H' : reset the view to home position" << endl;
+	help << "'B' : toggle displaying triangle boundaries (the black lines)"  << endl;
+	help << "'W' : moves the camera NORTH while held"  << endl;
+	help << "'S' : moves the camera SOUTH while held"  << endl;
+	help << "'A' : moves the camera WEST while held"  << endl;
+	help << "'D' : moves the camera EAST while held"  << endl;
+	help << "'Q' : moves the camera UP while held"  << endl;
+	help << "'Z' : moves the camera DOWN while held"  << endl << endl;
+	help << "'F' : print the frame stats (visible and culled tiles)"  << endl;
+	help << "'T' : toggle the per pass frame timing (printed when switched off)"  << endl;
+	help << "'O' : toggle the frame timing overlay"  << endl;
+	help << "'E' : export the frame timing to frame_timing.csv and frame_timing_trace.json"  << endl;
+	help << "'N' : flip to the next image shown so far, cross faded"  << endl;
+	help << "'M' : print the memory breakdown (current and peak since the last scene build)"  << endl;
+	help << "'X' : export the view to export.tif, at the window size times the export scale (the window waits for it)"  << endl;
+	help << "'P' : print this help"  << endl;
+	help << "==============================================================" << endl << endl;
+}
+/////////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////////
+/// TODO: redo this function use: std::function() or something like that
+/////////////////////////////////////////////////////////////////////////////////
+void processKeyEvent(GLFWwindow* window, int key, int scan, int action, int mods)
+{
+	if (__glApp == NULL)
+		return;
+
+	if (key == GLFW_KEY_ESCAPE)
+	{
+		if (action == GLFW_PRESS)
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+	}
+	else if (action != GLFW_REPEAT || !CameraController::isCameraKey(key)) // held camera keys move on their own
+		__glApp->handleKey(key, action != GLFW_RELEASE);
+}
+/////////////////////////////////////////////////////////////////////////////////
+
+void processResizeEvent(GLFWwindow* window, int width, int height)
+{
+	if (__glApp)
+		__glApp->requestRedraw(true);
+}
+
+void processRefreshEvent(GLFWwindow* window)
+{
+	if (__glApp)
+		__glApp->requestRedraw(); // uncovered, the contents are gone
+}
 /////////////////////////////////////////////////////////////////////////////////
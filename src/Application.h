@@ -5,45 +5,119 @@
 #include "Geometry.h"
 #include "Shader.h"
 #include "Image.h"
+#include "Culling.h"
+#include "TileBatchRenderer.h"
+#include "TileTextureStore.h"
+#include "TileArrayShader.h"
+#include "VirtualTexture.h"
+#include "VirtualTextureShader.h"
+#include "ImageSource.h"
+#include "MosaicImageSource.h"
+#include "TilePyramid.h"
+#include "TileTable.h"
+#include "RenderSettings.h"
+#include "JobSystem.h"
+#include "TileStreamer.h"
+#include "TileResidencyManager.h"
+#include "TileCache.h"
+#include "Benchmark.h"
+#include "FrameProfiler.h"
+#include "CameraController.h"
+#include "MotionPredictor.h"
+#include "AsyncLogger.h"
+#include "MemoryTracker.h"
+#include "QualityController.h"
+#include "TiledTiffWriter.h"
+
+#include <atomic>
+#include <mutex>
 
 using namespace UtilityFunctions;
 using namespace std;
 
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// per frame counters, filled in by the passes
+///
+struct FrameStats
+{
+	size_t	frameCount;
+	size_t	visibleTiles;	// pyramid tiles selected by the cull pass and rendered
+	size_t	culledTiles;	// pyramid tiles rejected by the frustum (subtrees not counted)
+	size_t	finestLevel;	// finest pyramid level drawn, 0 is full resolution
+	size_t	tileDrawCalls;	// draw calls spent on the visible tiles
+	size_t	uploadedTiles;	// tile textures streamed in this frame
+
+	FrameStats() : frameCount(0), visibleTiles(0), culledTiles(0), finestLevel(0), tileDrawCalls(0), uploadedTiles(0) {};
+};
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 class GLApplication
 {
 public:
-	GLApplication(const string& appName, size_t topLeftX = 100, size_t topLeftY = 50, size_t width = 1400, size_t height = 900);
+	/// headless: no display needed, gl comes from egl (or osmesa) and renders into an offscreen
+	/// framebuffer; the application is then driven by runBenchmark() instead of run()
+	GLApplication(const string& appName, size_t topLeftX = 100, size_t topLeftY = 50, size_t width = 1400, size_t height = 900, 
+				  bool headless = false);
 	~GLApplication();
 
 	void printVersionHistory();
 	void printHelp();
 
-	void buildScene(const string& imageFilename); // e.g.: g170204.dat
+	void buildScene(const string& imageFilename); // e.g.: g170204.dat, or a flight.mosaic manifest
+
+	/// replaces the scene while rendering goes on: the new image is opened (or decoded) on a
+	/// load thread, then the tiles on screen stay and fade out over it while it streams in;
+	/// shaders, the camera icon, the texture pages, the upload ring and the tile buffers are all
+	/// reused; a swap asked for while one is loading is dropped
+	void swapScene(const string& imageFilename);
 
 	void run();
 
+	/// replays a camera script (the built in one if scriptFilename is empty) for frameCount frames
+	/// once the scene is loaded, then writes the per pass frame times as json ("-": stdout)
+	bool runBenchmark(const string& scriptFilename, size_t frameCount, const string& reportFilename);
+
+	/// renders the current view at width x height (any size, e.g. 32k x 32k) into a tiled
+	/// BigTIFF; blocking, the render loop stands still meanwhile, memory grows by one strip of
+	/// the output
+	bool exportView(const string& filename, size_t width, size_t height);
+
+	/// the key press / release events, from glfw or a camera script; the camera keys go to the
+	/// CameraController, the others act on press
+	void handleKey(int key, bool pressed = true);
+
+	/// the render loop sleeps while nothing changes; viewChanged also recomputes the matrices
+	void requestRedraw(bool viewChanged = false);
+
 	/// begin - getters / accessors
 	const string	getAppName() { return _appName; };
 	void			getWindowSize(size_t& width, size_t& height);
+	const FrameStats& getFrameStats() { return _frameStats; };
+	const RenderSettings& getRenderSettings() { return _renderSettings; };
 	/// end - getters / accessors
 
 	/// begin - setters
 	void	switchTileBoundariesRendering();
+
+	/// the per frame knobs (upload bytes, lod, quality target, ...) apply from the next frame, the
+	/// scene layout ones (tile budget, compression, virtual texturing, ...) from the next
+	/// buildScene() / swapScene()
+	void	setRenderSettings(const RenderSettings& renderSettings);
 	/// end - setters
 
-	/// begin - very simple navigation interface
-	void	moveCameraForward();
-	void	moveCameraBackward();
-	void	moveCameraLeft();
-	void	moveCameraRight();
-	void	moveCameraUp();
-	void	moveCameraDown();
-	void	rotateViewLeft();
-	void	rotateViewRight();
+	/// navigation itself is in the CameraController, on its own thread while rendering
 	void	gotoHomePositionAndView();
-	void	switchProjection();
-	/// end - very simple navigation interface
+
+	void	printFrameStats();
+	void	printQualityLevel();
+	void	printResidencyStats();
+	void	trackSceneTables();
+
+	/// begin - frame timing
+	void	switchFrameTiming();
+	void	switchTimingOverlay();
+	void	exportFrameTiming(); // frame_timing.csv and frame_timing_trace.json
+	/// end - frame timing
 
 protected:
 	string					_version;
@@ -51,21 +125,109 @@ protected:
 	GLFWwindow*				_glWindow;
 	string					_appName;
 	size_t					_width, _height;
+	bool					_headless;
+
+	/// begin - headless render target, the window has no usable default framebuffer then
+	GLuint					_offscreenFramebuffer;
+	GLuint					_offscreenColor, _offscreenDepth;
+	/// end - headless render target
 	
 	Configuration			_configuration;
-	TileGeometry*			_fullMapGeometry;
-	vector<TileGeometry*>	_tileGeometryObjects;
+	TileGeometry*			_fullMapGeometry;	// downsampled root tile, the source of the overview map
+	GLuint					_fullMapTexture;	// its texture, for the memory accounting
+
+	/// begin - overview map cache, re-rendered on rotation or resize only
+	GLuint					_overviewFramebuffer;
+	GLuint					_overviewColor;
+	GLsizei					_overviewMapWidth;
+	GLsizei					_overviewMapHeight;
+	float					_overviewMapAngle;	// _rotationAngle it was rendered with
+	bool					_overviewMapDirty;
+	chrono::steady_clock::time_point	_overviewMapTime;	// of the last re-render, the quality level spaces them out
+	/// end - overview map cache
+
+	TileTable				_tileTable;		// bounding boxes, textures and flags of all pyramid nodes, by node index
 	CameraGeometry*			_cameraGeometry;
+	GLuint					_cameraIconTexture;	// the geometry's texture, for the memory tracker
 	BasicShader*			_basicShader;
 
+	RenderSettings			_renderSettings;
+	JobSystem				_jobSystem;		// cpu side scene work, never touches gl
+	TilePyramid				_tilePyramid;	// all levels of tiles, level 0 is the full resolution
+	Frustum					_frustum;
+	vector<size_t>			_visibleTiles;	// pyramid node indices, output of cullPass
+	FrameStats				_frameStats;
+	FrameProfiler			_profiler;		// per pass cpu / gpu timing, off by default
+	QualityController		_qualityController;	// render loop only, the benchmark runs at full quality
+
+	TileBatchRenderer		_tileBatchRenderer;		// one batch tile per pyramid node, same indices
+	TileTextureStore		_tileTextureStore;		// texture array pages holding the tile textures
+	TileArrayShader*		_tileArrayShader;
+	bool					_renderTileBoundaries;
+
+	/// begin - virtual texturing, RenderSettings::virtualTexturing
+	VirtualTexture			_virtualTexture;
+	VirtualTextureShader*	_virtualTextureShader;
+	vector<size_t>			_feedbackTiles;		// nodes the last collected feedback wanted
+	bool					_feedbackStale;		// the view changed since the last feedback pass
+	/// end - virtual texturing
+
+	/// begin - scene swap, the tiles of the last scene fade out over the new one
+	TileBatchRenderer		_fadingBatchRenderer;	// quads of the tiles on screen at the swap, their layers are held until the fade ends
+	vector<size_t>			_fadingTiles;			// all of its tiles
+	bool					_fadeStarted;			// the new scene has its root tile
+	chrono::steady_clock::time_point	_fadeStart;
+	vector<string>			_sceneFilenames;		// images shown so far, 'N' flips through them
+	size_t					_currentScene;
+	thread					_sceneLoadThread;		// opens the source of the image swapped in
+	atomic<bool>			_sceneLoaded;			// it is done, the next frame takes the source
+	bool					_sceneLoadSucceeded;	// published with _sceneLoaded, false: the current scene stays
+	string					_loadingScene;			// file name, empty while no swap is loading
+	ImageSource*			_loadedImageSource;
+	ImageBuffer*			_loadedFullMapBuffer;
+	TileCache*				_loadedTileCache;
+	/// end - scene swap
+
+	/// begin - tiles are cut on a background thread and streamed in while rendering
+	ImageSource*			_imageSource;
+	ImageBuffer*			_fullMapBuffer;		// only when the image could not be mapped
+	TileCache*				_tileCache;			// prebuilt tiles, the image is not opened at all then
+	thread					_sceneBuildThread;
+	atomic<bool>			_cancelSceneBuild;
+	atomic<bool>			_sceneBuildFinished;	// every tile is queued (eager build) or there is no build thread
+	bool					_eagerBuild;			// the build thread queues every tile, until they are all uploaded
+	TileStreamer			_tileStreamer;
+	TileResidencyManager	_tileResidency;		// which pyramid nodes have a texture, within the budget
+	vector<size_t>			_missingTiles;		// nodes the lod wanted this frame but are not resident
+	MotionPredictor			_motionPredictor;	// camera a few frames ahead, for the prefetch
+	vector<size_t>			_prefetchTiles;		// lod of the predicted camera
+	vector<size_t>			_prefetchMissing;	// the part of it that is not resident
+	JobCounter				_tileLoads;			// reload jobs in flight, they read _imageSource / _tileCache
+	mutex					_failedLoadsLock;
+	vector<size_t>			_failedLoads;		// reloads that queued nothing, handed back to the residency on the gl thread
+
+	mutex					_overviewLock;
+	vector<unsigned char>	_overviewPixels;	// root tile pixels, handed over by the build thread
+	atomic<bool>			_overviewPending;
+	/// end - tiles are cut on a background thread and streamed in while rendering
+
 	glm::vec3				_bbLL, _bbUR; // bound box extents
+
+	/// begin - camera, the render thread's copy of the last CameraState it consumed
+	CameraController		_cameraController;
 	glm::vec3				_cameraPos, _cameraDir; // camera related
 	bool					_projectionOrtho;
+	float					_rotationAngle; // in degrees
+	size_t					_cameraJumps;	// CameraState::jumps
+	/// end - camera
+
 	glm::mat4				_projection;
 	glm::mat4				_model;
 	glm::mat4				_view;
 	glm::mat4				_toEnu;
-	float					_rotationAngle; // in degrees
+	glm::mat4				_hudProjection;			// ortho map projection, camera icon and overview
+	glm::mat4				_hudView;				// rotated map view of the overview
+	glm::mat4				_cameraIconModelView;	// ortho projection only
 
 	glm::vec3				_xAxis;
 	glm::vec3				_yAxis;
@@ -73,16 +235,66 @@ protected:
 
 	bool					_readyToRun;
 
+	/// begin - frame scheduling, a frame is only rendered when something changed
+	atomic<bool>			_viewChanged;	// camera, heading, projection or viewport; matrices are stale
+	atomic<bool>			_redrawNeeded;	// the picture changed: tiles arrived, a toggle...
+	bool					_exportPending;	// 'X' was pressed, the loop runs the export before the next frame
+	bool					_exportRunning;	// key presses are dropped
+	/// end - frame scheduling
+
 	void	initStates();
-	void	release();
+	void	release();	// the scene only, see releasePersistentObjects()
+	void	createPersistentObjects();
+	void	releasePersistentObjects();
+	void	retireVisibleTiles();
+	void	releaseFadingTiles();
+	void	updateCrossfade();
+	float	getCrossfadeAlpha();
+	float	getLodErrorThreshold();	// of the current quality level
+	void	applyQualityLevel();
 	void	computeMatrices();
-	void	updateHeading();
+	void	getSceneMatrices(const glm::vec3& cameraPosition, const glm::vec3& cameraDirection, float rotationAngle, bool ortho,
+							 glm::mat4& projection, glm::mat4& view, glm::mat4& model);
+	bool	consumeCameraState();
 	void	computeBoundingBox();
+	void	buildTilePixels();	// scene build thread
+	void	readCachedTiles();	// scene build thread, with a tile cache
+	TileCache*	openTileCache(const string& imageFilename);
+	TileCompression	getTileCompression();
+	bool	openSceneSource(const string& imageFilename, ImageSource*& imageSource, ImageBuffer*& fullMapBuffer, TileCache*& tileCache);
+	void	setupScene(const string& imageFilename);
+	void	loadSceneSource(string imageFilename);	// scene load thread
+	void	finishSceneSwap();
+	void	loadTile(size_t node);	// reload of one tile on the job system
+	void	loadFailed(size_t node);	// job system, the tile will never arrive
+	void	releaseFailedLoads();		// gl thread
+	bool	queueTile(size_t node, const unsigned char* pixels, bool parallel); // compresses, if enabled
+	void	evictTile(size_t node);
+	void	stopSceneBuild();
+	bool	isEagerBuildPending();
+	GLuint	createOverviewTexture(const vector<unsigned char>& tilePixels, size_t tileSize, size_t width, size_t height, size_t maxSize);
+
+	bool	createContext(bool headless);
+	void	createOffscreenFramebuffer();
+	void	releaseOffscreenFramebuffer();
+
+	void	updateOverviewMap();
+	void	releaseOverviewMap();
+
+	bool	isFrameNeeded();
+	bool	wakeRenderLoop();
+	void	runPendingExport();
 
 	void	startRendering();
+	void	renderFrame(BenchmarkRecorder* recorder = NULL); // all passes, timed per pass with a recorder
 	void	updatePass();
 	void	cullPass();
+	size_t	selectTiles();
+	size_t	selectVirtualPages();
+	size_t	coarsenFeedback(size_t capacity);
+	void	prefetchTiles();
 	void	preRenderPass();
+	void	streamTiles();
 	void	renderPass();
 	void	postRenderPass();
 };
\ No newline at end of file
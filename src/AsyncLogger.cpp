@@ -0,0 +1,99 @@
+#include "AsyncLogger.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+AsyncLogger& AsyncLogger::getInstance()
+{
+	static AsyncLogger logger;
+
+	return logger;
+}
+
+AsyncLogger::AsyncLogger()
+{
+	_writing = false;
+	_stop = false;
+	_droppedLines = 0;
+	_reportedDrops = 0;
+}
+
+AsyncLogger::~AsyncLogger()
+{
+	{
+		lock_guard<mutex> guard(_lock);
+
+		_stop = true;
+	}
+
+	_queued.notify_one();
+
+	if (_thread.joinable())
+		_thread.join(); // writes out what is left
+}
+
+void AsyncLogger::write(const string& text)
+{
+	{
+		lock_guard<mutex> guard(_lock);
+
+		if (_lines.size() >= MAX_QUEUED)
+		{
+			_droppedLines++;
+			return;
+		}
+
+		_lines.push_back(text);
+
+		if (!_thread.joinable())
+			_thread = thread(&AsyncLogger::writerLoop, this);
+	}
+
+	_queued.notify_one();
+}
+
+void AsyncLogger::flush()
+{
+	unique_lock<mutex> guard(_lock);
+
+	_written.wait(guard, [this] { return (_lines.empty() && !_writing) || !_thread.joinable(); });
+}
+
+void AsyncLogger::writerLoop()
+{
+	deque<string> lines;
+
+	unique_lock<mutex> guard(_lock);
+
+	while (true)
+	{
+		_queued.wait(guard, [this] { return _stop || !_lines.empty(); });
+
+		if (_lines.empty())
+			break; // stopping, and all is written
+
+		/// take all of it, the writers only wait for the swap
+		lines.swap(_lines);
+		_writing = true;
+
+		size_t dropped = _droppedLines - _reportedDrops;
+
+		_reportedDrops = _droppedLines;
+		///
+
+		guard.unlock();
+
+		if (dropped > 0)
+			cout << "AsyncLogger: " << dropped << " lines dropped" << endl;
+
+		for (const string& line : lines)
+			cout << line;
+
+		cout.flush();
+		lines.clear();
+
+		guard.lock();
+
+		_writing = false;
+		_written.notify_all();
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// console output off the calling thread
+///		- write() only queues the text, a logger thread does the (slow) console i/o, so a frame
+///		  or the camera thread never waits for the terminal
+///		- lines beyond MAX_QUEUED are dropped and counted, the next written line reports them
+///		- one process wide instance, its thread starts with the first write(); flush() waits
+///		  until everything queued so far is out
+///		- mixes with plain cout, but the order between the two is then not kept
+///
+class AsyncLogger
+{
+public:
+	static AsyncLogger&	getInstance();
+
+	void	write(const string& text);
+	void	flush();
+
+	/// begin - getters / accessors
+	size_t	getDroppedLineCount() { return _droppedLines; };
+	/// end - getters / accessors
+
+protected:
+	static const size_t MAX_QUEUED = 4096;
+
+	AsyncLogger();
+	~AsyncLogger();
+
+	mutex				_lock;
+	condition_variable	_queued;	// new text, or stopping
+	condition_variable	_written;	// the queue ran empty, for flush()
+	deque<string>		_lines;
+	bool				_writing;	// the logger thread holds lines taken off the queue
+	bool				_stop;
+	size_t				_droppedLines;
+	size_t				_reportedDrops;
+	thread				_thread;
+
+	void	writerLoop();
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// one log message, streamed like cout and handed to the AsyncLogger when it goes out of scope
+///		e.g.: LogStream() << __FUNCTION__ << " angle: " << angle << endl;
+///
+class LogStream
+{
+public:
+	~LogStream() { AsyncLogger::getInstance().write(_text.str()); };
+
+	template <class T>
+	LogStream& operator<<(const T& value) { _text << value; return *this; };
+
+	LogStream& operator<<(ostream& (*manipulator)(ostream&)) { _text << manipulator; return *this; };
+
+protected:
+	ostringstream	_text;
+};
@@ -0,0 +1,265 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+//////////////////////////////////////////////////////////////////////////////////
+bool CameraScript::load(const string& filename)
+{
+	ifstream input(filename);
+
+	if (!input.is_open())
+	{
+		cout << __FUNCTION__ << "Error, camera script " << filename << " not found" << endl;
+		return false;
+	}
+
+	_steps.clear();
+	_frameCount = 0;
+
+	string	line;
+	size_t	lineNumber = 0;
+
+	while (getline(input, line))
+	{
+		lineNumber++;
+
+		line = line.substr(0, line.find('#'));
+
+		if (line.find_first_not_of(" \t\r") == string::npos)
+			continue;
+
+		Step step;
+
+		if (!parseStep(line, step))
+		{
+			cout << __FUNCTION__ << "Error, " << filename << " line " << lineNumber << ": " << line << endl;
+			return false;
+		}
+
+		_steps.push_back(step);
+		_frameCount += step.frames;
+	}
+
+	cout << __FUNCTION__ << " " << filename << ": " << _steps.size() << " steps, " << _frameCount << " frames" << endl;
+
+	return _frameCount > 0;
+}
+
+void CameraScript::loadDefault()
+{
+	static const char* flight[] =
+	{
+		"30 -",			// settle at home
+		"120 W",		// north
+		"18 L",			// half a turn
+		"60 WD",		// north east
+		"40 Q",			// climb
+		"1 space",		// perspective <-> ortho
+		"90 S",
+		"18 R",
+		"60 A",
+		"40 Z",			// descend
+		"1 space",
+		"1 H"
+	};
+
+	_steps.clear();
+	_frameCount = 0;
+
+	for (const char* line : flight)
+	{
+		Step step;
+
+		parseStep(line, step);
+
+		_steps.push_back(step);
+		_frameCount += step.frames;
+	}
+}
+
+bool CameraScript::parseStep(const string& line, Step& step)
+{
+	istringstream	tokens(line);
+	string			keys;
+
+	if (!(tokens >> step.frames >> keys) || step.frames == 0)
+		return false;
+
+	step.keys.clear();
+
+	if (keys == "-")
+		return true;
+
+	if (keys == "space")
+	{
+		step.keys.push_back(GLFW_KEY_SPACE);
+		return true;
+	}
+
+	for (char key : keys)
+	{
+		switch (toupper(key))
+		{
+			case 'W': step.keys.push_back(GLFW_KEY_W); break;
+			case 'S': step.keys.push_back(GLFW_KEY_S); break;
+			case 'A': step.keys.push_back(GLFW_KEY_A); break;
+			case 'D': step.keys.push_back(GLFW_KEY_D); break;
+			case 'Q': step.keys.push_back(GLFW_KEY_Q); break;
+			case 'Z': step.keys.push_back(GLFW_KEY_Z); break;
+			case 'L': step.keys.push_back(GLFW_KEY_L); break;
+			case 'R': step.keys.push_back(GLFW_KEY_R); break;
+			case 'H': step.keys.push_back(GLFW_KEY_H); break;
+			case 'B': step.keys.push_back(GLFW_KEY_B); break;
+			default: return false;
+		}
+	}
+
+	return true;
+}
+
+void CameraScript::getKeys(size_t frameIndex, vector<int>& keys)
+{
+	keys.clear();
+
+	if (_frameCount == 0)
+		return;
+
+	frameIndex %= _frameCount;
+
+	for (const Step& step : _steps)
+	{
+		if (frameIndex < step.frames)
+		{
+			keys = step.keys;
+			return;
+		}
+
+		frameIndex -= step.frames;
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+void BenchmarkRecorder::record(const string& pass, double milliseconds)
+{
+	vector<double>& samples = _samples[pass];
+
+	if (samples.empty())
+		_passOrder.push_back(pass);
+
+	samples.push_back(milliseconds);
+}
+
+void BenchmarkRecorder::setInfo(const string& key, const string& value)
+{
+	_info.push_back(make_pair(key, quote(value)));
+}
+
+void BenchmarkRecorder::setInfo(const string& key, double value)
+{
+	ostringstream text;
+
+	text << value;
+
+	_info.push_back(make_pair(key, text.str()));
+}
+
+void BenchmarkRecorder::clear()
+{
+	_passOrder.clear();
+	_samples.clear();
+	_info.clear();
+}
+
+string BenchmarkRecorder::quote(const string& text)
+{
+	string quoted = "\"";
+
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+
+		if ((unsigned char)c < 0x20)
+			quoted += ' '; // no control characters in the report
+		else
+			quoted += c;
+	}
+
+	return quoted + "\"";
+}
+
+bool BenchmarkRecorder::writeJson(const string& filename)
+{
+	if (filename == "-")
+	{
+		writeJson(cout);
+		return true;
+	}
+
+	ofstream output(filename);
+
+	if (!output.is_open())
+	{
+		cout << __FUNCTION__ << "Error, can not write " << filename << endl;
+		return false;
+	}
+
+	writeJson(output);
+
+	cout << __FUNCTION__ << " benchmark report written to " << filename << endl;
+
+	return true;
+}
+
+void BenchmarkRecorder::writeJson(ostream& out)
+{
+	out << "{" << endl;
+
+	for (const pair<string, string>& info : _info)
+		out << "  " << quote(info.first) << ": " << info.second << "," << endl;
+
+	out << "  \"passes\": {" << endl;
+
+	for (size_t pass = 0; pass < _passOrder.size(); pass++)
+	{
+		vector<double> samples = _samples[_passOrder[pass]];
+
+		sort(samples.begin(), samples.end());
+
+		double sum = 0.0;
+
+		for (double sample : samples)
+			sum += sample;
+
+		/// nearest rank percentiles
+		auto percentile = [&samples](double p)
+		{
+			size_t rank = (size_t)ceil(p / 100.0 * (double)samples.size());
+
+			return samples[rank > 0 ? rank - 1 : 0];
+		};
+		///
+
+		out << fixed << setprecision(4)
+			<< "    " << quote(_passOrder[pass]) << ": { "
+			<< "\"samples\": " << samples.size() << ", "
+			<< "\"min_ms\": " << samples.front() << ", "
+			<< "\"mean_ms\": " << sum / (double)samples.size() << ", "
+			<< "\"p50_ms\": " << percentile(50.0) << ", "
+			<< "\"p99_ms\": " << percentile(99.0) << ", "
+			<< "\"max_ms\": " << samples.back() << " }"
+			<< (pass + 1 < _passOrder.size() ? "," : "") << endl;
+
+		out << defaultfloat;
+	}
+
+	out << "  }" << endl;
+	out << "}" << endl;
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+#include <map>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// scripted camera flight, key presses per frame
+///		- one step per line: "<frames> <keys>", the keys are pressed once every frame of the step
+///		- keys are the interactive ones: W S A D Q Z (move), L R (rotate), H (home), B (tile
+///		  boundaries), "space" toggles the projection, "-" is a step without keys
+///		- e.g. "120 W" flies north for 120 frames, "1 space" switches the projection once,
+///		  "36 L" turns a full circle with the default increment
+///		- '#' starts a comment; the script starts over when it is shorter than the benchmark
+///
+class CameraScript
+{
+public:
+	CameraScript() : _frameCount(0) {};
+
+	bool	load(const string& filename);
+	void	loadDefault(); // a short flight that touches every key
+
+	/// GLFW_KEY_* codes to press in frame frameIndex
+	void	getKeys(size_t frameIndex, vector<int>& keys);
+
+	/// begin - getters / accessors
+	size_t	getFrameCount() { return _frameCount; }; // of one pass through the script
+	/// end - getters / accessors
+
+protected:
+	struct Step
+	{
+		size_t		frames;
+		vector<int>	keys;
+	};
+
+	vector<Step>	_steps;
+	size_t			_frameCount;
+
+	bool	parseStep(const string& line, Step& step);
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// per pass time samples of a benchmark run, reported as json
+///		- samples are kept in full, min / mean / p50 / p99 are taken over all of them
+///		- passes come out in the order they were first recorded
+///
+class BenchmarkRecorder
+{
+public:
+	void	record(const string& pass, double milliseconds);
+	void	setInfo(const string& key, const string& value); // top level strings of the report
+	void	setInfo(const string& key, double value);
+
+	bool	writeJson(const string& filename); // "-" writes to stdout
+	void	writeJson(ostream& out);
+
+	void	clear();
+
+protected:
+	vector<string>					_passOrder;
+	map<string, vector<double> >	_samples;
+	vector<pair<string, string> >	_info;	// already json encoded values
+
+	static string	quote(const string& text);
+};
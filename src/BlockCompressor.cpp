@@ -0,0 +1,885 @@
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+/// x86 with gcc / clang: every path of findClosest() is compiled in, each for its own target, and
+/// the widest one the cpu has is picked at run time (as in PixelKernels); elsewhere only the path
+/// the compiler flags enable
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BLOCK_COMPRESSOR_RUNTIME_DISPATCH	1
+#define BLOCK_COMPRESSOR_SSE41				1
+#define BLOCK_COMPRESSOR_AVX2				1
+#define TARGET_SSE41						__attribute__((target("sse4.1")))
+#define TARGET_AVX2							__attribute__((target("avx2")))
+#include <immintrin.h>
+#else
+#define BLOCK_COMPRESSOR_RUNTIME_DISPATCH	0
+#define TARGET_SSE41
+#define TARGET_AVX2
+#if defined(__AVX2__)
+#define BLOCK_COMPRESSOR_SSE41				1
+#define BLOCK_COMPRESSOR_AVX2				1
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#define BLOCK_COMPRESSOR_SSE41				1
+#define BLOCK_COMPRESSOR_AVX2				0
+#include <smmintrin.h>
+#else
+#define BLOCK_COMPRESSOR_SSE41				0
+#define BLOCK_COMPRESSOR_AVX2				0
+#endif
+#endif
+///
+
+//////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+	/// one 4 x 4 block, channel planar so the texels go 4 / 8 to a register
+	struct Block
+	{
+		int	r[16], g[16], b[16], a[16];
+	};
+
+	/// quantized palette, planar as well
+	struct Palette
+	{
+		int		r[16], g[16], b[16], a[16];
+		size_t	size;
+	};
+
+	struct Endpoints
+	{
+		float	e0[4], e1[4];
+	};
+
+	void loadBlock(const unsigned char* rgba, Block& block)
+	{
+		for (size_t i = 0; i < 16; i++)
+		{
+			block.r[i] = rgba[i * 4 + 0];
+			block.g[i] = rgba[i * 4 + 1];
+			block.b[i] = rgba[i * 4 + 2];
+			block.a[i] = rgba[i * 4 + 3];
+		}
+	}
+
+	BlockInstructionSet detectInstructionSet()
+	{
+#if BLOCK_COMPRESSOR_RUNTIME_DISPATCH
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+			return BLOCK_AVX2;
+
+		if (__builtin_cpu_supports("sse4.1"))
+			return BLOCK_SSE41;
+
+		return BLOCK_SCALAR;
+#elif BLOCK_COMPRESSOR_AVX2
+		return BLOCK_AVX2;
+#elif BLOCK_COMPRESSOR_SSE41
+		return BLOCK_SSE41;
+#else
+		return BLOCK_SCALAR;
+#endif
+	}
+
+	BlockInstructionSet& activeInstructionSet()
+	{
+		static BlockInstructionSet active = detectInstructionSet();
+
+		return active;
+	}
+
+	/// begin - index of the nearest palette entry per texel, returns the summed squared error
+	///		- ties go to the lower index on every path, so all of them encode bit identically
+#if BLOCK_COMPRESSOR_AVX2
+	TARGET_AVX2 unsigned int findClosestAVX2(const Block& block, const Palette& palette, unsigned char* indices)
+	{
+		unsigned int error = 0;
+
+		for (size_t i = 0; i < 16; i += 8)
+		{
+			__m256i r = _mm256_loadu_si256((const __m256i*)&block.r[i]);
+			__m256i g = _mm256_loadu_si256((const __m256i*)&block.g[i]);
+			__m256i b = _mm256_loadu_si256((const __m256i*)&block.b[i]);
+			__m256i a = _mm256_loadu_si256((const __m256i*)&block.a[i]);
+
+			__m256i best = _mm256_set1_epi32(INT_MAX);
+			__m256i bestIndex = _mm256_setzero_si256();
+
+			for (size_t p = 0; p < palette.size; p++)
+			{
+				__m256i dr = _mm256_sub_epi32(r, _mm256_set1_epi32(palette.r[p]));
+				__m256i dg = _mm256_sub_epi32(g, _mm256_set1_epi32(palette.g[p]));
+				__m256i db = _mm256_sub_epi32(b, _mm256_set1_epi32(palette.b[p]));
+				__m256i da = _mm256_sub_epi32(a, _mm256_set1_epi32(palette.a[p]));
+
+				__m256i d = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(dr, dr), _mm256_mullo_epi32(dg, dg)),
+											 _mm256_add_epi32(_mm256_mullo_epi32(db, db), _mm256_mullo_epi32(da, da)));
+
+				__m256i closer = _mm256_cmpgt_epi32(best, d);
+
+				best = _mm256_min_epi32(best, d);
+				bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32((int)p), closer);
+			}
+
+			alignas(32) int distances[8], closest[8];
+
+			_mm256_store_si256((__m256i*)distances, best);
+			_mm256_store_si256((__m256i*)closest, bestIndex);
+
+			for (size_t k = 0; k < 8; k++)
+			{
+				indices[i + k] = (unsigned char)closest[k];
+				error += (unsigned int)distances[k];
+			}
+		}
+
+		return error;
+	}
+#endif
+
+#if BLOCK_COMPRESSOR_SSE41
+	TARGET_SSE41 unsigned int findClosestSSE41(const Block& block, const Palette& palette, unsigned char* indices)
+	{
+		unsigned int error = 0;
+
+		for (size_t i = 0; i < 16; i += 4)
+		{
+			__m128i r = _mm_loadu_si128((const __m128i*)&block.r[i]);
+			__m128i g = _mm_loadu_si128((const __m128i*)&block.g[i]);
+			__m128i b = _mm_loadu_si128((const __m128i*)&block.b[i]);
+			__m128i a = _mm_loadu_si128((const __m128i*)&block.a[i]);
+
+			__m128i best = _mm_set1_epi32(INT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+
+			for (size_t p = 0; p < palette.size; p++)
+			{
+				__m128i dr = _mm_sub_epi32(r, _mm_set1_epi32(palette.r[p]));
+				__m128i dg = _mm_sub_epi32(g, _mm_set1_epi32(palette.g[p]));
+				__m128i db = _mm_sub_epi32(b, _mm_set1_epi32(palette.b[p]));
+				__m128i da = _mm_sub_epi32(a, _mm_set1_epi32(palette.a[p]));
+
+				__m128i d = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(dr, dr), _mm_mullo_epi32(dg, dg)),
+										  _mm_add_epi32(_mm_mullo_epi32(db, db), _mm_mullo_epi32(da, da)));
+
+				__m128i closer = _mm_cmplt_epi32(d, best);
+
+				best = _mm_min_epi32(best, d);
+				bestIndex = _mm_blendv_epi8(bestIndex, _mm_set1_epi32((int)p), closer);
+			}
+
+			alignas(16) int distances[4], closest[4];
+
+			_mm_store_si128((__m128i*)distances, best);
+			_mm_store_si128((__m128i*)closest, bestIndex);
+
+			for (size_t k = 0; k < 4; k++)
+			{
+				indices[i + k] = (unsigned char)closest[k];
+				error += (unsigned int)distances[k];
+			}
+		}
+
+		return error;
+	}
+#endif
+
+	unsigned int findClosestScalar(const Block& block, const Palette& palette, unsigned char* indices)
+	{
+		unsigned int error = 0;
+
+		for (size_t i = 0; i < 16; i++)
+		{
+			int best = INT_MAX;
+
+			for (size_t p = 0; p < palette.size; p++)
+			{
+				int dr = block.r[i] - palette.r[p];
+				int dg = block.g[i] - palette.g[p];
+				int db = block.b[i] - palette.b[p];
+				int da = block.a[i] - palette.a[p];
+				int d = dr * dr + dg * dg + db * db + da * da;
+
+				if (d < best)
+				{
+					best = d;
+					indices[i] = (unsigned char)p;
+				}
+			}
+
+			error += (unsigned int)best;
+		}
+
+		return error;
+	}
+
+	unsigned int findClosest(const Block& block, const Palette& palette, unsigned char* indices)
+	{
+		BlockInstructionSet instructionSet = activeInstructionSet();
+
+#if BLOCK_COMPRESSOR_AVX2
+		if (instructionSet >= BLOCK_AVX2)
+			return findClosestAVX2(block, palette, indices);
+#endif
+
+#if BLOCK_COMPRESSOR_SSE41
+		if (instructionSet >= BLOCK_SSE41)
+			return findClosestSSE41(block, palette, indices);
+#endif
+
+		(void)instructionSet;
+
+		return findClosestScalar(block, palette, indices);
+	}
+	/// end - index of the nearest palette entry per texel
+
+	/// endpoints along the principal axis of the block (bounding box diagonal at quality 0)
+	void fitEndpoints(const Block& block, int quality, Endpoints& endpoints)
+	{
+		const int*	channels[4] = { block.r, block.g, block.b, block.a };
+		float		mean[4] = { 0, 0, 0, 0 };
+		float		minimum[4], maximum[4];
+
+		for (size_t c = 0; c < 4; c++)
+		{
+			minimum[c] = maximum[c] = (float)channels[c][0];
+
+			for (size_t i = 0; i < 16; i++)
+			{
+				mean[c] += (float)channels[c][i];
+				minimum[c] = std::min(minimum[c], (float)channels[c][i]);
+				maximum[c] = std::max(maximum[c], (float)channels[c][i]);
+			}
+
+			mean[c] /= 16.0f;
+		}
+
+		if (quality <= 0)
+		{
+			memcpy(endpoints.e0, minimum, sizeof(minimum));
+			memcpy(endpoints.e1, maximum, sizeof(maximum));
+			return;
+		}
+
+		/// covariance, then a few power iterations from the bounding box diagonal
+		float covariance[4][4] = {};
+
+		for (size_t i = 0; i < 16; i++)
+		{
+			float d[4];
+
+			for (size_t c = 0; c < 4; c++)
+				d[c] = (float)channels[c][i] - mean[c];
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				for (size_t k = 0; k < 4; k++)
+					covariance[c][k] += d[c] * d[k];
+			}
+		}
+
+		float axis[4];
+
+		for (size_t c = 0; c < 4; c++)
+			axis[c] = maximum[c] - minimum[c];
+
+		for (size_t iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = { 0, 0, 0, 0 };
+			float length = 0.0f;
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				for (size_t k = 0; k < 4; k++)
+					next[c] += covariance[c][k] * axis[k];
+
+				length = std::max(length, fabsf(next[c]));
+			}
+
+			if (length < 1e-6f)
+				break; // flat block, keep the diagonal
+
+			for (size_t c = 0; c < 4; c++)
+				axis[c] = next[c] / length;
+		}
+		///
+
+		/// extent of the texels along the axis
+		float axisLength = 0.0f;
+
+		for (size_t c = 0; c < 4; c++)
+			axisLength += axis[c] * axis[c];
+
+		if (axisLength < 1e-6f)
+		{
+			memcpy(endpoints.e0, mean, sizeof(mean));
+			memcpy(endpoints.e1, mean, sizeof(mean));
+			return;
+		}
+
+		float tMin = 1e30f, tMax = -1e30f;
+
+		for (size_t i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+
+			for (size_t c = 0; c < 4; c++)
+				t += ((float)channels[c][i] - mean[c]) * axis[c];
+
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+
+		for (size_t c = 0; c < 4; c++)
+		{
+			endpoints.e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMin / axisLength));
+			endpoints.e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMax / axisLength));
+		}
+		///
+	}
+
+	/// least squares endpoints for the given indices, weights[index] in 0..1 from e0 to e1
+	bool refitEndpoints(const Block& block, const unsigned char* indices, const float* weights, Endpoints& endpoints)
+	{
+		const int*	channels[4] = { block.r, block.g, block.b, block.a };
+		float		aa = 0, ab = 0, bb = 0;
+		float		ax[4] = { 0, 0, 0, 0 }, bx[4] = { 0, 0, 0, 0 };
+
+		for (size_t i = 0; i < 16; i++)
+		{
+			float w = weights[indices[i]];
+			float v = 1.0f - w;
+
+			aa += v * v;
+			ab += v * w;
+			bb += w * w;
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				ax[c] += v * (float)channels[c][i];
+				bx[c] += w * (float)channels[c][i];
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+
+		if (fabsf(det) < 1e-6f)
+			return false; // all texels on one index
+
+		for (size_t c = 0; c < 4; c++)
+		{
+			endpoints.e0[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / det));
+			endpoints.e1[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / det));
+		}
+
+		return true;
+	}
+
+	/// little endian bit stream, bc7 blocks are filled lsb first
+	struct BitWriter
+	{
+		unsigned char*	dst;
+		size_t			bit;
+
+		void write(unsigned int value, size_t bits)
+		{
+			for (size_t i = 0; i < bits; i++, bit++)
+			{
+				if ((value >> i) & 1)
+					dst[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+			}
+		}
+	};
+
+	struct BitReader
+	{
+		const unsigned char*	src;
+		size_t					bit;
+
+		unsigned int read(size_t bits)
+		{
+			unsigned int value = 0;
+
+			for (size_t i = 0; i < bits; i++, bit++)
+				value |= (unsigned int)((src[bit >> 3] >> (bit & 7)) & 1) << i;
+
+			return value;
+		}
+	};
+
+	/// bc1
+	unsigned short packRGB565(const float* color)
+	{
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRGB565(unsigned short packed, int* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	/// c0 > c1, so the block is in four color mode
+	unsigned int encodeBC1(const Block& block, const Endpoints& endpoints, unsigned short& c0, unsigned short& c1, unsigned char* indices)
+	{
+		c0 = packRGB565(endpoints.e1);
+		c1 = packRGB565(endpoints.e0);
+
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		if (c0 == c1)
+		{
+			if (c0 == 0xffff)
+				c1--; // keep c0 > c1, one of the two still is the exact color
+			else
+				c0++;
+		}
+
+		int p0[3], p1[3];
+
+		unpackRGB565(c0, p0);
+		unpackRGB565(c1, p1);
+
+		Palette palette;
+
+		palette.size = 4;
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			int* channel = c == 0 ? palette.r : (c == 1 ? palette.g : palette.b);
+
+			channel[0] = p0[c];
+			channel[1] = p1[c];
+			channel[2] = (2 * p0[c] + p1[c]) / 3;
+			channel[3] = (p0[c] + 2 * p1[c]) / 3;
+		}
+
+		for (size_t p = 0; p < 4; p++)
+			palette.a[p] = 255;
+
+		Block opaque = block; // bc1 has no alpha here
+
+		for (size_t i = 0; i < 16; i++)
+			opaque.a[i] = 255;
+
+		return findClosest(opaque, palette, indices);
+	}
+	///
+
+	/// bc7 mode 6
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/// 7 bit endpoint plus the p bit (shared lsb of all four channels) closest to color
+	///		- opaque blocks need p = 1, 255 can not be reached otherwise
+	void quantizeBC7Endpoint(const float* color, bool opaque, int* quantized, int& pBit)
+	{
+		float bestError = 1e30f;
+
+		for (int p = opaque ? 1 : 0; p < 2; p++)
+		{
+			int		q[4];
+			float	error = 0.0f;
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				q[c] = std::min(127, std::max(0, (int)floorf((color[c] - (float)p) / 2.0f + 0.5f)));
+
+				float d = (float)(q[c] * 2 + p) - color[c];
+
+				error += d * d;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, q, sizeof(q));
+			}
+		}
+	}
+
+	unsigned int encodeBC7(const Block& block, const Endpoints& endpoints, int* q0, int* q1, int& p0, int& p1, unsigned char* indices)
+	{
+		bool opaque = true;
+
+		for (size_t i = 0; i < 16; i++)
+			opaque = opaque && block.a[i] == 255;
+
+		quantizeBC7Endpoint(endpoints.e0, opaque, q0, p0);
+		quantizeBC7Endpoint(endpoints.e1, opaque, q1, p1);
+
+		Palette palette;
+
+		palette.size = 16;
+
+		for (size_t c = 0; c < 4; c++)
+		{
+			int* channel = c == 0 ? palette.r : (c == 1 ? palette.g : (c == 2 ? palette.b : palette.a));
+			int  v0 = (q0[c] << 1) | p0;
+			int  v1 = (q1[c] << 1) | p1;
+
+			for (size_t i = 0; i < 16; i++)
+				channel[i] = ((64 - BC7_WEIGHTS[i]) * v0 + BC7_WEIGHTS[i] * v1 + 32) >> 6;
+		}
+
+		return findClosest(block, palette, indices);
+	}
+	///
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+size_t BlockCompressor::getBlockBytes(TileCompression compression)
+{
+	switch (compression)
+	{
+		case TILE_COMPRESSION_BC1:	return 8;
+		case TILE_COMPRESSION_BC7:	return 16;
+		default:					return 0;
+	}
+}
+
+size_t BlockCompressor::getCompressedSize(size_t width, size_t height, TileCompression compression)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * getBlockBytes(compression);
+}
+
+const char* BlockCompressor::getName(TileCompression compression)
+{
+	switch (compression)
+	{
+		case TILE_COMPRESSION_BC1:	return "bc1";
+		case TILE_COMPRESSION_BC7:	return "bc7";
+		default:					return "none";
+	}
+}
+
+const char* BlockCompressor::getInstructionSet()
+{
+	return getInstructionSetName(activeInstructionSet());
+}
+
+const char* BlockCompressor::getInstructionSetName(BlockInstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+		case BLOCK_AVX2:	return "avx2";
+		case BLOCK_SSE41:	return "sse4.1";
+		default:			return "scalar";
+	}
+}
+
+BlockInstructionSet BlockCompressor::getSupportedInstructionSet()
+{
+	return detectInstructionSet();
+}
+
+void BlockCompressor::limitInstructionSet(BlockInstructionSet instructionSet)
+{
+	BlockInstructionSet supported = detectInstructionSet();
+
+	activeInstructionSet() = instructionSet < supported ? instructionSet : supported;
+}
+
+void BlockCompressor::encodeBC1Block(const unsigned char* rgba, int quality, unsigned char* dst)
+{
+	Block			block;
+	Endpoints		endpoints;
+	unsigned short	c0, c1;
+	unsigned char	indices[16];
+
+	loadBlock(rgba, block);
+	fitEndpoints(block, quality, endpoints);
+
+	/// pull the endpoints in a bit, the extremes are rarely hit after quantization
+	if (quality >= 1)
+	{
+		for (size_t c = 0; c < 3; c++)
+		{
+			float inset = (endpoints.e1[c] - endpoints.e0[c]) / 16.0f;
+
+			endpoints.e0[c] += inset;
+			endpoints.e1[c] -= inset;
+		}
+	}
+	///
+
+	unsigned int error = encodeBC1(block, endpoints, c0, c1, indices);
+
+	/// refit to the picked indices, keep it if it is better
+	if (quality >= 2 && error > 0)
+	{
+		static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f }; // from c1 to c0, see encodeBC1()
+
+		Endpoints		refit;
+		unsigned short	r0, r1;
+		unsigned char	refitIndices[16];
+
+		/// weights run from c0 (0) to c1 (1), so e0 is c0 here
+		if (refitEndpoints(block, indices, weights, refit))
+		{
+			std::swap(refit.e0, refit.e1); // encodeBC1() expects e1 to become c0
+
+			if (encodeBC1(block, refit, r0, r1, refitIndices) < error)
+			{
+				c0 = r0;
+				c1 = r1;
+				memcpy(indices, refitIndices, sizeof(indices));
+			}
+		}
+		///
+	}
+	///
+
+	unsigned int packedIndices = 0;
+
+	for (size_t i = 0; i < 16; i++)
+		packedIndices |= (unsigned int)indices[i] << (2 * i);
+
+	dst[0] = (unsigned char)(c0 & 0xff);
+	dst[1] = (unsigned char)(c0 >> 8);
+	dst[2] = (unsigned char)(c1 & 0xff);
+	dst[3] = (unsigned char)(c1 >> 8);
+
+	for (size_t i = 0; i < 4; i++)
+		dst[4 + i] = (unsigned char)(packedIndices >> (8 * i));
+}
+
+void BlockCompressor::encodeBC7Block(const unsigned char* rgba, int quality, unsigned char* dst)
+{
+	Block			block;
+	Endpoints		endpoints;
+	int				q0[4], q1[4], p0, p1;
+	unsigned char	indices[16];
+
+	loadBlock(rgba, block);
+	fitEndpoints(block, quality, endpoints);
+
+	unsigned int error = encodeBC7(block, endpoints, q0, q1, p0, p1, indices);
+
+	/// refit to the picked indices, keep it if it is better
+	if (quality >= 2 && error > 0)
+	{
+		float weights[16];
+
+		for (size_t i = 0; i < 16; i++)
+			weights[i] = (float)BC7_WEIGHTS[i] / 64.0f;
+
+		Endpoints		refit;
+		int				r0[4], r1[4], rp0, rp1;
+		unsigned char	refitIndices[16];
+
+		if (refitEndpoints(block, indices, weights, refit) && encodeBC7(block, refit, r0, r1, rp0, rp1, refitIndices) < error)
+		{
+			memcpy(q0, r0, sizeof(q0));
+			memcpy(q1, r1, sizeof(q1));
+			p0 = rp0;
+			p1 = rp1;
+			memcpy(indices, refitIndices, sizeof(indices));
+		}
+	}
+	///
+
+	/// the msb of the first index is implied 0, swap the endpoints if it is not
+	if (indices[0] >= 8)
+	{
+		std::swap(q0, q1);
+		std::swap(p0, p1);
+
+		for (size_t i = 0; i < 16; i++)
+			indices[i] = (unsigned char)(15 - indices[i]);
+	}
+	///
+
+	memset(dst, 0, 16);
+
+	BitWriter writer = { dst, 0 };
+
+	writer.write(1 << 6, 7); // mode 6
+
+	for (size_t c = 0; c < 4; c++)
+	{
+		writer.write((unsigned int)q0[c], 7);
+		writer.write((unsigned int)q1[c], 7);
+	}
+
+	writer.write((unsigned int)p0, 1);
+	writer.write((unsigned int)p1, 1);
+
+	for (size_t i = 0; i < 16; i++)
+		writer.write(indices[i], i == 0 ? 3 : 4);
+}
+
+void BlockCompressor::decodeBC1Block(const unsigned char* src, unsigned char* rgba)
+{
+	unsigned short	c0 = (unsigned short)(src[0] | (src[1] << 8));
+	unsigned short	c1 = (unsigned short)(src[2] | (src[3] << 8));
+	int				colors[4][4];
+
+	unpackRGB565(c0, colors[0]);
+	unpackRGB565(c1, colors[1]);
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		if (c0 > c1)
+		{
+			colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+		}
+		else
+		{
+			colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+			colors[3][c] = 0;
+		}
+	}
+
+	colors[0][3] = colors[1][3] = colors[2][3] = 255;
+	colors[3][3] = c0 > c1 ? 255 : 0;
+
+	unsigned int packedIndices = src[4] | (src[5] << 8) | (src[6] << 16) | ((unsigned int)src[7] << 24);
+
+	for (size_t i = 0; i < 16; i++)
+	{
+		const int* color = colors[(packedIndices >> (2 * i)) & 3];
+
+		for (size_t c = 0; c < 4; c++)
+			rgba[i * 4 + c] = (unsigned char)color[c];
+	}
+}
+
+bool BlockCompressor::decodeBC7Block(const unsigned char* src, unsigned char* rgba)
+{
+	BitReader reader = { src, 0 };
+
+	if (reader.read(7) != (1 << 6)) // mode 6 only
+		return false;
+
+	int e0[4], e1[4];
+
+	for (size_t c = 0; c < 4; c++)
+	{
+		e0[c] = (int)reader.read(7) << 1;
+		e1[c] = (int)reader.read(7) << 1;
+	}
+
+	int p0 = (int)reader.read(1);
+	int p1 = (int)reader.read(1);
+
+	for (size_t c = 0; c < 4; c++)
+	{
+		e0[c] |= p0;
+		e1[c] |= p1;
+	}
+
+	for (size_t i = 0; i < 16; i++)
+	{
+		int weight = BC7_WEIGHTS[reader.read(i == 0 ? 3 : 4)];
+
+		for (size_t c = 0; c < 4; c++)
+			rgba[i * 4 + c] = (unsigned char)(((64 - weight) * e0[c] + weight * e1[c] + 32) >> 6);
+	}
+
+	return true;
+}
+
+bool BlockCompressor::decompress(const unsigned char* blocks, size_t width, size_t height, TileCompression compression, unsigned char* rgb)
+{
+	size_t blocksX = width / 4;
+	size_t blocksY = height / 4;
+	size_t blockBytes = getBlockBytes(compression);
+
+	if (blockBytes == 0)
+		return false;
+
+	unsigned char rgba[64];
+
+	for (size_t blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (size_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			const unsigned char* block = blocks + (blockY * blocksX + blockX) * blockBytes;
+
+			if (compression == TILE_COMPRESSION_BC1)
+				decodeBC1Block(block, rgba);
+			else if (!decodeBC7Block(block, rgba))
+				return false;
+
+			for (size_t y = 0; y < 4; y++)
+			{
+				unsigned char* row = rgb + ((blockY * 4 + y) * width + blockX * 4) * 3;
+
+				for (size_t x = 0; x < 4; x++)
+					memcpy(row + x * 3, &rgba[(y * 4 + x) * 4], 3);
+			}
+		}
+	}
+
+	return true;
+}
+
+void BlockCompressor::compress(const unsigned char* pixels, size_t width, size_t height, size_t bytesPerPixel,
+							   TileCompression compression, int quality, unsigned char* dst, JobSystem* jobSystem)
+{
+	size_t blocksX = width / 4;
+	size_t blocksY = height / 4;
+	size_t blockBytes = getBlockBytes(compression);
+
+	if (blockBytes == 0)
+		return;
+
+	auto encodeBlockRows = [=](size_t begin, size_t end)
+	{
+		unsigned char			rgba[64];
+		vector<unsigned char>	strip(bytesPerPixel == 4 ? 0 : width * 4 * 4);
+
+		for (size_t blockY = begin; blockY < end; blockY++)
+		{
+			/// the 4 pixel rows of the block row as rgba
+			const unsigned char* rows = pixels + blockY * 4 * width * bytesPerPixel;
+
+			if (bytesPerPixel != 4)
+			{
+				PixelKernels::expandRGBToRGBA(rows, width * 4, strip.data());
+				rows = strip.data();
+			}
+			///
+
+			for (size_t blockX = 0; blockX < blocksX; blockX++)
+			{
+				for (size_t y = 0; y < 4; y++)
+					memcpy(&rgba[y * 16], rows + (y * width + blockX * 4) * 4, 16);
+
+				unsigned char* block = dst + (blockY * blocksX + blockX) * blockBytes;
+
+				if (compression == TILE_COMPRESSION_BC1)
+					encodeBC1Block(rgba, quality, block);
+				else
+					encodeBC7Block(rgba, quality, block);
+			}
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->parallelFor(blocksY, 4, encodeBlockRows);
+	else
+		encodeBlockRows(0, blocksY);
+}
+//////////////////////////////////////////////////////////////////////////////////
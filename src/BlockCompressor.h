@@ -0,0 +1,74 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+class JobSystem;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// gpu block compression of the tile textures
+///
+enum TileCompression
+{
+	TILE_COMPRESSION_NONE = 0,	// rgb8
+	TILE_COMPRESSION_BC1,		// 4 bits per texel, rgb
+	TILE_COMPRESSION_BC7		// 8 bits per texel, rgba, mode 6 only
+};
+
+/// paths of the palette search, narrowest first
+enum BlockInstructionSet
+{
+	BLOCK_SCALAR,
+	BLOCK_SSE41,
+	BLOCK_AVX2
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// cpu side bc1 / bc7 encoder, independent of gl
+///		- every 4 x 4 block is fit along its principal color axis, the texel indices are then
+///		  picked against the quantized palette (vectorized, sse4.1 / avx2); gcc / clang on x86
+///		  compile every path and pick the widest the cpu runs at the first block, as PixelKernels
+///		- quality 0: bounding box endpoints, 1: principal axis endpoints, 2: plus a least squares
+///		  refit of the endpoints to the picked indices
+///		- bc7 only uses mode 6 (one subset, 7 bit + p bit endpoints, 4 bit indices), which covers
+///		  smooth imagery well and keeps the encoder simple
+///		- width and height have to be multiples of 4
+///
+class BlockCompressor
+{
+public:
+	static size_t	getBlockBytes(TileCompression compression);
+	static size_t	getCompressedSize(size_t width, size_t height, TileCompression compression);
+
+	/// pixels: width x height, tightly packed rgb (3) or rgba (4) bytes per pixel
+	///		- with a job system the block rows are encoded on all of its workers
+	static void		compress(const unsigned char* pixels, size_t width, size_t height, size_t bytesPerPixel,
+							 TileCompression compression, int quality, unsigned char* dst, JobSystem* jobSystem = NULL);
+
+	/// rgba: 16 texels, 4 bytes each, row by row
+	static void		encodeBC1Block(const unsigned char* rgba, int quality, unsigned char* dst);
+	static void		encodeBC7Block(const unsigned char* rgba, int quality, unsigned char* dst);
+
+	/// back to tightly packed rgb, for the few tiles needed on the cpu again (the overview of a
+	/// compressed tile cache); bc7 blocks other than mode 6 are not decoded, false then
+	static bool		decompress(const unsigned char* blocks, size_t width, size_t height, TileCompression compression, unsigned char* rgb);
+
+	/// rgba: 16 texels, 4 bytes each, row by row
+	static void		decodeBC1Block(const unsigned char* src, unsigned char* rgba);
+	static bool		decodeBC7Block(const unsigned char* src, unsigned char* rgba);
+
+	static const char*	getName(TileCompression compression);
+
+	/// the path in use, "avx2", "sse4.1" or "scalar"
+	static const char*	getInstructionSet();
+	static const char*	getInstructionSetName(BlockInstructionSet instructionSet);
+
+	/// the widest path this cpu and build can run
+	static BlockInstructionSet	getSupportedInstructionSet();
+
+	/// no path wider than instructionSet from now on, for checking the narrower paths against
+	/// each other; not thread safe, call it before the compressor is in use
+	static void	limitInstructionSet(BlockInstructionSet instructionSet);
+};
@@ -0,0 +1,307 @@
+#include "CameraController.h"
+#include "AsyncLogger.h"
+
+#include <algorithm>
+#include <cmath>
+
+//////////////////////////////////////////////////////////////////////////////////
+CameraController::CameraController()
+{
+	_moveIncrement = _turnIncrement = 1.0f;
+	_moveStepsPerSecond = _turnStepsPerSecond = 1.0f;
+	_tickSeconds = 1.0 / 240.0;
+	_stop = false;
+
+	for (bool& held : _held)
+		held = false;
+}
+
+CameraController::~CameraController()
+{
+	stop();
+}
+
+void CameraController::initialize(const glm::vec3& homePosition, const glm::vec3& homeDirection, bool projectionOrtho,
+								  float moveIncrement, float turnIncrement)
+{
+	_homePosition = homePosition;
+	_homeDirection = homeDirection;
+	_moveIncrement = moveIncrement;
+	_turnIncrement = turnIncrement;
+
+	_state.projectionOrtho = projectionOrtho;
+
+	resetToHome();
+}
+
+void CameraController::start(float moveStepsPerSecond, float turnStepsPerSecond, double tickSeconds, const function<void()>& onChange)
+{
+	stop();
+
+	_moveStepsPerSecond = moveStepsPerSecond;
+	_turnStepsPerSecond = turnStepsPerSecond;
+	_tickSeconds = tickSeconds;
+	_onChange = onChange;
+	_stop = false;
+
+	for (bool& held : _held)
+		held = false;
+
+	_thread = thread(&CameraController::cameraLoop, this);
+}
+
+void CameraController::stop()
+{
+	if (!_thread.joinable())
+		return;
+
+	{
+		lock_guard<mutex> guard(_lock);
+
+		_stop = true;
+	}
+
+	_eventPosted.notify_one();
+	_thread.join();
+}
+
+bool CameraController::keyEvent(int key, bool pressed)
+{
+	KeyEvent event;
+
+	event.key = key;
+	event.pressed = pressed;
+
+	if (!_events.push(event))
+		return false;
+
+	/// taking the lock orders the push before the camera thread's last look at the ring
+	{
+		lock_guard<mutex> guard(_lock);
+	}
+	///
+
+	_eventPosted.notify_one();
+
+	return true;
+}
+
+void CameraController::step(const vector<int>& keys)
+{
+	bool turned = false;
+
+	for (int key : keys)
+	{
+		int held = getHeldKey(key);
+
+		if (held == HELD_COUNT)
+		{
+			applyKey(key, true);
+			continue;
+		}
+
+		/// one key press worth of motion
+		_held[held] = true;
+		integrate(1.0f, 1.0f);
+		_held[held] = false;
+		///
+
+		turned = turned || held == HELD_TURN_LEFT || held == HELD_TURN_RIGHT;
+	}
+
+	if (turned)
+		LogStream() << __FUNCTION__ << " _rotationAngle: " << _state.rotationAngle << endl;
+
+	publish();
+}
+
+void CameraController::goHome()
+{
+	resetToHome();
+}
+
+bool CameraController::isCameraKey(int key)
+{
+	return getHeldKey(key) != HELD_COUNT || key == GLFW_KEY_SPACE || key == GLFW_KEY_LEFT || key == GLFW_KEY_H;
+}
+
+int CameraController::getHeldKey(int key)
+{
+	switch (key)
+	{
+		case GLFW_KEY_W:		return HELD_FORWARD;
+		case GLFW_KEY_S:		return HELD_BACKWARD;
+		case GLFW_KEY_A:		return HELD_LEFT;
+		case GLFW_KEY_D:		return HELD_RIGHT;
+		case GLFW_KEY_Q:
+		case GLFW_KEY_UP:		return HELD_UP;
+		case GLFW_KEY_Z:
+		case GLFW_KEY_DOWN:		return HELD_DOWN;
+		case GLFW_KEY_L:		return HELD_TURN_LEFT;
+		case GLFW_KEY_R:
+		case GLFW_KEY_RIGHT:	return HELD_TURN_RIGHT;
+		default:				return HELD_COUNT;
+	}
+}
+
+void CameraController::cameraLoop()
+{
+	typedef chrono::steady_clock Clock;
+
+	Clock::time_point last = Clock::now();
+
+	while (!_stop)
+	{
+		Clock::time_point now = Clock::now();
+		bool changed = false;
+
+		/// the keys held since the last tick move the camera for the time that passed
+		if (isMoving())
+		{
+			float seconds = (float)min(chrono::duration<double>(now - last).count(), 0.1); // no jump after a stall
+
+			integrate(seconds * _moveStepsPerSecond, seconds * _turnStepsPerSecond);
+			changed = true;
+		}
+
+		last = now;
+		///
+
+		KeyEvent event;
+
+		while (_events.pop(event))
+			changed = applyKey(event.key, event.pressed) || changed;
+
+		if (changed)
+			publish();
+
+		/// a tick while moving, else sleep until the next key event
+		unique_lock<mutex> guard(_lock);
+
+		auto woken = [this] { return _stop || !_events.isEmpty(); };
+
+		if (isMoving())
+			_eventPosted.wait_until(guard, now + chrono::duration_cast<Clock::duration>(chrono::duration<double>(_tickSeconds)), woken);
+		else
+		{
+			_eventPosted.wait(guard, woken);
+
+			last = Clock::now();
+		}
+		///
+	}
+}
+
+bool CameraController::applyKey(int key, bool pressed)
+{
+	int held = getHeldKey(key);
+
+	if (held != HELD_COUNT)
+	{
+		_held[held] = pressed;
+
+		if (!pressed && (held == HELD_TURN_LEFT || held == HELD_TURN_RIGHT))
+			LogStream() << __FUNCTION__ << " _rotationAngle: " << _state.rotationAngle << endl;
+
+		return false; // moves with the next tick
+	}
+
+	if (!pressed)
+		return false;
+
+	switch (key)
+	{
+		case GLFW_KEY_LEFT:
+		case GLFW_KEY_SPACE:
+			_state.projectionOrtho = !_state.projectionOrtho;
+			_state.jumps++;
+		return true;
+
+		case GLFW_KEY_H:
+			resetToHome();
+		return false; // published already
+
+		default:
+		return false;
+	}
+}
+
+bool CameraController::isMoving()
+{
+	for (bool held : _held)
+	{
+		if (held)
+			return true;
+	}
+
+	return false;
+}
+
+/// moveSteps / turnSteps: key press increments to apply, fractional while integrating over time
+///
+void CameraController::integrate(float moveSteps, float turnSteps)
+{
+	float move = moveSteps * _moveIncrement;
+
+	// in enu coord sys
+	if (_held[HELD_FORWARD])	_state.position.x += move;
+	if (_held[HELD_BACKWARD])	_state.position.x -= move;
+	if (_held[HELD_LEFT])		_state.position.y -= move;
+	if (_held[HELD_RIGHT])		_state.position.y += move;
+	if (_held[HELD_UP])			_state.position.z += move;
+	if (_held[HELD_DOWN])		_state.position.z -= move;
+
+	if (_held[HELD_TURN_LEFT] != _held[HELD_TURN_RIGHT])
+	{
+		_state.rotationAngle += (_held[HELD_TURN_LEFT] ? 1.0f : -1.0f) * turnSteps * _turnIncrement;
+
+		updateHeading();
+	}
+}
+
+void CameraController::updateHeading()
+{
+	// xy plane
+	_state.direction.x = cos(glm::radians(_state.rotationAngle));
+	_state.direction.y = sin(glm::radians(_state.rotationAngle));
+	_state.direction.z = 0.0f;
+	//
+
+	_state.direction = glm::normalize(_state.direction);
+}
+
+void CameraController::resetToHome()
+{
+	_state.jumps++;
+	_state.position = _homePosition;
+	_state.direction = _homeDirection;
+
+	if (_state.direction.x == 0.0f) // TODO: use fuzzy logic to
+	{
+		_state.rotationAngle = 90.0;
+	}
+	else
+	{
+		// TODO: test this logic
+		float tanValue = _state.direction.x / _state.direction.z;
+		_state.rotationAngle = glm::degrees(atan(tanValue));
+	}
+
+	updateHeading();
+
+	LogStream() << __FUNCTION__ << " _rotationAngle: " << _state.rotationAngle << " camera Dir: "
+				<< _state.direction.x << ", " << _state.direction.y << ", " << _state.direction.z << endl;
+
+	publish();
+}
+
+void CameraController::publish()
+{
+	_state.version++;
+
+	_published.publish(_state);
+
+	if (_onChange)
+		_onChange();
+}
+//////////////////////////////////////////////////////////////////////////////////
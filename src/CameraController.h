@@ -0,0 +1,112 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "LockFree.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// one published camera, never changed once handed over
+///
+struct CameraState
+{
+	glm::vec3	position;		// in enu
+	glm::vec3	direction;		// heading in the xy plane
+	float		rotationAngle;	// in degrees
+	bool		projectionOrtho;
+	size_t		version;		// counts the published states
+	size_t		jumps;			// counts the discontinuous changes (home, projection switch)
+
+	CameraState() : rotationAngle(90.0f), projectionOrtho(true), version(0), jumps(0) {};
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// camera navigation on its own thread
+///		- the glfw thread posts key presses / releases (keyEvent()), a lock free ring carries them
+///		  to the camera thread; the camera thread integrates the held keys over time and
+///		  publishes a CameraState through a triple buffer, the render thread takes the newest
+///		  one with consume() at the start of its frame
+///		- motion is time based: a held move key advances moveStepsPerSecond key press increments
+///		  per second, a held rotate key turns turnStepsPerSecond rotation increments per second,
+///		  whatever the frame or key repeat rate
+///		- space (projection) and H (home) act once per press
+///		- while no key is held the camera thread sleeps until the next key event
+///		- without the thread (start() not called, e.g. a benchmark), step() applies keys
+///		  synchronously, one press each, the same as a single key press always did
+///		- only the camera keys come here, see isCameraKey()
+///
+class CameraController
+{
+public:
+	CameraController();
+	~CameraController();
+
+	/// home pose and increments, from the Configuration
+	void	initialize(const glm::vec3& homePosition, const glm::vec3& homeDirection, bool projectionOrtho,
+					   float moveIncrement, float turnIncrement);
+
+	/// onChange is called on the camera thread after every publish, e.g. to wake the render loop
+	void	start(float moveStepsPerSecond, float turnStepsPerSecond, double tickSeconds, const function<void()>& onChange);
+	void	stop();
+
+	/// glfw thread; false if the ring is full and the event was dropped
+	bool	keyEvent(int key, bool pressed);
+
+	/// no thread running only: apply every key once and publish
+	void	step(const vector<int>& keys);
+	void	goHome(); // no thread running only
+
+	/// render thread, the newest state if one was published since the last call
+	bool	consume(CameraState& state) { return _published.consume(state); };
+	bool	hasNewState() { return _published.hasNewValue(); };
+
+	static bool	isCameraKey(int key);
+
+	/// begin - getters / accessors
+	bool	isRunning() { return _thread.joinable(); };
+	/// end - getters / accessors
+
+protected:
+	struct KeyEvent
+	{
+		int		key;
+		bool	pressed;
+	};
+
+	enum HeldKey { HELD_FORWARD = 0, HELD_BACKWARD, HELD_LEFT, HELD_RIGHT, HELD_UP, HELD_DOWN, HELD_TURN_LEFT, HELD_TURN_RIGHT, HELD_COUNT };
+
+	/// begin - camera thread only (or the caller of step() while there is no thread)
+	CameraState		_state;
+	bool			_held[HELD_COUNT];
+	/// end - camera thread only
+
+	glm::vec3		_homePosition, _homeDirection;
+	float			_moveIncrement, _turnIncrement;
+	float			_moveStepsPerSecond, _turnStepsPerSecond;
+	double			_tickSeconds;
+	function<void()>	_onChange;
+
+	SpscRing<KeyEvent, 256>		_events;
+	TripleBuffer<CameraState>	_published;
+
+	thread					_thread;
+	mutex					_lock;			// only to sleep on _eventPosted
+	condition_variable		_eventPosted;
+	atomic<bool>			_stop;
+
+	void	cameraLoop();
+
+	bool	applyKey(int key, bool pressed);	// true if the camera changed right away
+	bool	isMoving();
+	void	integrate(float moveSteps, float turnSteps);
+	void	updateHeading();
+	void	resetToHome();
+	void	publish();
+
+	static int	getHeldKey(int key); // HELD_COUNT if not a held key
+};
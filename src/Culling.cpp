@@ -0,0 +1,55 @@
+#include "Culling.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+Frustum::Frustum()
+{
+	for (glm::vec4& plane : _planes)
+		plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // everything inside until updated
+}
+
+/// extract the planes from the combined matrix (Gribb/Hartmann)
+///		- glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+///
+void Frustum::update(const glm::mat4& m)
+{
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	_planes[0] = row3 + row0; // left
+	_planes[1] = row3 - row0; // right
+	_planes[2] = row3 + row1; // bottom
+	_planes[3] = row3 - row1; // top
+	_planes[4] = row3 + row2; // near
+	_planes[5] = row3 - row2; // far
+
+	for (glm::vec4& plane : _planes)
+	{
+		float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+
+		if (length > 0.0f)
+			plane = plane / length;
+	}
+}
+
+Frustum::Containment Frustum::testBox(const glm::vec3& ll, const glm::vec3& ur) const
+{
+	Containment result = INSIDE;
+
+	for (const glm::vec4& plane : _planes)
+	{
+		// p is the box corner furthest along the plane normal, n the one furthest against it
+		glm::vec3 p(plane.x >= 0.0f ? ur.x : ll.x, plane.y >= 0.0f ? ur.y : ll.y, plane.z >= 0.0f ? ur.z : ll.z);
+		glm::vec3 n(plane.x >= 0.0f ? ll.x : ur.x, plane.y >= 0.0f ? ll.y : ur.y, plane.z >= 0.0f ? ll.z : ur.z);
+
+		if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f)
+			return OUTSIDE;
+
+		if (plane.x * n.x + plane.y * n.y + plane.z * n.z + plane.w < 0.0f)
+			result = INTERSECTS;
+	}
+
+	return result;
+}
+//////////////////////////////////////////////////////////////////////////////////
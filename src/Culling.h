@@ -0,0 +1,30 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// view frustum - six planes pulled out of a (projection * view * model) matrix
+///		- works the same for ortho and perspective projections
+///		- planes are in the space of the geometry the matrix was built for (tile/model space)
+///
+class Frustum
+{
+public:
+	enum Containment { OUTSIDE = 0, INTERSECTS, INSIDE };
+
+	Frustum();
+
+	void		update(const glm::mat4& modelViewProjection);
+
+	Containment	testBox(const glm::vec3& ll, const glm::vec3& ur) const;
+
+	/// begin - getters / accessors
+	const glm::vec4&	getPlane(size_t plane) const { return _planes[plane]; };
+	/// end - getters / accessors
+
+protected:
+	glm::vec4	_planes[6]; // left, right, bottom, top, near, far - (a, b, c, d) with normalized (a, b, c)
+};
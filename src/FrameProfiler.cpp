@@ -0,0 +1,345 @@
+#include "FrameProfiler.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+//////////////////////////////////////////////////////////////////////////////////
+FrameProfiler::FrameProfiler()
+{
+	_enabled = false;
+	_overlayEnabled = false;
+	_queriesCreated = false;
+	_frame = 0;
+	_current = NULL;
+	_gpuPass = PROFILE_PASS_COUNT;
+	_droppedSamples = 0;
+
+	memset(_slots, 0, sizeof(_slots));
+
+	for (size_t pass = 0; pass < PROFILE_PASS_COUNT; pass++)
+		_averageCpuMs[pass] = _averageGpuMs[pass] = 0.0;
+}
+
+FrameProfiler::~FrameProfiler()
+{
+}
+
+void FrameProfiler::release()
+{
+	if (_queriesCreated)
+	{
+		for (FrameSlot& slot : _slots)
+			glDeleteQueries(PROFILE_PASS_COUNT, slot.queries);
+	}
+
+	_queriesCreated = false;
+	_enabled = false;
+	_current = NULL;
+}
+
+void FrameProfiler::setEnabled(bool enabled)
+{
+	if (enabled == _enabled)
+		return;
+
+	if (enabled)
+	{
+		if (!_queriesCreated)
+		{
+			for (FrameSlot& slot : _slots)
+				glGenQueries(PROFILE_PASS_COUNT, slot.queries);
+
+			_queriesCreated = true;
+		}
+
+		for (FrameSlot& slot : _slots)
+			slot.pending = false;
+
+		_epoch = Clock::now();
+		_current = NULL;
+		_gpuPass = PROFILE_PASS_COUNT;
+	}
+	else if (_gpuPass != PROFILE_PASS_COUNT)
+	{
+		glEndQuery(GL_TIME_ELAPSED); // switched off in the middle of a pass
+
+		_gpuPass = PROFILE_PASS_COUNT;
+	}
+
+	_enabled = enabled;
+
+	cout << __FUNCTION__ << " frame timing " << (_enabled ? "on" : "off") << endl;
+}
+
+const char* FrameProfiler::getPassName(ProfilePass pass)
+{
+	static const char* names[PROFILE_PASS_COUNT] = { "update", "cull", "preRender", "render", "postRender", "swap" };
+
+	return pass < PROFILE_PASS_COUNT ? names[pass] : "unknown";
+}
+
+double FrameProfiler::now()
+{
+	return chrono::duration<double, milli>(Clock::now() - _epoch).count();
+}
+
+bool FrameProfiler::isAvailable(FrameSlot& slot)
+{
+	/// queries finish in order, the last one issued tells for all of them
+	for (size_t pass = PROFILE_PASS_COUNT; pass-- > 0; )
+	{
+		if (slot.gpuIssued[pass])
+		{
+			GLint available = 0;
+
+			glGetQueryObjectiv(slot.queries[pass], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			return available != 0;
+		}
+	}
+	///
+
+	return true;
+}
+
+void FrameProfiler::collect(FrameSlot& slot, bool withGpu)
+{
+	for (size_t pass = 0; pass < PROFILE_PASS_COUNT; pass++)
+	{
+		if (!slot.recorded[pass])
+			continue;
+
+		ProfileSample sample;
+
+		sample.frame = slot.frame;
+		sample.pass = (uint32_t)pass;
+		sample.cpuBeginMs = slot.cpuBeginMs[pass];
+		sample.cpuMs = slot.cpuMs[pass];
+		sample.gpuMs = -1.0;
+
+		if (withGpu && slot.gpuIssued[pass])
+		{
+			GLuint64 elapsed = 0;
+
+			glGetQueryObjectui64v(slot.queries[pass], GL_QUERY_RESULT, &elapsed); // available, does not wait
+
+			sample.gpuMs = (double)elapsed / 1.0e6;
+			_averageGpuMs[pass] += (sample.gpuMs - _averageGpuMs[pass]) * 0.1;
+		}
+
+		_averageCpuMs[pass] += (sample.cpuMs - _averageCpuMs[pass]) * 0.1;
+
+		if (!_ring.push(sample))
+			_droppedSamples++;
+	}
+
+	slot.pending = false;
+}
+
+void FrameProfiler::beginFrame()
+{
+	if (!_enabled)
+		return;
+
+	if (_frame % 256 == 0)
+		drain(); // the ring never fills up between two dumps
+
+	/// read back the older frames whose queries are done, oldest first
+	for (size_t age = QUERY_FRAMES - 1; age > 0; age--)
+	{
+		FrameSlot& slot = _slots[(_frame + QUERY_FRAMES - age) % QUERY_FRAMES];
+
+		if (slot.pending && isAvailable(slot))
+			collect(slot, true);
+	}
+	///
+
+	/// this frame's slot is the oldest one, whatever did not make it in time goes without gpu times
+	FrameSlot& slot = _slots[_frame % QUERY_FRAMES];
+
+	if (slot.pending)
+		collect(slot, isAvailable(slot));
+	///
+
+	slot.frame = _frame++;
+	slot.pending = true;
+
+	for (size_t pass = 0; pass < PROFILE_PASS_COUNT; pass++)
+		slot.recorded[pass] = slot.gpuIssued[pass] = false;
+
+	_current = &slot;
+}
+
+void FrameProfiler::beginPass(ProfilePass pass, bool gpu)
+{
+	if (!_enabled || _current == NULL)
+		return;
+
+	_current->cpuBeginMs[pass] = now();
+
+	if (gpu && _gpuPass == PROFILE_PASS_COUNT)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, _current->queries[pass]);
+
+		_current->gpuIssued[pass] = true;
+		_gpuPass = pass;
+	}
+}
+
+void FrameProfiler::endPass(ProfilePass pass)
+{
+	if (!_enabled || _current == NULL)
+		return;
+
+	if (_gpuPass == pass)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+
+		_gpuPass = PROFILE_PASS_COUNT;
+	}
+
+	_current->cpuMs[pass] = now() - _current->cpuBeginMs[pass];
+	_current->recorded[pass] = true;
+}
+
+void FrameProfiler::drain()
+{
+	ProfileSample sample;
+
+	while (_ring.pop(sample))
+	{
+		if (_history.size() < MAX_HISTORY)
+			_history.push_back(sample);
+		else
+			_droppedSamples++;
+	}
+}
+
+bool FrameProfiler::writeCsv(const string& filename)
+{
+	drain();
+
+	ofstream output(filename);
+
+	if (!output.is_open())
+	{
+		cout << __FUNCTION__ << "Error, can not write " << filename << endl;
+		return false;
+	}
+
+	output << "frame,pass,cpu_begin_ms,cpu_ms,gpu_ms" << endl;
+	output << fixed << setprecision(4);
+
+	for (const ProfileSample& sample : _history)
+	{
+		output << sample.frame << "," << getPassName((ProfilePass)sample.pass) << "," << sample.cpuBeginMs << "," << sample.cpuMs << ",";
+
+		if (sample.gpuMs >= 0.0)
+			output << sample.gpuMs;
+
+		output << endl;
+	}
+
+	cout << __FUNCTION__ << " " << _history.size() << " samples written to " << filename << endl;
+
+	return true;
+}
+
+bool FrameProfiler::writeChromeTrace(const string& filename)
+{
+	drain();
+
+	ofstream output(filename);
+
+	if (!output.is_open())
+	{
+		cout << __FUNCTION__ << "Error, can not write " << filename << endl;
+		return false;
+	}
+
+	/// complete events ("X"), microseconds; tid 1 is the cpu, tid 2 the gpu
+	output << "{\"traceEvents\":[" << endl;
+	output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}}," << endl;
+	output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"gpu\"}}";
+	output << fixed << setprecision(3);
+
+	for (const ProfileSample& sample : _history)
+	{
+		const char* name = getPassName((ProfilePass)sample.pass);
+
+		output << "," << endl << "{\"name\":\"" << name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << sample.cpuBeginMs * 1000.0
+			   << ",\"dur\":" << sample.cpuMs * 1000.0 << ",\"args\":{\"frame\":" << sample.frame << "}}";
+
+		if (sample.gpuMs >= 0.0)
+			output << "," << endl << "{\"name\":\"" << name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":" << sample.cpuBeginMs * 1000.0
+				   << ",\"dur\":" << sample.gpuMs * 1000.0 << ",\"args\":{\"frame\":" << sample.frame << "}}";
+	}
+
+	output << endl << "]}" << endl;
+	///
+
+	cout << __FUNCTION__ << " " << _history.size() << " samples written to " << filename << endl;
+
+	return true;
+}
+
+void FrameProfiler::printSummary()
+{
+	cout << __FUNCTION__ << " average ms (cpu / gpu):";
+
+	for (size_t pass = 0; pass < PROFILE_PASS_COUNT; pass++)
+		cout << " " << getPassName((ProfilePass)pass) << " " << setprecision(3) << _averageCpuMs[pass] << " / " << _averageGpuMs[pass];
+
+	cout << " dropped: " << _droppedSamples << endl;
+}
+
+void FrameProfiler::renderOverlay(size_t viewportWidth, size_t viewportHeight)
+{
+	if (!_enabled || !_overlayEnabled)
+		return;
+
+	static const float colors[PROFILE_PASS_COUNT][3] =
+	{
+		{ 0.9f, 0.9f, 0.2f }, { 0.2f, 0.9f, 0.2f }, { 0.2f, 0.6f, 1.0f }, { 1.0f, 0.4f, 0.2f }, { 0.8f, 0.3f, 0.9f }, { 0.6f, 0.6f, 0.6f }
+	};
+
+	const float	pixelsPerMs = (float)viewportWidth / 4.0f / 16.7f; // a 60 Hz frame is a quarter of the width
+	const int	barHeight = 6;
+	const int	left = 8;
+	int			top = (int)viewportHeight - 8;
+
+	GLfloat clearColor[4];
+
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	glEnable(GL_SCISSOR_TEST);
+
+	auto bar = [](int x, int y, int width, int height, float r, float g, float b)
+	{
+		if (width <= 0)
+			return;
+
+		glScissor(x, y, width, height);
+		glClearColor(r, g, b, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	};
+
+	/// per pass: cpu bar, gpu bar below it in a darker shade
+	for (size_t pass = 0; pass < PROFILE_PASS_COUNT; pass++)
+	{
+		top -= barHeight;
+		bar(left, top, (int)(_averageCpuMs[pass] * pixelsPerMs), barHeight - 1, colors[pass][0], colors[pass][1], colors[pass][2]);
+
+		top -= barHeight;
+		bar(left, top, (int)(_averageGpuMs[pass] * pixelsPerMs), barHeight - 1, colors[pass][0] * 0.5f, colors[pass][1] * 0.5f, colors[pass][2] * 0.5f);
+
+		top -= 2;
+	}
+	///
+
+	bar(left + (int)(16.7f * pixelsPerMs), top, 1, (int)viewportHeight - 8 - top, 1.0f, 1.0f, 1.0f); // frame budget tick
+
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
+//////////////////////////////////////////////////////////////////////////////////
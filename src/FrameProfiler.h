@@ -0,0 +1,140 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "LockFree.h"
+
+#include <chrono>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// the timed parts of a frame
+///
+enum ProfilePass
+{
+	PROFILE_UPDATE = 0,
+	PROFILE_CULL,
+	PROFILE_PRE_RENDER,
+	PROFILE_RENDER,
+	PROFILE_POST_RENDER,
+	PROFILE_SWAP,
+	PROFILE_PASS_COUNT
+};
+
+/// one timed pass of one frame
+struct ProfileSample
+{
+	uint64_t	frame;
+	uint32_t	pass;		// ProfilePass
+	double		cpuBeginMs;	// since the profiler was enabled
+	double		cpuMs;
+	double		gpuMs;		// < 0 if the pass has no gpu timing or its query was not ready in time
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// per pass cpu and gpu timing of the render loop
+///		- cpu: steady clock around the pass; gpu: a GL_TIME_ELAPSED query around the pass
+///		- the queries go round a ring of QUERY_FRAMES frames and are read back only once they are
+///		  available, so timing never stalls the pipeline; a frame whose queries are still not
+///		  done when its ring slot comes round again is reported cpu only
+///		- finished samples go to a lock free ring, dumpable as csv or chrome trace json
+///		  (chrome://tracing, or ui.perfetto.dev); the gpu events sit at the cpu start of their pass
+///		- the overlay draws one cpu and one gpu bar per pass (scissored clears, no shader), the
+///		  white tick marks 16.7 ms
+///		- disabled, every call returns right at its first test
+///		- gl thread only, except draining the ring
+///
+class FrameProfiler
+{
+public:
+	FrameProfiler();
+	~FrameProfiler();
+
+	void	setEnabled(bool enabled);
+	void	release(); // gl side, before the context goes
+
+	void	beginFrame();
+	void	beginPass(ProfilePass pass, bool gpu = true);
+	void	endPass(ProfilePass pass);
+
+	void	renderOverlay(size_t viewportWidth, size_t viewportHeight);
+
+	/// drain the ring into the history and write all of it
+	bool	writeCsv(const string& filename);
+	bool	writeChromeTrace(const string& filename);
+
+	void	printSummary(); // moving averages
+
+	static const char*	getPassName(ProfilePass pass);
+
+	/// begin - getters / accessors
+	bool	isEnabled() { return _enabled; };
+	void	setOverlayEnabled(bool enabled) { _overlayEnabled = enabled; };
+	bool	isOverlayEnabled() { return _overlayEnabled; };
+	double	getAverageCpuMs(ProfilePass pass) { return _averageCpuMs[pass]; };
+	double	getAverageGpuMs(ProfilePass pass) { return _averageGpuMs[pass]; };
+	size_t	getDroppedSampleCount() { return _droppedSamples; };
+	/// end - getters / accessors
+
+protected:
+	typedef chrono::steady_clock Clock;
+
+	static const size_t QUERY_FRAMES = 4;
+	static const size_t RING_SAMPLES = 8192;
+	static const size_t MAX_HISTORY = 1 << 18;
+
+	/// one frame in flight
+	struct FrameSlot
+	{
+		uint64_t	frame;
+		bool		pending;
+		bool		recorded[PROFILE_PASS_COUNT];
+		bool		gpuIssued[PROFILE_PASS_COUNT];
+		double		cpuBeginMs[PROFILE_PASS_COUNT];
+		double		cpuMs[PROFILE_PASS_COUNT];
+		GLuint		queries[PROFILE_PASS_COUNT];
+	};
+
+	bool			_enabled;
+	bool			_overlayEnabled;
+	bool			_queriesCreated;
+	Clock::time_point _epoch;
+	uint64_t		_frame;
+	FrameSlot		_slots[QUERY_FRAMES];
+	FrameSlot*		_current;
+	ProfilePass		_gpuPass;		// pass with its query open, PROFILE_PASS_COUNT if none
+
+	SpscRing<ProfileSample, RING_SAMPLES>	_ring;
+	vector<ProfileSample>	_history;	// drained samples, for the dumps
+	size_t			_droppedSamples;
+
+	double			_averageCpuMs[PROFILE_PASS_COUNT];
+	double			_averageGpuMs[PROFILE_PASS_COUNT];
+
+	double	now();
+	bool	isAvailable(FrameSlot& slot);
+	void	collect(FrameSlot& slot, bool withGpu);
+	void	drain();
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// times the enclosing scope as one pass
+///
+class ProfileScope
+{
+public:
+	ProfileScope(FrameProfiler& profiler, ProfilePass pass, bool gpu = true) : _profiler(profiler), _pass(pass)
+	{
+		_profiler.beginPass(_pass, gpu);
+	};
+
+	~ProfileScope()
+	{
+		_profiler.endPass(_pass);
+	};
+
+protected:
+	FrameProfiler&	_profiler;
+	ProfilePass		_pass;
+};
@@ -0,0 +1,448 @@
+#include "ImageSource.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////
+void ImageSource::copyRegion(const unsigned char* src, size_t srcWidth, size_t srcHeight, size_t bytesPerPixel,
+							 size_t row, size_t col, size_t width, size_t height, unsigned char* dst)
+{
+	size_t dstPitch = width * bytesPerPixel;
+	size_t srcPitch = srcWidth * bytesPerPixel;
+
+	/// part of the region inside the image
+	size_t copyWidth  = col >= srcWidth  ? 0 : std::min(width,  srcWidth  - col);
+	size_t copyHeight = row >= srcHeight ? 0 : std::min(height, srcHeight - row);
+	///
+
+	if (copyHeight > 0)
+		PixelKernels::copyRect(src + row * srcPitch + col * bytesPerPixel, srcPitch, dst, dstPitch, copyWidth * bytesPerPixel, copyHeight);
+
+	if (copyWidth < width)
+	{
+		for (size_t y = 0; y < copyHeight; y++)
+			memset(dst + y * dstPitch + copyWidth * bytesPerPixel, 0, (width - copyWidth) * bytesPerPixel);
+	}
+
+	if (copyHeight < height)
+		memset(dst + copyHeight * dstPitch, 0, (height - copyHeight) * dstPitch);
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+void ImageSource::readRegionDownsampled(size_t row, size_t col, size_t width, size_t height, size_t factor, unsigned char* dst)
+{
+	if (factor <= 1)
+	{
+		readRegion(row, col, width, height, dst);
+		return;
+	}
+
+	size_t bytesPerPixel = getBytesPerPixel();
+
+	/// halving, the common case (tiles one level up): bands of rows through the 2x2 kernel
+	if (factor == 2)
+	{
+		size_t					bandRows = 8; // output rows per read
+		size_t					srcPitch = width * 2 * bytesPerPixel;
+		vector<unsigned char>	srcRows(2 * bandRows * srcPitch);
+
+		for (size_t y = 0; y < height; y += bandRows)
+		{
+			size_t rows = std::min(bandRows, height - y);
+
+			readRegion(row + y * 2, col, width * 2, rows * 2, srcRows.data());
+
+			PixelKernels::downsample2x2(srcRows.data(), srcPitch, width, rows, bytesPerPixel, dst + y * width * bytesPerPixel, width * bytesPerPixel);
+		}
+
+		return;
+	}
+	///
+
+	/// powers of two: one 2x2 pass per level; the source rows stream through a pair of rows per
+	/// level, so the memory is a band of source rows whatever the factor
+	if ((factor & (factor - 1)) == 0)
+	{
+		size_t levels = 1;
+
+		while (((size_t)1 << levels) < factor)
+			levels++;
+
+		size_t							bandRows = 16; // source rows per read, even
+		size_t							srcPitch = width * factor * bytesPerPixel;
+		vector<unsigned char>			srcRows(bandRows * srcPitch);
+		vector<vector<unsigned char> >	levelRows(levels);	// the pair of rows of level 1 .. levels - 1
+		vector<size_t>					levelRowCount(levels, 0);
+		size_t							dstRow = 0;
+
+		for (size_t level = 1; level < levels; level++)
+			levelRows[level].resize(2 * (srcPitch >> level));
+
+		for (size_t y = 0; y < height * factor; y += bandRows)
+		{
+			size_t rows = std::min(bandRows, height * factor - y);
+
+			readRegion(row + y, col, width * factor, rows, srcRows.data());
+
+			for (size_t r = 0; r < rows; r += 2)
+			{
+				const unsigned char*	src = &srcRows[r * srcPitch];
+				size_t					pitch = srcPitch;
+
+				/// down the levels for as long as a pair of rows completes
+				for (size_t level = 1; ; level++)
+				{
+					size_t			levelPitch = srcPitch >> level;
+					unsigned char*	out = level == levels ? dst + dstRow * levelPitch : &levelRows[level][levelRowCount[level] * levelPitch];
+
+					PixelKernels::downsample2x2(src, pitch, levelPitch / bytesPerPixel, 1, bytesPerPixel, out, levelPitch);
+
+					if (level == levels)
+					{
+						dstRow++;
+						break;
+					}
+
+					if (++levelRowCount[level] < 2)
+						break;
+
+					levelRowCount[level] = 0;
+					src = levelRows[level].data();
+					pitch = levelPitch;
+				}
+				///
+			}
+		}
+
+		return;
+	}
+	///
+
+	size_t					chunkRows = std::min(factor, (size_t)16);
+	size_t					srcPitch = width * factor * bytesPerPixel;
+	size_t					blockPixels = factor * factor;
+	vector<unsigned char>	srcRows(chunkRows * srcPitch);
+	vector<size_t>			sums(width * bytesPerPixel);
+
+	for (size_t y = 0; y < height; y++)
+	{
+		std::fill(sums.begin(), sums.end(), (size_t)0);
+
+		/// sum up the factor source rows of this output row, chunkRows at a time
+		for (size_t blockRow = 0; blockRow < factor; blockRow += chunkRows)
+		{
+			size_t rows = std::min(chunkRows, factor - blockRow);
+
+			readRegion(row + y * factor + blockRow, col, width * factor, rows, srcRows.data());
+
+			for (size_t r = 0; r < rows; r++)
+			{
+				const unsigned char* src = &srcRows[r * srcPitch];
+
+				for (size_t x = 0; x < width; x++)
+				{
+					for (size_t fx = 0; fx < factor; fx++)
+					{
+						for (size_t c = 0; c < bytesPerPixel; c++)
+							sums[x * bytesPerPixel + c] += *src++;
+					}
+				}
+			}
+		}
+		///
+
+		unsigned char* out = dst + y * width * bytesPerPixel;
+
+		for (size_t i = 0; i < sums.size(); i++)
+			out[i] = (unsigned char)((sums[i] + blockPixels / 2) / blockPixels);
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+MemoryImageSource::MemoryImageSource(ImageBuffer* imageBuffer, size_t bytesPerPixel)
+{
+	_imageBuffer = imageBuffer;
+	_bytesPerPixel = bytesPerPixel;
+}
+
+void MemoryImageSource::getDimension(size_t& width, size_t& height)
+{
+	_imageBuffer->getBufferDimension(width, height);
+}
+
+void MemoryImageSource::readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst)
+{
+	size_t srcWidth, srcHeight;
+
+	_imageBuffer->getBufferDimension(srcWidth, srcHeight);
+
+	copyRegion((const unsigned char*)_imageBuffer->getBuffer(), srcWidth, srcHeight, _bytesPerPixel, row, col, width, height, dst);
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+MappedImageSource::MappedImageSource()
+{
+	_mapping = NULL;
+	_mappingSize = 0;
+	_pixels = NULL;
+	_width = _height = 0;
+	_bytesPerPixel = 3;
+	_bgr = false;
+	_sequential = false;
+	_lastBandRow = 0;
+	_prefetchedRow = 0;
+
+#ifdef _WIN32
+	_fileHandle = INVALID_HANDLE_VALUE;
+	_mappingHandle = NULL;
+#else
+	_fileDescriptor = -1;
+#endif
+}
+
+MappedImageSource::~MappedImageSource()
+{
+#ifdef _WIN32
+	if (_mapping)
+		UnmapViewOfFile(_mapping);
+
+	if (_mappingHandle)
+		CloseHandle(_mappingHandle);
+
+	if (_fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(_fileHandle);
+#else
+	if (_mapping)
+		munmap(_mapping, _mappingSize);
+
+	if (_fileDescriptor >= 0)
+		close(_fileDescriptor);
+#endif
+
+	_mapping = NULL;
+}
+
+bool MappedImageSource::probeLayout(const string& filename, size_t fileSize, size_t& width, size_t& height, size_t& bytesPerPixel, size_t& headerBytes,
+									bool& bgr)
+{
+	bgr = false;
+
+	/// side car first
+	ifstream header(filename + ".hdr");
+
+	if (header.is_open())
+	{
+		header >> width >> height >> bytesPerPixel >> headerBytes;
+
+		bool valid = !header.fail() && width > 0 && height > 0 && bytesPerPixel > 0 && 
+					 headerBytes + width * height * bytesPerPixel <= fileSize;
+
+		string order;
+
+		if (valid && header >> order)
+			bgr = order == "bgr" && bytesPerPixel == 3;
+
+		return valid;
+	}
+	///
+
+	/// headerless square rgb
+	size_t side = (size_t)sqrt((double)(fileSize / 3));
+
+	while (side * side * 3 < fileSize)
+		side++;
+
+	if (side > 0 && side * side * 3 == fileSize)
+	{
+		width = height = side;
+		bytesPerPixel = 3;
+		headerBytes = 0;
+
+		return true;
+	}
+	///
+
+	return false;
+}
+
+bool MappedImageSource::readLayout(const string& filename, size_t& width, size_t& height, size_t& bytesPerPixel)
+{
+	size_t fileSize = 0;
+
+#ifdef _WIN32
+	struct _stat64 fileStat;
+
+	if (_stat64(filename.c_str(), &fileStat) == 0)
+		fileSize = (size_t)fileStat.st_size;
+#else
+	struct stat fileStat;
+
+	if (stat(filename.c_str(), &fileStat) == 0)
+		fileSize = (size_t)fileStat.st_size;
+#endif
+
+	size_t	headerBytes = 0;
+	bool	bgr;
+
+	return fileSize > 0 && probeLayout(filename, fileSize, width, height, bytesPerPixel, headerBytes, bgr);
+}
+
+MappedImageSource* MappedImageSource::open(const string& filename)
+{
+	MappedImageSource*	source = new MappedImageSource();
+	size_t				fileSize = 0;
+
+#ifdef _WIN32
+	source->_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	LARGE_INTEGER size;
+
+	if (source->_fileHandle != INVALID_HANDLE_VALUE && GetFileSizeEx(source->_fileHandle, &size))
+		fileSize = (size_t)size.QuadPart;
+#else
+	source->_fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+
+	struct stat fileStat;
+
+	if (source->_fileDescriptor >= 0 && fstat(source->_fileDescriptor, &fileStat) == 0)
+		fileSize = (size_t)fileStat.st_size;
+#endif
+
+	size_t headerBytes = 0;
+
+	if (fileSize == 0 || !probeLayout(filename, fileSize, source->_width, source->_height, source->_bytesPerPixel, headerBytes, source->_bgr))
+	{
+		cout << __FUNCTION__ << " " << filename << " can not be mapped, layout unknown" << endl;
+
+		delete source;
+		return NULL;
+	}
+
+	/// map it, nothing is read yet
+#ifdef _WIN32
+	source->_mappingHandle = CreateFileMappingA(source->_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (source->_mappingHandle)
+		source->_mapping = (unsigned char*)MapViewOfFile(source->_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, source->_fileDescriptor, 0);
+
+	if (mapping != MAP_FAILED)
+	{
+		source->_mapping = (unsigned char*)mapping;
+
+		madvise(mapping, fileSize, MADV_RANDOM); // tiles read sub rows, the readahead is done by hand
+	}
+#endif
+	///
+
+	if (source->_mapping == NULL)
+	{
+		cout << __FUNCTION__ << "Error, mapping " << filename << " failed" << endl;
+
+		delete source;
+		return NULL;
+	}
+
+	source->_mappingSize = fileSize;
+	source->_pixels = source->_mapping + headerBytes;
+
+	cout << __FUNCTION__ << " mapped " << filename << " " << source->_width << " x " << source->_height 
+		 << " x " << source->_bytesPerPixel << (source->_bgr ? " bgr" : "") << " (" << fileSize / (1024 * 1024) << " MB)" << endl;
+
+	return source;
+}
+
+void MappedImageSource::getDimension(size_t& width, size_t& height)
+{
+	width = _width;
+	height = _height;
+}
+
+void MappedImageSource::adviseRows(size_t firstRow, size_t rowCount, bool willNeed)
+{
+	if (firstRow >= _height || rowCount == 0)
+		return;
+
+	rowCount = std::min(rowCount, _height - firstRow);
+
+	size_t pitch = _width * _bytesPerPixel;
+	size_t first = (size_t)(_pixels - _mapping) + firstRow * pitch;
+	size_t last  = first + rowCount * pitch;
+
+#ifdef _WIN32
+	if (willNeed)
+	{
+		WIN32_MEMORY_RANGE_ENTRY range = { _mapping + first, last - first };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	/// madvise wants page aligned ranges; round inwards when dropping so no neighbour row is touched
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	if (willNeed)
+		first = first / pageSize * pageSize;
+	else
+	{
+		first = (first + pageSize - 1) / pageSize * pageSize;
+		last  = last / pageSize * pageSize;
+	}
+
+	if (last > first)
+		madvise(_mapping + first, last - first, willNeed ? MADV_WILLNEED : MADV_DONTNEED);
+	///
+#endif
+}
+
+void MappedImageSource::setSequential(bool sequential)
+{
+	lock_guard<mutex> guard(_adviceLock);
+
+	_sequential = sequential;
+	_lastBandRow = _prefetchedRow = 0;
+}
+
+void MappedImageSource::readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst)
+{
+	/// sequential sweep: moved on to a new band of rows
+	{
+		lock_guard<mutex> guard(_adviceLock);
+
+		if (_sequential && row != _lastBandRow)
+		{
+			if (row > _lastBandRow)
+				adviseRows(_lastBandRow, row - _lastBandRow, false); // done with everything above
+
+			_lastBandRow = row;
+		}
+
+		if (_sequential && row + height > _prefetchedRow)
+		{
+			adviseRows(row + height, height, true); // next band, read ahead while this one is copied
+
+			_prefetchedRow = row + 2 * height;
+		}
+	}
+	///
+
+	copyRegion(_pixels, _width, _height, _bytesPerPixel, row, col, width, height, dst);
+
+	if (_bgr)
+		PixelKernels::swapRedBlue(dst, width * height, dst);
+}
+//////////////////////////////////////////////////////////////////////////////////
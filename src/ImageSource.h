@@ -0,0 +1,121 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "Image.h"
+
+#include <mutex>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// cpu side access to the source pixels, independent of gl
+///		- pixels are 8 bit per channel, rows tightly packed, row 0 first
+///		- readRegion() copies a w x h sub rectangle into a tightly packed buffer; the part of the
+///		  region that falls outside the image is filled with zeros (edge tiles)
+///		- readRegion() may be called from several threads at once
+///
+class ImageSource
+{
+public:
+	virtual ~ImageSource() {};
+
+	virtual void	getDimension(size_t& width, size_t& height) = 0;
+	virtual size_t	getBytesPerPixel() = 0;
+
+	virtual void	readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst) = 0;
+
+	/// the reads sweep the image top down in bands from now on (a full build), the source may
+	/// read ahead of them and drop what they left behind; off, the default, for reads in any order
+	virtual void	setSequential(bool sequential) {};
+
+	/// width x height pixels, each the average of a factor x factor block of the source region
+	/// starting at row, col; reads a few source rows at a time
+	///		- a power of two factor is halved level by level with the 2x2 kernel, the same rounding
+	///		  as the tiles generatePixels() builds level by level
+	void	readRegionDownsampled(size_t row, size_t col, size_t width, size_t height, size_t factor, unsigned char* dst);
+
+	size_t	getRegionSize(size_t width, size_t height) { return width * height * getBytesPerPixel(); };
+
+protected:
+	static void	copyRegion(const unsigned char* src, size_t srcWidth, size_t srcHeight, size_t bytesPerPixel,
+						   size_t row, size_t col, size_t width, size_t height, unsigned char* dst);
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// image source over an ImageBuffer that is fully loaded in memory
+///		- does not take ownership of the buffer
+///
+class MemoryImageSource : public ImageSource
+{
+public:
+	MemoryImageSource(ImageBuffer* imageBuffer, size_t bytesPerPixel = 3); // ImageBuffer holds rgb
+
+	void	getDimension(size_t& width, size_t& height);
+	size_t	getBytesPerPixel() { return _bytesPerPixel; };
+
+	void	readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst);
+
+protected:
+	ImageBuffer*	_imageBuffer;
+	size_t			_bytesPerPixel;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// image source over a memory mapped raw image file, nothing is read up front
+///		- readRegion() copies straight out of the mapping, so only the pages of the tiles that
+///		  are being cut are resident
+///		- sequential reads (setSequential()) advance along tile rows: the band below the one
+///		  being read is prefetched (MADV_WILLNEED) and the bands above it are dropped from the
+///		  process (MADV_DONTNEED), which keeps the resident set at about two tile rows
+///		- other reads (tile reloads, in any order, from several threads) get no advice beyond the
+///		  MADV_RANDOM of the whole mapping; the kernel drops their pages under memory pressure
+///		- layout comes from a "<file>.hdr" side car ("width height bytesPerPixel headerBytes", plus
+///		  "bgr" for 3 byte pixels stored blue first, swapped to rgb as they are read), or, without
+///		  one, a headerless square rgb file is assumed if the file size fits
+///		- open() returns NULL if the file can not be mapped or its layout is not known
+///
+class MappedImageSource : public ImageSource
+{
+public:
+	static MappedImageSource* open(const string& filename);
+
+	/// layout only, from the side car or the file size; nothing is mapped
+	static bool	readLayout(const string& filename, size_t& width, size_t& height, size_t& bytesPerPixel);
+
+	~MappedImageSource();
+
+	void	getDimension(size_t& width, size_t& height);
+	size_t	getBytesPerPixel() { return _bytesPerPixel; };
+
+	void	readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst);
+	void	setSequential(bool sequential);
+
+protected:
+	MappedImageSource();
+
+	static bool	probeLayout(const string& filename, size_t fileSize, size_t& width, size_t& height, size_t& bytesPerPixel, size_t& headerBytes,
+							bool& bgr);
+
+	void	adviseRows(size_t firstRow, size_t rowCount, bool willNeed);
+
+	unsigned char*	_mapping;
+	size_t			_mappingSize;
+	const unsigned char* _pixels; // _mapping + header
+
+	size_t			_width, _height;
+	size_t			_bytesPerPixel;
+	bool			_bgr;			// stored blue first
+
+	mutex			_adviceLock;	// guards the three below, the copy itself runs unlocked
+	bool			_sequential;
+	size_t			_lastBandRow;	// first row of the band read last
+	size_t			_prefetchedRow;	// rows below this were already prefetched
+
+#ifdef _WIN32
+	void*			_fileHandle;
+	void*			_mappingHandle;
+#else
+	int				_fileDescriptor;
+#endif
+};
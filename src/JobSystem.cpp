@@ -0,0 +1,196 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+//////////////////////////////////////////////////////////////////////////////////
+static thread_local JobSystem*	__currentJobSystem = NULL;	// set on worker threads only
+static thread_local size_t		__currentWorkerIndex = 0;
+//////////////////////////////////////////////////////////////////////////////////
+
+JobSystem::JobSystem(size_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		size_t hardwareThreads = (size_t)thread::hardware_concurrency();
+
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	_quit = false;
+	_queuedTasks = 0;
+
+	for (size_t i = 0; i <= workerCount; i++)
+		_queues.push_back(unique_ptr<TaskQueue>(new TaskQueue()));
+
+	for (size_t i = 0; i < workerCount; i++)
+		_threads.push_back(thread(&JobSystem::workerMain, this, i));
+
+	cout << __FUNCTION__ << " started " << workerCount << " worker threads" << endl;
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		lock_guard<mutex> guard(_sleepLock);
+		_quit = true;
+	}
+
+	_wakeUp.notify_all();
+
+	for (thread& worker : _threads)
+		worker.join();
+
+	_threads.clear();
+}
+
+size_t JobSystem::getQueueIndex()
+{
+	return __currentJobSystem == this ? __currentWorkerIndex : _queues.size() - 1;
+}
+
+void JobSystem::submit(const Job& job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending++;
+
+	TaskQueue& queue = *_queues[getQueueIndex()];
+
+	{
+		lock_guard<mutex> guard(queue.lock);
+		queue.tasks.push_back({ job, counter });
+	}
+
+	{
+		lock_guard<mutex> guard(_sleepLock); // pairs with the predicate check of sleeping workers
+		_queuedTasks++;
+	}
+
+	_wakeUp.notify_one();
+}
+
+bool JobSystem::popOrSteal(size_t queueIndex, Task& task)
+{
+	/// own queue, newest first
+	{
+		TaskQueue& queue = *_queues[queueIndex];
+		lock_guard<mutex> guard(queue.lock);
+
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			_queuedTasks--;
+
+			return true;
+		}
+	}
+	///
+
+	/// steal from the others, oldest first
+	for (size_t i = 1; i < _queues.size(); i++)
+	{
+		TaskQueue& queue = *_queues[(queueIndex + i) % _queues.size()];
+		lock_guard<mutex> guard(queue.lock);
+
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			_queuedTasks--;
+
+			return true;
+		}
+	}
+	///
+
+	return false;
+}
+
+bool JobSystem::popOwn(const JobCounter& counter, Task& task)
+{
+	TaskQueue& queue = *_queues.back();
+	lock_guard<mutex> guard(queue.lock);
+
+	for (size_t i = queue.tasks.size(); i-- > 0; )
+	{
+		if (queue.tasks[i].counter != &counter)
+			continue;
+
+		task = std::move(queue.tasks[i]);
+		queue.tasks.erase(queue.tasks.begin() + i);
+		_queuedTasks--;
+
+		return true;
+	}
+
+	return false;
+}
+
+void JobSystem::runTask(Task& task)
+{
+	task.job();
+
+	if (task.counter)
+		task.counter->pending--;
+}
+
+void JobSystem::workerMain(size_t workerIndex)
+{
+	__currentJobSystem = this;
+	__currentWorkerIndex = workerIndex;
+
+	while (true)
+	{
+		Task task;
+
+		if (popOrSteal(workerIndex, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		unique_lock<mutex> guard(_sleepLock);
+
+		_wakeUp.wait(guard, [this]() { return _quit || _queuedTasks > 0; });
+
+		if (_quit)
+			break;
+	}
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	size_t	queueIndex = getQueueIndex();
+	bool	ownOnly = __currentJobSystem != this && !_threads.empty();
+
+	while (counter.pending > 0)
+	{
+		Task task;
+
+		if (ownOnly ? popOwn(counter, task) : popOrSteal(queueIndex, task))
+			runTask(task);
+		else
+			this_thread::yield(); // the last jobs are running on other threads
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const function<void(size_t, size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	if (grain == 0)
+		grain = 1;
+
+	JobCounter counter;
+
+	for (size_t begin = 0; begin < count; begin += grain)
+	{
+		size_t end = std::min(begin + grain, count);
+
+		submit([&body, begin, end]() { body(begin, end); }, &counter);
+	}
+
+	wait(counter);
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// counts the unfinished jobs of a group, JobSystem::wait() returns once it reaches zero
+///
+struct JobCounter
+{
+	atomic<size_t>	pending;
+
+	JobCounter() : pending(0) {};
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// work stealing thread pool
+///		- every worker owns a deque, it pushes and pops at the back (newest first, cache warm)
+///		  and idle workers steal from the front of the others (oldest first, biggest chunks)
+///		- threads that are not workers (the gl thread) submit to a shared queue
+///		- wait() does not block, the waiting thread runs jobs until its counter drops to zero,
+///		  so the gl thread helps out and a pool without workers still works; a thread that is
+///		  not a worker only runs the jobs of its own counter while there are workers, a frame
+///		  never waits for a tile load someone else queued
+///		- jobs must not touch gl, only the thread owning the context does
+///
+class JobSystem
+{
+public:
+	typedef function<void()> Job;
+
+	JobSystem(size_t workerCount = 0); // 0: one worker per hardware thread, minus the caller
+	~JobSystem();
+
+	void	submit(const Job& job, JobCounter* counter = NULL);
+	void	wait(JobCounter& counter);
+
+	/// body(begin, end) on chunks of at most grain items, returns when all are done
+	void	parallelFor(size_t count, size_t grain, const function<void(size_t, size_t)>& body);
+
+	size_t	getWorkerCount() { return _threads.size(); };
+
+protected:
+	struct Task
+	{
+		Job			job;
+		JobCounter*	counter;
+	};
+
+	struct TaskQueue
+	{
+		mutex		lock;
+		deque<Task>	tasks;
+	};
+
+	vector<thread>					_threads;
+	vector<unique_ptr<TaskQueue> >	_queues;	// one per worker, the last one is shared by all other threads
+
+	atomic<bool>					_quit;
+	atomic<size_t>					_queuedTasks;
+	mutex							_sleepLock;
+	condition_variable				_wakeUp;
+
+	size_t	getQueueIndex();
+	bool	popOrSteal(size_t queueIndex, Task& task);
+	bool	popOwn(const JobCounter& counter, Task& task); // from the shared queue
+	void	runTask(Task& task);
+	void	workerMain(size_t workerIndex);
+};
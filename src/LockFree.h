@@ -0,0 +1,97 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+#include <atomic>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// single producer / single consumer ring, lock free
+///		- push() from one thread, pop() from one (possibly other) thread
+///		- push() fails when the ring is full, the caller drops the item rather than waiting
+///
+template <class T, size_t CAPACITY>
+class SpscRing
+{
+public:
+	SpscRing() : _head(0), _tail(0) {};
+
+	bool push(const T& item)
+	{
+		size_t head = _head.load(memory_order_relaxed);
+		size_t next = (head + 1) % CAPACITY;
+
+		if (next == _tail.load(memory_order_acquire))
+			return false;
+
+		_items[head] = item;
+		_head.store(next, memory_order_release);
+
+		return true;
+	}
+
+	bool pop(T& item)
+	{
+		size_t tail = _tail.load(memory_order_relaxed);
+
+		if (tail == _head.load(memory_order_acquire))
+			return false;
+
+		item = _items[tail];
+		_tail.store((tail + 1) % CAPACITY, memory_order_release);
+
+		return true;
+	}
+
+	bool isEmpty() const { return _tail.load(memory_order_acquire) == _head.load(memory_order_acquire); };
+
+protected:
+	T				_items[CAPACITY];
+	atomic<size_t>	_head;	// next write, owned by the producer
+	atomic<size_t>	_tail;	// next read, owned by the consumer
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// lock free hand over of the latest value from one writer thread to one reader thread
+///		- three buffers: the writer owns one, the reader owns one, the middle one is swapped in
+///		  by publish() and out by consume(), so neither side ever waits for the other
+///		- the reader always gets the newest published value, older ones are skipped
+///
+template <class T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : _write(0), _read(1), _middle(2) {};
+
+	/// writer side
+	void publish(const T& value)
+	{
+		_buffers[_write] = value;
+		_write = _middle.exchange(_write | NEW_VALUE, memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	/// reader side, false if nothing was published since the last consume()
+	bool consume(T& value)
+	{
+		if ((_middle.load(memory_order_acquire) & NEW_VALUE) == 0)
+			return false;
+
+		_read = _middle.exchange(_read, memory_order_acq_rel) & INDEX_MASK;
+		value = _buffers[_read];
+
+		return true;
+	}
+
+	bool hasNewValue() const { return (_middle.load(memory_order_acquire) & NEW_VALUE) != 0; };
+
+protected:
+	static const unsigned int INDEX_MASK = 3;
+	static const unsigned int NEW_VALUE = 4;
+
+	T						_buffers[3];
+	unsigned int			_write;		// owned by the writer
+	unsigned int			_read;		// owned by the reader
+	atomic<unsigned int>	_middle;	// index of the middle buffer, plus NEW_VALUE once published
+};
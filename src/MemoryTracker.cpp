@@ -0,0 +1,175 @@
+#include "MemoryTracker.h"
+#include "AsyncLogger.h"
+
+#include <iomanip>
+
+//////////////////////////////////////////////////////////////////////////////////
+MemoryTracker& MemoryTracker::getInstance()
+{
+	static MemoryTracker tracker;
+
+	return tracker;
+}
+
+MemoryTracker::MemoryTracker()
+{
+	for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; category++)
+		_currentBytes[category] = _peakBytes[category] = 0;
+
+	_totalBytes[0] = _totalBytes[1] = 0;
+	_peakTotalBytes[0] = _peakTotalBytes[1] = 0;
+}
+
+const char* MemoryTracker::getCategoryName(MemoryCategory category)
+{
+	switch (category)
+	{
+		case MEMORY_SOURCE_IMAGE:		return "source image";
+		case MEMORY_TILE_UPLOADS:		return "queued tile uploads";
+		case MEMORY_SCENE_TABLES:		return "pyramid / tile table";
+		case MEMORY_TILE_TEXTURES:		return "tile textures";
+		case MEMORY_TILE_GEOMETRY:		return "tile geometry";
+		case MEMORY_UPLOAD_RING:		return "upload ring";
+		case MEMORY_VIRTUAL_TEXTURE:	return "virtual texture";
+		case MEMORY_OVERVIEW:			return "overview map";
+		case MEMORY_CAMERA_ICON:		return "camera icon";
+		case MEMORY_RENDER_TARGETS:		return "render targets";
+		default:						return "unknown";
+	}
+}
+
+void MemoryTracker::allocate(MemoryCategory category, uint64_t owner, size_t bytes)
+{
+	lock_guard<mutex> guard(_lock);
+
+	size_t gpu = isGpuCategory(category) ? 1 : 0;
+
+	_owners[category][owner] += bytes;
+
+	_currentBytes[category] += bytes;
+	_totalBytes[gpu] += bytes;
+
+	_peakBytes[category] = max(_peakBytes[category], _currentBytes[category]);
+	_peakTotalBytes[gpu] = max(_peakTotalBytes[gpu], _totalBytes[gpu]);
+}
+
+void MemoryTracker::release(MemoryCategory category, uint64_t owner, size_t bytes)
+{
+	lock_guard<mutex> guard(_lock);
+
+	map<uint64_t, size_t>::iterator entry = _owners[category].find(owner);
+
+	if (entry == _owners[category].end())
+		return;
+
+	bytes = min(bytes, entry->second);
+	entry->second -= bytes;
+
+	if (entry->second == 0)
+		_owners[category].erase(entry);
+
+	subtract(category, bytes);
+}
+
+void MemoryTracker::releaseOwner(MemoryCategory category, uint64_t owner)
+{
+	lock_guard<mutex> guard(_lock);
+
+	map<uint64_t, size_t>::iterator entry = _owners[category].find(owner);
+
+	if (entry == _owners[category].end())
+		return;
+
+	subtract(category, entry->second);
+
+	_owners[category].erase(entry);
+}
+
+/// _lock held
+///
+void MemoryTracker::subtract(MemoryCategory category, size_t bytes)
+{
+	_currentBytes[category] -= bytes;
+	_totalBytes[isGpuCategory(category) ? 1 : 0] -= bytes;
+}
+
+void MemoryTracker::resetPeaks()
+{
+	lock_guard<mutex> guard(_lock);
+
+	for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; category++)
+		_peakBytes[category] = _currentBytes[category];
+
+	_peakTotalBytes[0] = _totalBytes[0];
+	_peakTotalBytes[1] = _totalBytes[1];
+}
+
+void MemoryTracker::printBreakdown(const string& title)
+{
+	lock_guard<mutex> guard(_lock);
+
+	const double	megabyte = 1024.0 * 1024.0;
+	LogStream		breakdown; // one block, not interleaved with other output
+
+	breakdown << "------------------------ memory: " << title << " ------------------------" << endl;
+	breakdown << left << setw(24) << "category" << right << setw(6) << "" << setw(10) << "owners" << setw(14) << "current MB" << setw(12) << "peak MB" << endl;
+	breakdown << fixed << setprecision(1);
+
+	for (size_t category = 0; category < MEMORY_CATEGORY_COUNT; category++)
+	{
+		if (_peakBytes[category] == 0)
+			continue;
+
+		breakdown << left << setw(24) << getCategoryName((MemoryCategory)category) << right << setw(6) << (isGpuCategory((MemoryCategory)category) ? "gpu" : "cpu")
+				  << setw(10) << _owners[category].size() << setw(14) << _currentBytes[category] / megabyte << setw(12) << _peakBytes[category] / megabyte << endl;
+	}
+
+	breakdown << left << setw(24) << "total" << right << setw(6) << "cpu" << setw(10) << "" << setw(14) << _totalBytes[0] / megabyte << setw(12) << _peakTotalBytes[0] / megabyte << endl;
+	breakdown << left << setw(24) << "total" << right << setw(6) << "gpu" << setw(10) << "" << setw(14) << _totalBytes[1] / megabyte << setw(12) << _peakTotalBytes[1] / megabyte << endl;
+	breakdown << "==============================================================" << endl;
+}
+
+size_t MemoryTracker::getBytes(MemoryCategory category, uint64_t owner)
+{
+	lock_guard<mutex> guard(_lock);
+
+	map<uint64_t, size_t>::iterator entry = _owners[category].find(owner);
+
+	return entry == _owners[category].end() ? 0 : entry->second;
+}
+
+size_t MemoryTracker::getCurrentBytes(MemoryCategory category)
+{
+	lock_guard<mutex> guard(_lock);
+
+	return _currentBytes[category];
+}
+
+size_t MemoryTracker::getPeakBytes(MemoryCategory category)
+{
+	lock_guard<mutex> guard(_lock);
+
+	return _peakBytes[category];
+}
+
+size_t MemoryTracker::getOwnerCount(MemoryCategory category)
+{
+	lock_guard<mutex> guard(_lock);
+
+	return _owners[category].size();
+}
+
+size_t MemoryTracker::getTotalBytes(bool gpu)
+{
+	lock_guard<mutex> guard(_lock);
+
+	return _totalBytes[gpu ? 1 : 0];
+}
+
+size_t MemoryTracker::getPeakTotalBytes(bool gpu)
+{
+	lock_guard<mutex> guard(_lock);
+
+	return _peakTotalBytes[gpu ? 1 : 0];
+}
+//////////////////////////////////////////////////////////////////////////////////
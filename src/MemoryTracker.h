@@ -0,0 +1,80 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+#include <map>
+#include <mutex>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// what an allocation holds
+///
+enum MemoryCategory
+{
+	MEMORY_SOURCE_IMAGE = 0,	// cpu, a fully loaded image (mapped images are the os page cache's)
+	MEMORY_TILE_UPLOADS,		// cpu, tile pixels queued for upload, by tile
+	MEMORY_SCENE_TABLES,		// cpu, pyramid nodes and the tile table
+	MEMORY_TILE_TEXTURES,		// gpu, texture array pages
+	MEMORY_TILE_GEOMETRY,		// gpu, batch renderer buffers
+	MEMORY_UPLOAD_RING,			// gpu, pixel buffers of the upload ring
+	MEMORY_VIRTUAL_TEXTURE,		// gpu, page table, quad and feedback target
+	MEMORY_OVERVIEW,			// gpu, overview texture and its framebuffer
+	MEMORY_CAMERA_ICON,			// gpu
+	MEMORY_RENDER_TARGETS,		// gpu, the headless framebuffer
+	MEMORY_CATEGORY_COUNT
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// bookkeeping of the big allocations of a scene, cpu and gpu
+///		- an allocation is tagged by its category and an owner id: the tile node for per tile
+///		  memory, getGLOwner() for gl objects, the address for cpu objects
+///		- allocate() adds to the owner's bytes, release() takes them off, releaseOwner() drops
+///		  the owner; current and peak bytes are kept per category and in total
+///		- gl sizes are the texel / buffer bytes asked for, what the driver pads or keeps in
+///		  system memory on top of that is not seen
+///		- one process wide instance, any thread
+///
+class MemoryTracker
+{
+public:
+	static MemoryTracker&	getInstance();
+
+	void	allocate(MemoryCategory category, uint64_t owner, size_t bytes);
+	void	release(MemoryCategory category, uint64_t owner, size_t bytes);
+	void	releaseOwner(MemoryCategory category, uint64_t owner);
+
+	/// the peaks restart from the current bytes, e.g. at the start of a scene build
+	void	resetPeaks();
+
+	/// one block per category with entries, and the cpu / gpu totals
+	void	printBreakdown(const string& title);
+
+	/// owner id of a gl object, kind: GL_TEXTURE, GL_BUFFER, GL_RENDERBUFFER
+	static uint64_t		getGLOwner(GLenum kind, GLuint name) { return ((uint64_t)kind << 32) | name; };
+
+	static const char*	getCategoryName(MemoryCategory category);
+	static bool			isGpuCategory(MemoryCategory category) { return category >= MEMORY_TILE_TEXTURES; };
+
+	/// begin - getters / accessors
+	size_t	getBytes(MemoryCategory category, uint64_t owner);
+	size_t	getCurrentBytes(MemoryCategory category);
+	size_t	getPeakBytes(MemoryCategory category);
+	size_t	getOwnerCount(MemoryCategory category);
+	size_t	getTotalBytes(bool gpu);
+	size_t	getPeakTotalBytes(bool gpu);
+	/// end - getters / accessors
+
+protected:
+	MemoryTracker();
+
+	mutex					_lock;
+	map<uint64_t, size_t>	_owners[MEMORY_CATEGORY_COUNT];
+	size_t					_currentBytes[MEMORY_CATEGORY_COUNT];
+	size_t					_peakBytes[MEMORY_CATEGORY_COUNT];
+	size_t					_totalBytes[2];		// cpu, gpu
+	size_t					_peakTotalBytes[2];
+
+	void	subtract(MemoryCategory category, size_t bytes);
+};
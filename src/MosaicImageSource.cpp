@@ -0,0 +1,280 @@
+#include "MosaicImageSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+//////////////////////////////////////////////////////////////////////////////////
+MosaicImageSource::MosaicImageSource()
+{
+	_width = _height = 0;
+	_openFrames = 0;
+	_sequential = false;
+}
+
+MosaicImageSource::~MosaicImageSource()
+{
+	for (MosaicFrame& frame : _frames)
+	{
+		if (frame.source)
+			delete frame.source;
+
+		frame.source = NULL;
+	}
+}
+
+bool MosaicImageSource::isManifest(const string& filename)
+{
+	static const string extension = ".mosaic";
+
+	return filename.size() > extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/// the lines of a manifest, files made relative to it; no image is looked at
+///
+struct ManifestEntry
+{
+	string	filename;
+	double	easting, northing;
+};
+
+static bool readManifest(const string& manifestFilename, vector<ManifestEntry>& entries, double& pixelSize)
+{
+	ifstream manifest(manifestFilename);
+
+	if (!manifest.is_open())
+	{
+		cout << __FUNCTION__ << "Error, can not open " << manifestFilename << endl;
+		return false;
+	}
+
+	/// images are relative to the manifest
+	size_t	slash = manifestFilename.find_last_of("/\\");
+	string	directory = slash == string::npos ? "" : manifestFilename.substr(0, slash + 1);
+	///
+
+	string line;
+
+	pixelSize = 1.0;
+
+	while (getline(manifest, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		istringstream	fields(line);
+		string			name;
+
+		if (!(fields >> name))
+			continue;
+
+		if (name == "pixelSize")
+		{
+			fields >> pixelSize;
+			continue;
+		}
+
+		ManifestEntry entry;
+
+		if (!(fields >> entry.easting >> entry.northing))
+		{
+			cout << __FUNCTION__ << " malformed manifest line, skipped: " << line << endl;
+			continue;
+		}
+
+		bool absolute = name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':');
+
+		entry.filename = absolute ? name : directory + name;
+
+		entries.push_back(entry);
+	}
+
+	return true;
+}
+///
+
+MosaicImageSource* MosaicImageSource::open(const string& manifestFilename)
+{
+	struct Placement
+	{
+		string	filename;
+		double	easting, northing;
+		size_t	width, height;
+	};
+
+	vector<ManifestEntry>	entries;
+	vector<Placement>		placements;
+	double					pixelSize = 1.0;
+
+	if (!readManifest(manifestFilename, entries, pixelSize))
+		return NULL;
+
+	/// the layout of every image, no pixels
+	for (const ManifestEntry& entry : entries)
+	{
+		Placement placement;
+
+		placement.filename = entry.filename;
+		placement.easting = entry.easting;
+		placement.northing = entry.northing;
+
+		size_t bytesPerPixel;
+
+		if (!MappedImageSource::readLayout(placement.filename, placement.width, placement.height, bytesPerPixel) || bytesPerPixel != 3)
+		{
+			cout << __FUNCTION__ << " " << placement.filename << " layout unknown or not rgb, skipped" << endl;
+			continue;
+		}
+
+		placements.push_back(placement);
+	}
+	///
+
+	if (placements.empty() || !(pixelSize > 0.0))
+	{
+		cout << __FUNCTION__ << "Error, no usable images in " << manifestFilename << endl;
+		return NULL;
+	}
+
+	/// north up: rows run south from the northernmost edge, cols east from the westernmost one
+	double west = placements[0].easting;
+	double north = placements[0].northing;
+
+	for (const Placement& placement : placements)
+	{
+		west = min(west, placement.easting);
+		north = max(north, placement.northing);
+	}
+
+	MosaicImageSource*	mosaic = new MosaicImageSource();
+	vector<RTreeRect>	footprints;
+
+	for (const Placement& placement : placements)
+	{
+		MosaicFrame frame;
+
+		frame.filename = placement.filename;
+		frame.col = (size_t)floor((placement.easting - west) / pixelSize + 0.5);
+		frame.row = (size_t)floor((north - placement.northing) / pixelSize + 0.5);
+		frame.width = placement.width;
+		frame.height = placement.height;
+		frame.source = NULL;
+		frame.failed = false;
+
+		mosaic->_width = max(mosaic->_width, frame.col + frame.width);
+		mosaic->_height = max(mosaic->_height, frame.row + frame.height);
+
+		mosaic->_frames.push_back(frame);
+		footprints.push_back(RTreeRect((double)frame.col, (double)frame.row, (double)(frame.col + frame.width), (double)(frame.row + frame.height)));
+	}
+
+	mosaic->_index.build(footprints);
+	///
+
+	cout << __FUNCTION__ << " " << manifestFilename << ": " << mosaic->_frames.size() << " images, "
+		 << mosaic->_width << " x " << mosaic->_height << endl;
+
+	return mosaic;
+}
+
+bool MosaicImageSource::getImageFilenames(const string& manifestFilename, vector<string>& filenames)
+{
+	vector<ManifestEntry>	entries;
+	double					pixelSize;
+
+	if (!readManifest(manifestFilename, entries, pixelSize))
+		return false;
+
+	for (const ManifestEntry& entry : entries)
+		filenames.push_back(entry.filename);
+
+	return true;
+}
+
+void MosaicImageSource::setSequential(bool sequential)
+{
+	lock_guard<mutex> guard(_openLock);
+
+	_sequential = sequential;
+
+	for (MosaicFrame& frame : _frames)
+	{
+		if (frame.source)
+			frame.source->setSequential(sequential);
+	}
+}
+
+void MosaicImageSource::getDimension(size_t& width, size_t& height)
+{
+	width = _width;
+	height = _height;
+}
+
+ImageSource* MosaicImageSource::getSource(size_t frame)
+{
+	lock_guard<mutex> guard(_openLock);
+
+	MosaicFrame& mosaicFrame = _frames[frame];
+
+	if (mosaicFrame.source == NULL && !mosaicFrame.failed)
+	{
+		mosaicFrame.source = MappedImageSource::open(mosaicFrame.filename);
+		mosaicFrame.failed = mosaicFrame.source == NULL;
+
+		if (mosaicFrame.source)
+			_openFrames++;
+
+		if (mosaicFrame.source && _sequential)
+			mosaicFrame.source->setSequential(true);
+	}
+
+	return mosaicFrame.source;
+}
+
+void MosaicImageSource::readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst)
+{
+	size_t bytesPerPixel = getBytesPerPixel();
+
+	memset(dst, 0, width * height * bytesPerPixel);
+
+	/// the frames under the region, painted in manifest order
+	static thread_local vector<size_t> frames;
+
+	frames.clear();
+
+	_index.query(RTreeRect((double)col, (double)row, (double)(col + width), (double)(row + height)), frames);
+
+	sort(frames.begin(), frames.end());
+	///
+
+	static thread_local vector<unsigned char> part;
+
+	for (size_t frame : frames)
+	{
+		const MosaicFrame& mosaicFrame = _frames[frame];
+
+		/// overlap of the region and the frame, in mosaic pixels
+		size_t firstRow = max(row, mosaicFrame.row);
+		size_t firstCol = max(col, mosaicFrame.col);
+		size_t lastRow  = min(row + height, mosaicFrame.row + mosaicFrame.height);
+		size_t lastCol  = min(col + width, mosaicFrame.col + mosaicFrame.width);
+		///
+
+		ImageSource* source = getSource(frame);
+
+		if (source == NULL || lastRow <= firstRow || lastCol <= firstCol)
+			continue;
+
+		size_t partWidth = lastCol - firstCol;
+		size_t partPitch = partWidth * bytesPerPixel;
+
+		part.resize((lastRow - firstRow) * partPitch);
+
+		source->readRegion(firstRow - mosaicFrame.row, firstCol - mosaicFrame.col, partWidth, lastRow - firstRow, part.data());
+
+		for (size_t y = firstRow; y < lastRow; y++)
+			memcpy(dst + ((y - row) * width + (firstCol - col)) * bytesPerPixel, &part[(y - firstRow) * partPitch], partPitch);
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
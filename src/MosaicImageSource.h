@@ -0,0 +1,73 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "ImageSource.h"
+#include "RTree.h"
+
+#include <mutex>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// one source image of a mosaic, placed in mosaic pixels
+///
+struct MosaicFrame
+{
+	string			filename;
+	size_t			row, col;		// upper left corner in the mosaic
+	size_t			width, height;
+	ImageSource*	source;			// opened on the first read that needs it
+	bool			failed;			// could not be opened, reads as blank
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// image source over many georeferenced images, one virtual image the size of their union
+///		- the manifest is a text file, one image per line: "<file> <easting> <northing>" of its
+///		  upper left corner, files relative to the manifest; "pixelSize <map units>" (1 if not
+///		  given) turns map units into pixels; '#' starts a comment
+///		- open() reads the manifest and the layout of every image (side car / file size) only,
+///		  the images are mapped by the first readRegion() that touches them
+///		- an r-tree over the frame footprints finds the images under a region; where images
+///		  overlap, the later one in the manifest wins, uncovered pixels are zero
+///		- everything downstream (tile pyramid, residency, tile cache) sees a single image; a tile
+///		  cache is keyed on the manifest and the size and modification time of every image in it
+///
+class MosaicImageSource : public ImageSource
+{
+public:
+	static MosaicImageSource* open(const string& manifestFilename);
+
+	/// by extension, ".mosaic"
+	static bool	isManifest(const string& filename);
+
+	/// the images the manifest lists, in its order, whether they exist or not
+	static bool	getImageFilenames(const string& manifestFilename, vector<string>& filenames);
+
+	~MosaicImageSource();
+
+	void	getDimension(size_t& width, size_t& height);
+	size_t	getBytesPerPixel() { return 3; };
+
+	void	readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst);
+	void	setSequential(bool sequential); // passed on to the images, the ones opened later too
+
+	/// begin - getters / accessors
+	size_t				getFrameCount() { return _frames.size(); };
+	const MosaicFrame&	getFrame(size_t frame) { return _frames[frame]; };
+	size_t				getOpenFrameCount() { return _openFrames; };
+	/// end - getters / accessors
+
+protected:
+	MosaicImageSource();
+
+	vector<MosaicFrame>	_frames;
+	RTree				_index;		// footprints, x: cols, y: rows
+	size_t				_width, _height;
+
+	mutex				_openLock;	// guards the lazy open of the frames
+	size_t				_openFrames;
+	bool				_sequential;
+
+	ImageSource*	getSource(size_t frame);
+};
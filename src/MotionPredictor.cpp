@@ -0,0 +1,64 @@
+#include "MotionPredictor.h"
+
+#include <cmath>
+
+//////////////////////////////////////////////////////////////////////////////////
+MotionPredictor::MotionPredictor()
+{
+	_jumps = 0;
+
+	reset();
+}
+
+void MotionPredictor::reset()
+{
+	_count = 0;
+	_newest = 0;
+	_velocity = glm::vec3(0.0f, 0.0f, 0.0f);
+	_angularVelocity = 0.0f;
+}
+
+void MotionPredictor::addFrame(const glm::vec3& position, float rotationAngle, size_t jumps)
+{
+	if (jumps != _jumps)
+	{
+		reset();
+
+		_jumps = jumps;
+	}
+
+	_newest = (_newest + 1) % HISTORY_FRAMES;
+	_positions[_newest] = position;
+	_angles[_newest] = rotationAngle;
+
+	if (_count < HISTORY_FRAMES)
+		_count++;
+
+	/// mean change per frame, from the oldest frame kept to the newest
+	if (_count > 1)
+	{
+		size_t oldest = (_newest + HISTORY_FRAMES + 1 - _count) % HISTORY_FRAMES;
+		float  frames = (float)(_count - 1);
+
+		_velocity = (_positions[_newest] - _positions[oldest]) / frames;
+		_angularVelocity = (_angles[_newest] - _angles[oldest]) / frames;
+	}
+	///
+}
+
+bool MotionPredictor::predict(size_t framesAhead, glm::vec3& position, float& rotationAngle)
+{
+	static const float STILL = 1.0e-6f;
+
+	bool moving = fabs(_velocity.x) > STILL || fabs(_velocity.y) > STILL || fabs(_velocity.z) > STILL;
+	bool turning = fabs(_angularVelocity) > STILL;
+
+	if (_count < 2 || framesAhead == 0 || !(moving || turning))
+		return false;
+
+	position = _positions[_newest] + _velocity * (float)framesAhead;
+	rotationAngle = _angles[_newest] + _angularVelocity * (float)framesAhead;
+
+	return true;
+}
+//////////////////////////////////////////////////////////////////////////////////
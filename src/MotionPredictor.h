@@ -0,0 +1,41 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// extrapolates the camera from its recent frames
+///		- keeps the position and rotation angle of the last HISTORY_FRAMES rendered frames;
+///		  velocity and angular velocity are the mean change per frame over them
+///		- a jump (home, projection switch) starts the history over, it is not motion
+///		- predict() fails while the camera stands still or the history is too short
+///
+class MotionPredictor
+{
+public:
+	MotionPredictor();
+
+	void	addFrame(const glm::vec3& position, float rotationAngle, size_t jumps);
+	void	reset();
+
+	bool	predict(size_t framesAhead, glm::vec3& position, float& rotationAngle);
+
+	/// begin - getters / accessors
+	glm::vec3	getVelocity() { return _velocity; };			// per frame
+	float		getAngularVelocity() { return _angularVelocity; };	// degrees per frame
+	/// end - getters / accessors
+
+protected:
+	static const size_t HISTORY_FRAMES = 8;
+
+	glm::vec3	_positions[HISTORY_FRAMES];
+	float		_angles[HISTORY_FRAMES];
+	size_t		_count;		// frames in the history
+	size_t		_newest;	// index of the last frame added
+	size_t		_jumps;		// of the last frame added
+
+	glm::vec3	_velocity;
+	float		_angularVelocity;
+};
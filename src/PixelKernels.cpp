@@ -0,0 +1,437 @@
+#include "PixelKernels.h"
+
+#include <cstring>
+
+/// x86 with gcc / clang: every path is compiled in, each function for its own target, and the
+/// widest one the cpu has is picked at run time; elsewhere only the paths the compiler flags
+/// enable are compiled in
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PIXEL_KERNELS_RUNTIME_DISPATCH	1
+#define PIXEL_KERNELS_SSE2				1
+#define PIXEL_KERNELS_SSSE3				1
+#define PIXEL_KERNELS_AVX2				1
+#define TARGET_SSE2						__attribute__((target("sse2")))
+#define TARGET_SSSE3					__attribute__((target("ssse3")))
+#define TARGET_AVX2						__attribute__((target("avx2")))
+#include <immintrin.h>
+#else
+#define PIXEL_KERNELS_RUNTIME_DISPATCH	0
+#define TARGET_SSE2
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#if defined(__AVX2__)
+#define PIXEL_KERNELS_SSE2				1
+#define PIXEL_KERNELS_SSSE3				1
+#define PIXEL_KERNELS_AVX2				1
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#define PIXEL_KERNELS_SSE2				1
+#define PIXEL_KERNELS_SSSE3				1
+#define PIXEL_KERNELS_AVX2				0
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define PIXEL_KERNELS_SSE2				1
+#define PIXEL_KERNELS_SSSE3				0
+#define PIXEL_KERNELS_AVX2				0
+#include <emmintrin.h>
+#else
+#define PIXEL_KERNELS_SSE2				0
+#define PIXEL_KERNELS_SSSE3				0
+#define PIXEL_KERNELS_AVX2				0
+#endif
+#endif
+///
+
+//////////////////////////////////////////////////////////////////////////////////
+/// the vector loops stop where a full load or store would run past the buffers and return
+/// where they stopped; the next narrower loop, and the scalar one last, finish the row
+///
+static PixelInstructionSet detectInstructionSet()
+{
+#if PIXEL_KERNELS_RUNTIME_DISPATCH
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return PIXEL_AVX2;
+
+	if (__builtin_cpu_supports("ssse3"))
+		return PIXEL_SSSE3;
+
+	if (__builtin_cpu_supports("sse2"))
+		return PIXEL_SSE2;
+
+	return PIXEL_SCALAR;
+#elif PIXEL_KERNELS_AVX2
+	return PIXEL_AVX2;
+#elif PIXEL_KERNELS_SSSE3
+	return PIXEL_SSSE3;
+#elif PIXEL_KERNELS_SSE2
+	return PIXEL_SSE2;
+#else
+	return PIXEL_SCALAR;
+#endif
+}
+
+static PixelInstructionSet& activeInstructionSet()
+{
+	static PixelInstructionSet active = detectInstructionSet();
+
+	return active;
+}
+
+#if PIXEL_KERNELS_SSSE3
+TARGET_SSSE3 static size_t expandRGBToRGBASSSE3(const unsigned char* rgb, size_t pixelCount, unsigned char* rgba, unsigned char alpha, size_t i)
+{
+	const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alphas = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+
+	for (; i + 6 <= pixelCount; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(rgb + i * 3));
+
+		_mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, spread), alphas));
+	}
+
+	return i;
+}
+
+TARGET_SSSE3 static size_t contractRGBAToRGBSSSE3(const unsigned char* rgba, size_t pixelCount, unsigned char* rgb, size_t i)
+{
+	const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	for (; i + 6 <= pixelCount; i += 4)
+		_mm_storeu_si128((__m128i*)(rgb + i * 3), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(rgba + i * 4)), pack));
+
+	return i;
+}
+
+/// 4 pixels per 16 bytes, the last 4 bytes pass through and are redone by the next step
+///
+TARGET_SSSE3 static size_t swapRedBlueSSSE3(const unsigned char* src, size_t pixelCount, unsigned char* dst, size_t i)
+{
+	const __m128i swap = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+
+	for (; i + 6 <= pixelCount; i += 4)
+		_mm_storeu_si128((__m128i*)(dst + i * 3), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i * 3)), swap));
+
+	return i;
+}
+
+/// 4 pixels from two 12 byte steps, the left and right pixel of each pair gathered to 16 bit
+///
+TARGET_SSSE3 static size_t downsampleRGBRowSSSE3(const unsigned char* src0, const unsigned char* src1, unsigned char* out, size_t width, size_t x)
+{
+	const __m128i two   = _mm_set1_epi16(2);
+	const __m128i left  = _mm_setr_epi8(0, -1, 1, -1, 2, -1, 6, -1, 7, -1, 8, -1, -1, -1, -1, -1);
+	const __m128i right = _mm_setr_epi8(3, -1, 4, -1, 5, -1, 9, -1, 10, -1, 11, -1, -1, -1, -1, -1);
+	const __m128i pack  = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+
+	for (; x + 6 <= width; x += 4)
+	{
+		__m128i pairs[2];
+
+		for (size_t i = 0; i < 2; i++)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(src0 + x * 6 + i * 12));
+			__m128i b = _mm_loadu_si128((const __m128i*)(src1 + x * 6 + i * 12));
+
+			pairs[i] = _mm_add_epi16(_mm_add_epi16(_mm_shuffle_epi8(a, left), _mm_shuffle_epi8(a, right)),
+									 _mm_add_epi16(_mm_shuffle_epi8(b, left), _mm_shuffle_epi8(b, right)));
+			pairs[i] = _mm_srli_epi16(_mm_add_epi16(pairs[i], two), 2);
+		}
+
+		_mm_storeu_si128((__m128i*)(out + x * 3), _mm_shuffle_epi8(_mm_packus_epi16(pairs[0], pairs[1]), pack));
+	}
+
+	return x;
+}
+#endif
+
+#if PIXEL_KERNELS_SSE2
+/// 4 pixels, vertical sums widened to 16 bit, then the two halves of every 64 bits
+///
+TARGET_SSE2 static size_t downsampleRGBARowSSE2(const unsigned char* src0, const unsigned char* src1, unsigned char* out, size_t width, size_t x)
+{
+	const __m128i two  = _mm_set1_epi16(2);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; x + 4 <= width; x += 4)
+	{
+		__m128i pairs[2];
+
+		for (size_t i = 0; i < 2; i++)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(src0 + x * 8 + i * 16));
+			__m128i b = _mm_loadu_si128((const __m128i*)(src1 + x * 8 + i * 16));
+			__m128i low  = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+			pairs[i] = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+			pairs[i] = _mm_srli_epi16(_mm_add_epi16(pairs[i], two), 2);
+		}
+
+		_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(pairs[0], pairs[1]));
+	}
+
+	return x;
+}
+#endif
+
+#if PIXEL_KERNELS_AVX2
+/// 8 pixels, the two lanes load 12 bytes apart
+///
+TARGET_AVX2 static size_t expandRGBToRGBAAVX2(const unsigned char* rgb, size_t pixelCount, unsigned char* rgba, unsigned char alpha, size_t i)
+{
+	const __m256i spread = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+	const __m256i alphas = _mm256_set1_epi32((int)((unsigned int)alpha << 24));
+
+	for (; i + 10 <= pixelCount; i += 8)
+	{
+		__m256i pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(rgb + i * 3))),
+												 _mm_loadu_si128((const __m128i*)(rgb + i * 3 + 12)), 1);
+
+		_mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(pixels, spread), alphas));
+	}
+
+	return i;
+}
+
+/// 8 pixels, the upper lane is stored over the 4 spare bytes of the lower one
+///
+TARGET_AVX2 static size_t contractRGBAToRGBAVX2(const unsigned char* rgba, size_t pixelCount, unsigned char* rgb, size_t i)
+{
+	const __m256i pack = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+
+	for (; i + 10 <= pixelCount; i += 8)
+	{
+		__m256i pixels = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(rgba + i * 4)), pack);
+
+		_mm_storeu_si128((__m128i*)(rgb + i * 3), _mm256_castsi256_si128(pixels));
+		_mm_storeu_si128((__m128i*)(rgb + i * 3 + 12), _mm256_extracti128_si256(pixels, 1));
+	}
+
+	return i;
+}
+
+TARGET_AVX2 static size_t swapRedBlueAVX2(const unsigned char* src, size_t pixelCount, unsigned char* dst, size_t i)
+{
+	const __m256i swap = _mm256_broadcastsi128_si256(_mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15));
+
+	for (; i + 10 <= pixelCount; i += 8)
+	{
+		__m256i pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + i * 3))),
+												 _mm_loadu_si128((const __m128i*)(src + i * 3 + 12)), 1);
+
+		pixels = _mm256_shuffle_epi8(pixels, swap);
+
+		_mm_storeu_si128((__m128i*)(dst + i * 3), _mm256_castsi256_si128(pixels));
+		_mm_storeu_si128((__m128i*)(dst + i * 3 + 12), _mm256_extracti128_si256(pixels, 1));
+	}
+
+	return i;
+}
+
+/// 8 pixels; the in lane pair sums come out as pixels 0 2 4 6 | 1 3 5 7
+///
+TARGET_AVX2 static size_t downsampleRGBARowAVX2(const unsigned char* src0, const unsigned char* src1, unsigned char* out, size_t width, size_t x)
+{
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const __m256i two = _mm256_set1_epi16(2);
+
+	for (; x + 8 <= width; x += 8)
+	{
+		__m256i sums[4];
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			sums[i] = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(src0 + x * 8 + i * 16))),
+									   _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(src1 + x * 8 + i * 16))));
+		}
+
+		__m256i low  = _mm256_add_epi16(_mm256_unpacklo_epi64(sums[0], sums[1]), _mm256_unpackhi_epi64(sums[0], sums[1]));
+		__m256i high = _mm256_add_epi16(_mm256_unpacklo_epi64(sums[2], sums[3]), _mm256_unpackhi_epi64(sums[2], sums[3]));
+
+		low  = _mm256_srli_epi16(_mm256_add_epi16(low, two), 2);
+		high = _mm256_srli_epi16(_mm256_add_epi16(high, two), 2);
+
+		_mm256_storeu_si256((__m256i*)(out + x * 4), _mm256_permutevar8x32_epi32(_mm256_packus_epi16(low, high), order));
+	}
+
+	return x;
+}
+#endif
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+void PixelKernels::copyRect(const unsigned char* src, size_t srcPitch, unsigned char* dst, size_t dstPitch, size_t rowBytes, size_t rows)
+{
+	if (srcPitch == rowBytes && dstPitch == rowBytes)
+	{
+		memcpy(dst, src, rowBytes * rows);
+		return;
+	}
+
+	for (size_t y = 0; y < rows; y++)
+		memcpy(dst + y * dstPitch, src + y * srcPitch, rowBytes);
+}
+
+void PixelKernels::expandRGBToRGBA(const unsigned char* rgb, size_t pixelCount, unsigned char* rgba, unsigned char alpha)
+{
+	PixelInstructionSet	instructionSet = activeInstructionSet();
+	size_t				i = 0;
+
+#if PIXEL_KERNELS_AVX2
+	if (instructionSet >= PIXEL_AVX2)
+		i = expandRGBToRGBAAVX2(rgb, pixelCount, rgba, alpha, i);
+#endif
+
+#if PIXEL_KERNELS_SSSE3
+	if (instructionSet >= PIXEL_SSSE3)
+		i = expandRGBToRGBASSSE3(rgb, pixelCount, rgba, alpha, i);
+#endif
+
+	for (; i < pixelCount; i++)
+	{
+		rgba[i * 4 + 0] = rgb[i * 3 + 0];
+		rgba[i * 4 + 1] = rgb[i * 3 + 1];
+		rgba[i * 4 + 2] = rgb[i * 3 + 2];
+		rgba[i * 4 + 3] = alpha;
+	}
+
+	(void)instructionSet;
+}
+
+void PixelKernels::contractRGBAToRGB(const unsigned char* rgba, size_t pixelCount, unsigned char* rgb)
+{
+	PixelInstructionSet	instructionSet = activeInstructionSet();
+	size_t				i = 0;
+
+#if PIXEL_KERNELS_AVX2
+	if (instructionSet >= PIXEL_AVX2)
+		i = contractRGBAToRGBAVX2(rgba, pixelCount, rgb, i);
+#endif
+
+#if PIXEL_KERNELS_SSSE3
+	if (instructionSet >= PIXEL_SSSE3)
+		i = contractRGBAToRGBSSSE3(rgba, pixelCount, rgb, i);
+#endif
+
+	for (; i < pixelCount; i++)
+	{
+		rgb[i * 3 + 0] = rgba[i * 4 + 0];
+		rgb[i * 3 + 1] = rgba[i * 4 + 1];
+		rgb[i * 3 + 2] = rgba[i * 4 + 2];
+	}
+
+	(void)instructionSet;
+}
+
+void PixelKernels::swapRedBlue(const unsigned char* src, size_t pixelCount, unsigned char* dst)
+{
+	PixelInstructionSet	instructionSet = activeInstructionSet();
+	size_t				i = 0;
+
+#if PIXEL_KERNELS_AVX2
+	if (instructionSet >= PIXEL_AVX2)
+		i = swapRedBlueAVX2(src, pixelCount, dst, i);
+#endif
+
+#if PIXEL_KERNELS_SSSE3
+	if (instructionSet >= PIXEL_SSSE3)
+		i = swapRedBlueSSSE3(src, pixelCount, dst, i);
+#endif
+
+	for (; i < pixelCount; i++)
+	{
+		unsigned char red = src[i * 3 + 0];
+
+		dst[i * 3 + 0] = src[i * 3 + 2];
+		dst[i * 3 + 1] = src[i * 3 + 1];
+		dst[i * 3 + 2] = red;
+	}
+
+	(void)instructionSet;
+}
+
+void PixelKernels::downsample2x2(const unsigned char* src, size_t srcPitch, size_t width, size_t height, size_t bytesPerPixel,
+								 unsigned char* dst, size_t dstPitch)
+{
+	PixelInstructionSet instructionSet = activeInstructionSet();
+
+	for (size_t y = 0; y < height; y++)
+	{
+		const unsigned char*	src0 = src + (2 * y) * srcPitch;
+		const unsigned char*	src1 = src0 + srcPitch;
+		unsigned char*			out  = dst + y * dstPitch;
+		size_t					x = 0;
+
+		if (bytesPerPixel == 4)
+		{
+#if PIXEL_KERNELS_AVX2
+			if (instructionSet >= PIXEL_AVX2)
+				x = downsampleRGBARowAVX2(src0, src1, out, width, x);
+#endif
+
+#if PIXEL_KERNELS_SSE2
+			if (instructionSet >= PIXEL_SSE2)
+				x = downsampleRGBARowSSE2(src0, src1, out, width, x);
+#endif
+		}
+		else if (bytesPerPixel == 3)
+		{
+#if PIXEL_KERNELS_SSSE3
+			if (instructionSet >= PIXEL_SSSE3)
+				x = downsampleRGBRowSSSE3(src0, src1, out, width, x);
+#endif
+		}
+
+		src0 += 2 * x * bytesPerPixel;
+		src1 += 2 * x * bytesPerPixel;
+		out  += x * bytesPerPixel;
+
+		for (; x < width; x++)
+		{
+			for (size_t c = 0; c < bytesPerPixel; c++)
+			{
+				unsigned int sum = src0[c] + src0[bytesPerPixel + c] + src1[c] + src1[bytesPerPixel + c];
+
+				out[c] = (unsigned char)((sum + 2) / 4);
+			}
+
+			src0 += 2 * bytesPerPixel;
+			src1 += 2 * bytesPerPixel;
+			out  += bytesPerPixel;
+		}
+	}
+
+	(void)instructionSet;
+}
+
+const char* PixelKernels::getInstructionSet()
+{
+	return getInstructionSetName(activeInstructionSet());
+}
+
+const char* PixelKernels::getInstructionSetName(PixelInstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+		case PIXEL_AVX2:	return "avx2";
+		case PIXEL_SSSE3:	return "ssse3";
+		case PIXEL_SSE2:	return "sse2";
+		default:			return "scalar";
+	}
+}
+
+PixelInstructionSet PixelKernels::getSupportedInstructionSet()
+{
+	return detectInstructionSet();
+}
+
+void PixelKernels::limitInstructionSet(PixelInstructionSet instructionSet)
+{
+	PixelInstructionSet supported = detectInstructionSet();
+
+	activeInstructionSet() = instructionSet < supported ? instructionSet : supported;
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+enum PixelInstructionSet
+{
+	PIXEL_SCALAR,
+	PIXEL_SSE2,
+	PIXEL_SSSE3,
+	PIXEL_AVX2
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// the per pixel loops of the imagery pipeline, vectorized
+///		- avx2 / ssse3 (sse2 where that is enough), a scalar loop otherwise and for the tail of
+///		  every row; all paths give bit identical results
+///		- gcc / clang on x86 compile every path and pick the widest the cpu runs once, at the
+///		  first call; other compilers get what their flags enable
+///		- pixels are 8 bit per channel; pitches are in bytes
+///		- the strided copy stays on memcpy, which the c runtime already dispatches to the widest
+///		  vector unit of the machine
+///
+class PixelKernels
+{
+public:
+	/// rows x rowBytes sub rectangle, src and dst may not overlap
+	static void	copyRect(const unsigned char* src, size_t srcPitch, unsigned char* dst, size_t dstPitch, size_t rowBytes, size_t rows);
+
+	/// pixelCount pixels, tightly packed
+	static void	expandRGBToRGBA(const unsigned char* rgb, size_t pixelCount, unsigned char* rgba, unsigned char alpha = 255);
+	static void	contractRGBAToRGB(const unsigned char* rgba, size_t pixelCount, unsigned char* rgb);
+
+	/// bgr <-> rgb of 3 byte pixels, src may be dst
+	static void	swapRedBlue(const unsigned char* src, size_t pixelCount, unsigned char* dst);
+
+	/// width x height pixels, each the rounded average of a 2x2 block of src (2 width x 2 height)
+	static void	downsample2x2(const unsigned char* src, size_t srcPitch, size_t width, size_t height, size_t bytesPerPixel,
+							  unsigned char* dst, size_t dstPitch);
+
+	/// the path in use, "avx2", "ssse3", "sse2" or "scalar"
+	static const char*	getInstructionSet();
+	static const char*	getInstructionSetName(PixelInstructionSet instructionSet);
+
+	/// the widest path this cpu and build can run
+	static PixelInstructionSet	getSupportedInstructionSet();
+
+	/// no path wider than instructionSet from now on, for checking the narrower paths against
+	/// each other; not thread safe, call it before the kernels are in use
+	static void	limitInstructionSet(PixelInstructionSet instructionSet);
+};
@@ -0,0 +1,109 @@
+#include "QualityController.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+/// the ladder, cheapest changes first: the hud and anisotropy cost little to give up, the
+/// lod and the far plane are what actually shed tiles
+///
+static const QualityLevel QUALITY_LEVELS[] =
+{
+	//	name		lod		aniso	far		hud s
+	{ "full",		1.0f,	16.0f,	1.0f,	0.0  },
+	{ "high",		1.0f,	4.0f,	1.0f,	0.1  },
+	{ "medium",		1.5f,	2.0f,	0.8f,	0.2  },
+	{ "low",		2.0f,	1.0f,	0.6f,	0.25 },
+	{ "minimal",	3.0f,	1.0f,	0.4f,	0.5  },
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+QualityController::QualityController()
+{
+	_targetFrameMs = 0.0;
+	_margin = 0.15;
+	_levelChanges = 0;
+
+	reset();
+}
+
+void QualityController::initialize(double targetFrameMs, double margin)
+{
+	_targetFrameMs = targetFrameMs > 0.0 ? targetFrameMs : 0.0;
+	_margin = margin;
+
+	reset();
+}
+
+void QualityController::reset()
+{
+	_averageFrameMs = 0.0;
+	_frames = 0;
+	_slowFrames = 0;
+	_fastFrames = 0;
+	_cooldown = 0;
+	_level = 0;
+}
+
+size_t QualityController::getLevelCount()
+{
+	return sizeof(QUALITY_LEVELS) / sizeof(QUALITY_LEVELS[0]);
+}
+
+const QualityLevel& QualityController::getLevel(size_t level)
+{
+	return QUALITY_LEVELS[level < getLevelCount() ? level : getLevelCount() - 1];
+}
+
+bool QualityController::addFrame(double frameMs)
+{
+	static const double SMOOTHING = 0.1; // weight of the newest frame
+
+	if (!isEnabled())
+		return false;
+
+	_averageFrameMs = _frames == 0 ? frameMs : _averageFrameMs + SMOOTHING * (frameMs - _averageFrameMs);
+	_frames++;
+
+	if (_cooldown > 0)
+	{
+		_cooldown--;
+		return false;
+	}
+
+	/// count the frames in a row on either side of the dead band, inside it both start over
+	if (_averageFrameMs > _targetFrameMs * (1.0 + _margin))
+	{
+		_slowFrames++;
+		_fastFrames = 0;
+	}
+	else if (_averageFrameMs < _targetFrameMs * (1.0 - _margin))
+	{
+		_fastFrames++;
+		_slowFrames = 0;
+	}
+	else
+		_slowFrames = _fastFrames = 0;
+	///
+
+	if (_slowFrames >= DOWN_FRAMES && _level + 1 < getLevelCount())
+	{
+		setLevel(_level + 1);
+		return true;
+	}
+
+	if (_fastFrames >= UP_FRAMES && _level > 0)
+	{
+		setLevel(_level - 1);
+		return true;
+	}
+
+	return false;
+}
+
+void QualityController::setLevel(size_t level)
+{
+	_level = level;
+	_levelChanges++;
+
+	_slowFrames = _fastFrames = 0;
+	_cooldown = COOLDOWN_FRAMES;
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// what one quality level renders with
+///
+struct QualityLevel
+{
+	const char*	name;
+	float		lodErrorScale;		// times RenderSettings::lodErrorThreshold, coarser tiles above 1
+	float		maxAnisotropy;		// of the tile textures, 1 is plain bilinear
+	float		farScale;			// times Configuration::getFar(), perspective only
+	double		hudIntervalSeconds;	// shortest time between two overview map re-renders, 0 is every frame
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// holds a frame time target by stepping through a fixed ladder of quality levels
+///		- addFrame() takes the measured time of every rendered frame; the controller keeps an
+///		  exponential average of it
+///		- hysteresis: one level down when the average stays above target * (1 + margin) for
+///		  DOWN_FRAMES frames in a row, one level up only when it stays below target * (1 - margin)
+///		  for the longer UP_FRAMES; every change is followed by COOLDOWN_FRAMES frames in which
+///		  the average settles and nothing changes
+///		- level 0 is full quality; the controller never goes past the ladder in either direction
+///		- disabled, it stays at level 0 and ignores the frames
+///
+class QualityController
+{
+public:
+	QualityController();
+
+	/// targetFrameMs 0 disables it
+	void	initialize(double targetFrameMs, double margin = 0.15);
+	void	reset();	// full quality, history dropped, e.g. on a new scene
+
+	/// true when the level changed with this frame
+	bool	addFrame(double frameMs);
+
+	static size_t				getLevelCount();
+	static const QualityLevel&	getLevel(size_t level);
+
+	/// begin - getters / accessors
+	bool				isEnabled() { return _targetFrameMs > 0.0; };
+	size_t				getLevelIndex() { return _level; };
+	const QualityLevel&	getLevel() { return getLevel(_level); };
+	const char*			getLevelName() { return getLevel(_level).name; };
+	double				getTargetFrameMs() { return _targetFrameMs; };
+	double				getAverageFrameMs() { return _averageFrameMs; };
+	size_t				getLevelChanges() { return _levelChanges; };
+	/// end - getters / accessors
+
+protected:
+	static const size_t DOWN_FRAMES = 10;
+	static const size_t UP_FRAMES = 60;
+	static const size_t COOLDOWN_FRAMES = 30;
+
+	double	_targetFrameMs;
+	double	_margin;
+
+	double	_averageFrameMs;
+	size_t	_frames;		// since the last reset, the average needs a few before it means anything
+	size_t	_slowFrames;	// consecutive frames over the upper bound
+	size_t	_fastFrames;	// consecutive frames under the lower bound
+	size_t	_cooldown;		// frames left before the next change
+	size_t	_level;
+	size_t	_levelChanges;
+
+	void	setLevel(size_t level);
+};
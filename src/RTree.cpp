@@ -0,0 +1,156 @@
+#include "RTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+//////////////////////////////////////////////////////////////////////////////////
+void RTreeRect::expand(const RTreeRect& other)
+{
+	minX = std::min(minX, other.minX);
+	minY = std::min(minY, other.minY);
+	maxX = std::max(maxX, other.maxX);
+	maxY = std::max(maxY, other.maxY);
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+RTree::RTree()
+{
+	_root = 0;
+}
+
+void RTree::release()
+{
+	_rects.clear();
+	_items.clear();
+	_nodes.clear();
+	_root = 0;
+}
+
+/// sort tile recursive order: consecutive runs of MAX_ENTRIES in order are the packed nodes
+///
+void RTree::packOrder(const vector<RTreeRect>& rects, vector<size_t>& order)
+{
+	size_t count = rects.size();
+
+	order.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+		order[i] = i;
+
+	size_t nodes = (count + MAX_ENTRIES - 1) / MAX_ENTRIES;
+	size_t slices = (size_t)ceil(sqrt((double)nodes));
+	size_t sliceSize = slices * MAX_ENTRIES;
+
+	auto centerX = [&rects](size_t a, size_t b) { return rects[a].minX + rects[a].maxX < rects[b].minX + rects[b].maxX; };
+	auto centerY = [&rects](size_t a, size_t b) { return rects[a].minY + rects[a].maxY < rects[b].minY + rects[b].maxY; };
+
+	sort(order.begin(), order.end(), centerX);
+
+	for (size_t first = 0; first < count; first += sliceSize)
+		sort(order.begin() + first, order.begin() + std::min(first + sliceSize, count), centerY);
+}
+
+void RTree::build(const vector<RTreeRect>& rects)
+{
+	release();
+
+	if (rects.empty())
+		return;
+
+	_rects = rects;
+
+	/// leaves over the items
+	vector<Node> level;
+
+	packOrder(_rects, _items);
+
+	for (size_t first = 0; first < _items.size(); first += MAX_ENTRIES)
+	{
+		Node leaf;
+
+		leaf.first = first;
+		leaf.count = std::min((size_t)MAX_ENTRIES, _items.size() - first);
+		leaf.leaf = true;
+		leaf.bounds = _rects[_items[first]];
+
+		for (size_t i = 1; i < leaf.count; i++)
+			leaf.bounds.expand(_rects[_items[first + i]]);
+
+		level.push_back(leaf);
+	}
+	///
+
+	/// every level is packed in order, stored, and its runs become the parents
+	while (true)
+	{
+		vector<RTreeRect>	bounds(level.size());
+		vector<size_t>		order;
+
+		for (size_t i = 0; i < level.size(); i++)
+			bounds[i] = level[i].bounds;
+
+		packOrder(bounds, order);
+
+		size_t base = _nodes.size();
+
+		for (size_t i : order)
+			_nodes.push_back(level[i]);
+
+		if (level.size() == 1)
+			break;
+
+		vector<Node> parents;
+
+		for (size_t first = 0; first < order.size(); first += MAX_ENTRIES)
+		{
+			Node parent;
+
+			parent.first = base + first;
+			parent.count = std::min((size_t)MAX_ENTRIES, order.size() - first);
+			parent.leaf = false;
+			parent.bounds = _nodes[parent.first].bounds;
+
+			for (size_t i = 1; i < parent.count; i++)
+				parent.bounds.expand(_nodes[parent.first + i].bounds);
+
+			parents.push_back(parent);
+		}
+
+		level.swap(parents);
+	}
+	///
+
+	_root = _nodes.size() - 1;
+}
+
+void RTree::query(const RTreeRect& rect, vector<size_t>& items) const
+{
+	if (_nodes.empty())
+		return;
+
+	size_t	stack[16 * MAX_ENTRIES]; // at most MAX_ENTRIES - 1 siblings wait per level, 16 levels hold any size_t item count
+	size_t	depth = 0;
+
+	stack[depth++] = _root;
+
+	while (depth > 0)
+	{
+		const Node& node = _nodes[stack[--depth]];
+
+		if (!node.bounds.intersects(rect))
+			continue;
+
+		for (size_t i = node.first; i < node.first + node.count; i++)
+		{
+			if (node.leaf)
+			{
+				if (_rects[_items[i]].intersects(rect))
+					items.push_back(_items[i]);
+			}
+			else
+				stack[depth++] = i;
+		}
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// axis aligned rectangle, min inclusive, max exclusive
+///
+struct RTreeRect
+{
+	double	minX, minY;
+	double	maxX, maxY;
+
+	RTreeRect() : minX(0.0), minY(0.0), maxX(0.0), maxY(0.0) {};
+	RTreeRect(double x0, double y0, double x1, double y1) : minX(x0), minY(y0), maxX(x1), maxY(y1) {};
+
+	bool	intersects(const RTreeRect& other) const
+	{
+		return minX < other.maxX && other.minX < maxX && minY < other.maxY && other.minY < maxY;
+	};
+
+	void	expand(const RTreeRect& other);
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// static r-tree over rectangles, bulk loaded once
+///		- sort tile recursive packing: the rectangles are sorted by center x into vertical
+///		  slices, every slice by center y, and runs of MAX_ENTRIES become the leaves; the levels
+///		  above are packed the same way until one node is left
+///		- the children of a node are consecutive, so a node is its bounds and a range
+///		- query() may be called from several threads at once, build() may not
+///
+class RTree
+{
+public:
+	RTree();
+
+	/// the item of a rectangle is its index in rects
+	void	build(const vector<RTreeRect>& rects);
+	void	release();
+
+	/// the items whose rectangle intersects rect, in no particular order; appended to items
+	void	query(const RTreeRect& rect, vector<size_t>& items) const;
+
+	/// begin - getters / accessors
+	size_t		getItemCount() const { return _items.size(); };
+	size_t		getNodeCount() const { return _nodes.size(); };
+	RTreeRect	getBounds() const { return _nodes.empty() ? RTreeRect() : _nodes[_root].bounds; };
+	/// end - getters / accessors
+
+	static const size_t MAX_ENTRIES = 16;
+
+protected:
+	struct Node
+	{
+		RTreeRect	bounds;
+		size_t		first;	// leaf: into _items, else into _nodes
+		size_t		count;
+		bool		leaf;
+	};
+
+	vector<RTreeRect>	_rects;	// by item
+	vector<size_t>		_items;	// leaf entries, in packing order
+	vector<Node>		_nodes;	// level by level, leaves first, the root last
+	size_t				_root;
+
+	static void	packOrder(const vector<RTreeRect>& rects, vector<size_t>& order);
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "BlockCompressor.h"
+
+#include <sstream>
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// renderer tuning knobs
+///		- kept next to Configuration (which describes the scene and the camera), these only
+///		  trade quality against speed and memory
+///		- set() takes one "name=value" (the member name, e.g. uploadBytesPerFrame=4194304 or
+///		  tileCompression=bc7), the tools pass their command line ones through it
+///
+struct RenderSettings
+{
+	float	lodErrorThreshold;	// max size of a texel on screen, in pixels, before a tile is refined
+	size_t	maxTilesPerFrame;	// hard cap on the tiles drawn in one frame, the lod coarsens to hold it
+
+	size_t	uploadBytesPerFrame;	// tile texture bytes streamed to the gpu per frame (at least one tile)
+	size_t	maxQueuedTileUploads;	// tiles built ahead of the uploads before the scene build waits
+
+	size_t	tileTextureBudgetBytes;	// gpu memory for tile textures, least recently used tiles go beyond it
+	size_t	pinnedTileLevels;		// coarsest pyramid levels that always stay resident, the fallback
+	size_t	maxTileLoadsInFlight;	// tile reloads queued at a time, capped by maxQueuedTileUploads
+	size_t	prefetchFramesAhead;	// how far ahead the moving camera is extrapolated for prefetching, 0 is off
+	size_t	maxPrefetchInFlight;	// prefetch loads queued at a time, within maxTileLoadsInFlight
+
+	bool	virtualTexturing;	// one map quad through a page table instead of a quad per tile, fixed gpu memory
+	size_t	vtPhysicalPages;	// tile layers in the physical page cache, the whole texture memory then
+	size_t	vtFeedbackScale;	// the feedback pass renders at 1 / vtFeedbackScale of the viewport
+
+	TileCompression	tileCompression;	// gpu format of the tile textures, rgb8 if the driver lacks it
+	int		tileCompressionQuality;		// 0 fastest .. 2 best, see BlockCompressor
+
+	size_t	overviewSourceSize;	// texels across the overview map source, the root tile is filtered down to it
+
+	double	crossfadeSeconds;	// swapScene(): the last image fades out over this, once the new one has its root tile
+
+	double	idleWaitSeconds;	// longest sleep of an idle render loop, input and tile arrivals wake it earlier
+
+	double	targetFrameMs;		// frame time the QualityController holds by lowering the quality, 0 is off
+	double	qualityHysteresis;	// dead band around it, a fraction of targetFrameMs
+
+	size_t	exportTileSize;			// exportView() renders squares of this, the output is buffered one row of them high
+	size_t	exportScale;			// 'X' exports at the window size times this
+	double	exportSettleSeconds;	// longest wait of a square for its tiles
+
+	float	cameraMoveStepsPerSecond;	// key press increments per second while a move key is held
+	float	cameraTurnStepsPerSecond;	// rotation increments per second while a rotate key is held
+	double	cameraTickSeconds;			// camera thread update period while keys are held
+
+	RenderSettings()
+	{
+		lodErrorThreshold = 1.0f;
+		maxTilesPerFrame = 1024;
+
+		uploadBytesPerFrame = 8 * 1024 * 1024;
+		maxQueuedTileUploads = 64;
+
+		tileTextureBudgetBytes = 512 * 1024 * 1024;
+		pinnedTileLevels = 3;
+		maxTileLoadsInFlight = 32;
+		prefetchFramesAhead = 20;
+		maxPrefetchInFlight = 8;
+
+		virtualTexturing = false;
+		vtPhysicalPages = 256;
+		vtFeedbackScale = 8;
+
+		tileCompression = TILE_COMPRESSION_BC1;
+		tileCompressionQuality = 1;
+
+		overviewSourceSize = 256;
+
+		crossfadeSeconds = 0.75;
+
+		idleWaitSeconds = 0.5;
+
+		targetFrameMs = 1000.0 / 30.0;
+		qualityHysteresis = 0.15;
+
+		exportTileSize = 1024;
+		exportScale = 4;
+		exportSettleSeconds = 10.0;
+
+		cameraMoveStepsPerSecond = 20.0f;
+		cameraTurnStepsPerSecond = 9.0f;
+		cameraTickSeconds = 1.0 / 240.0;
+	};
+
+	/// false, and nothing changed, if the name is not one of the members or the value does not parse
+	bool set(const string& assignment)
+	{
+		size_t equals = assignment.find('=');
+
+		if (equals == string::npos)
+			return false;
+
+		string name = assignment.substr(0, equals);
+		string value = assignment.substr(equals + 1);
+
+		if (name == "tileCompression")
+		{
+			for (TileCompression compression : { TILE_COMPRESSION_NONE, TILE_COMPRESSION_BC1, TILE_COMPRESSION_BC7 })
+			{
+				if (value == BlockCompressor::getName(compression))
+				{
+					tileCompression = compression;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		if (name == "lodErrorThreshold")		return parse(value, lodErrorThreshold);
+		if (name == "maxTilesPerFrame")			return parse(value, maxTilesPerFrame);
+		if (name == "uploadBytesPerFrame")		return parse(value, uploadBytesPerFrame);
+		if (name == "maxQueuedTileUploads")		return parse(value, maxQueuedTileUploads);
+		if (name == "tileTextureBudgetBytes")	return parse(value, tileTextureBudgetBytes);
+		if (name == "pinnedTileLevels")			return parse(value, pinnedTileLevels);
+		if (name == "maxTileLoadsInFlight")		return parse(value, maxTileLoadsInFlight);
+		if (name == "prefetchFramesAhead")		return parse(value, prefetchFramesAhead);
+		if (name == "maxPrefetchInFlight")		return parse(value, maxPrefetchInFlight);
+		if (name == "virtualTexturing")			return parse(value, virtualTexturing);
+		if (name == "vtPhysicalPages")			return parse(value, vtPhysicalPages);
+		if (name == "vtFeedbackScale")			return parse(value, vtFeedbackScale);
+		if (name == "tileCompressionQuality")	return parse(value, tileCompressionQuality);
+		if (name == "overviewSourceSize")		return parse(value, overviewSourceSize);
+		if (name == "crossfadeSeconds")			return parse(value, crossfadeSeconds);
+		if (name == "idleWaitSeconds")			return parse(value, idleWaitSeconds);
+		if (name == "targetFrameMs")			return parse(value, targetFrameMs);
+		if (name == "qualityHysteresis")		return parse(value, qualityHysteresis);
+		if (name == "exportTileSize")			return parse(value, exportTileSize);
+		if (name == "exportScale")				return parse(value, exportScale);
+		if (name == "exportSettleSeconds")		return parse(value, exportSettleSeconds);
+		if (name == "cameraMoveStepsPerSecond")	return parse(value, cameraMoveStepsPerSecond);
+		if (name == "cameraTurnStepsPerSecond")	return parse(value, cameraTurnStepsPerSecond);
+		if (name == "cameraTickSeconds")		return parse(value, cameraTickSeconds);
+
+		return false;
+	};
+
+protected:
+	/// the whole value, nothing left over; bools are 0 / 1
+	template <class T>
+	static bool parse(const string& value, T& member)
+	{
+		istringstream	in(value);
+		T				parsed;
+
+		if (!(in >> parsed) || !(in >> ws).eof())
+			return false;
+
+		member = parsed;
+
+		return true;
+	};
+};
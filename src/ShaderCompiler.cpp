@@ -0,0 +1,79 @@
+#include "ShaderCompiler.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+GLuint ShaderCompiler::compileShader(GLenum type, const char* source)
+{
+	return compileShader(type, &source, 1);
+}
+
+GLuint ShaderCompiler::compileShader(GLenum type, const char* const* sources, size_t sourceCount)
+{
+	GLuint shader = glCreateShader(type);
+
+	glShaderSource(shader, (GLsizei)sourceCount, sources, NULL);
+	glCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+	if (status != GL_TRUE)
+	{
+		GLchar log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+
+		cout << __FUNCTION__ << "Error, shader compile failed: " << log << endl;
+
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+GLuint ShaderCompiler::linkProgram(GLuint vertexShader, GLuint fragmentShader)
+{
+	GLuint program = glCreateProgram();
+
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+	if (status != GL_TRUE)
+	{
+		GLchar log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+
+		cout << __FUNCTION__ << "Error, shader link failed: " << log << endl;
+
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+GLuint ShaderCompiler::buildProgram(const char* vertexSource, const char* fragmentSource, const char* defines)
+{
+	const char*	vertexSources[] = { defines, vertexSource };
+	const char*	fragmentSources[] = { defines, fragmentSource };
+	size_t		first = defines ? 0 : 1;
+	GLuint		program = 0;
+
+	GLuint vertexShader   = compileShader(GL_VERTEX_SHADER,   vertexSources + first,   2 - first);
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSources + first, 2 - first);
+
+	if (vertexShader != 0 && fragmentShader != 0)
+		program = linkProgram(vertexShader, fragmentShader);
+
+	if (vertexShader != 0)
+		glDeleteShader(vertexShader);
+
+	if (fragmentShader != 0)
+		glDeleteShader(fragmentShader);
+
+	return program;
+}
+//////////////////////////////////////////////////////////////////////////////////
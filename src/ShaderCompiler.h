@@ -0,0 +1,24 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// the compile and link steps of the tile shaders
+///		- 0 on failure, the info log goes to cout
+///		- sources are concatenated in order, #version has to be in the first one
+///
+class ShaderCompiler
+{
+public:
+	static GLuint	compileShader(GLenum type, const char* source);
+	static GLuint	compileShader(GLenum type, const char* const* sources, size_t sourceCount);
+
+	/// the shaders can be deleted once this returned
+	static GLuint	linkProgram(GLuint vertexShader, GLuint fragmentShader);
+
+	/// compile both, link, delete the shaders; defines (may be NULL) goes before each source
+	static GLuint	buildProgram(const char* vertexSource, const char* fragmentSource, const char* defines = NULL);
+};
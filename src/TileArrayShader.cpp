@@ -0,0 +1,93 @@
+#include "TileArrayShader.h"
+#include "ShaderCompiler.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////
+static const char* __vertexShaderSource = R"(
+#version 330 core
+
+layout(location = 0) in vec3  position;
+layout(location = 1) in vec2  texCoord;
+layout(location = 2) in float layer;
+
+uniform mat4 projection;
+uniform mat4 modelView;
+
+out vec3 arrayTexCoord;
+
+void main()
+{
+	arrayTexCoord = vec3(texCoord, layer);
+	gl_Position = projection * modelView * vec4(position, 1.0);
+}
+)";
+
+static const char* __fragmentShaderSource = R"(
+#version 330 core
+
+in vec3 arrayTexCoord;
+
+uniform sampler2DArray	tileTexture;
+uniform bool			boundaryMode;
+
+out vec4 fragColor;
+
+void main()
+{
+	if (boundaryMode)
+		fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+	else
+		fragColor = vec4(texture(tileTexture, arrayTexCoord).rgb, 1.0);
+}
+)";
+//////////////////////////////////////////////////////////////////////////////////
+
+TileArrayShader::TileArrayShader()
+{
+	_program = ShaderCompiler::buildProgram(__vertexShaderSource, __fragmentShaderSource);
+
+	_projectionLocation   = _program ? glGetUniformLocation(_program, "projection")   : -1;
+	_modelViewLocation    = _program ? glGetUniformLocation(_program, "modelView")    : -1;
+	_tileTextureLocation  = _program ? glGetUniformLocation(_program, "tileTexture")  : -1;
+	_boundaryModeLocation = _program ? glGetUniformLocation(_program, "boundaryMode") : -1;
+
+	logGLError(__FUNCTION__);
+}
+
+TileArrayShader::~TileArrayShader()
+{
+	if (_program)
+		glDeleteProgram(_program);
+
+	_program = 0;
+}
+
+void TileArrayShader::enable()
+{
+	glUseProgram(_program);
+
+	glUniform1i(_tileTextureLocation, 0); // texture unit 0
+	glUniform1i(_boundaryModeLocation, 0);
+}
+
+void TileArrayShader::disable()
+{
+	glUseProgram(0);
+}
+
+void TileArrayShader::setProjectionMatrix(const glm::mat4& projection)
+{
+	glUniformMatrix4fv(_projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+}
+
+void TileArrayShader::setModelViewMatrix(const glm::mat4& modelView)
+{
+	glUniformMatrix4fv(_modelViewLocation, 1, GL_FALSE, glm::value_ptr(modelView));
+}
+
+void TileArrayShader::setBoundaryMode(bool boundaryMode)
+{
+	glUniform1i(_boundaryModeLocation, boundaryMode ? 1 : 0);
+}
+//////////////////////////////////////////////////////////////////////////////////
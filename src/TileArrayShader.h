@@ -0,0 +1,38 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// tile shader for the texture array store
+///		- same projection / model view uniforms as BasicShader
+///		- vertex layout: location 0 position (vec3), location 1 tex coord (vec2),
+///		  location 2 texture array layer (float, one per instance)
+///		- samples the page bound to texture unit 0 as a sampler2DArray
+///		- boundary mode draws flat black, used for the tile boundary lines
+///
+class TileArrayShader
+{
+public:
+	TileArrayShader();
+	~TileArrayShader();
+
+	void	enable();
+	void	disable();
+
+	void	setProjectionMatrix(const glm::mat4& projection);
+	void	setModelViewMatrix(const glm::mat4& modelView);
+	void	setBoundaryMode(bool boundaryMode);
+
+	bool	isValid() { return _program != 0; };
+
+protected:
+	GLuint	_program;
+
+	GLint	_projectionLocation;
+	GLint	_modelViewLocation;
+	GLint	_tileTextureLocation;
+	GLint	_boundaryModeLocation;
+};
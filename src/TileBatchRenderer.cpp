@@ -0,0 +1,328 @@
+#include "TileBatchRenderer.h"
+#include "MemoryTracker.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+static const GLsizei	__verticesPerTile = 4;
+static const GLsizei	__floatsPerVertex = 5;
+
+static const GLuint		__quadIndices[] = { 0, 1, 2, 0, 2, 3,				// triangles
+											0, 1, 1, 2, 2, 3, 3, 0 };		// boundary lines
+static const GLuint		__triangleFirstIndex = 0;
+static const GLuint		__triangleIndexCount = 6;
+static const GLuint		__lineFirstIndex = 6;
+static const GLuint		__lineIndexCount = 8;
+
+/// the bytes of a (re)specified or, with 0, deleted buffer for the memory accounting
+static void trackBuffer(GLuint buffer, size_t bytes)
+{
+	MemoryTracker& tracker = MemoryTracker::getInstance();
+
+	tracker.releaseOwner(MEMORY_TILE_GEOMETRY, MemoryTracker::getGLOwner(GL_BUFFER, buffer));
+
+	if (bytes > 0)
+		tracker.allocate(MEMORY_TILE_GEOMETRY, MemoryTracker::getGLOwner(GL_BUFFER, buffer), bytes);
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+TileBatchRenderer::TileBatchRenderer()
+{
+	_vao = 0;
+	_vertexBuffer = 0;
+	_layerBuffer = 0;
+	_indexBuffer = 0;
+	_indirectBuffer = 0;
+
+	_multiDrawIndirect = false;
+	_baseInstance = false;
+	_drawCallCount = 0;
+}
+
+TileBatchRenderer::~TileBatchRenderer()
+{
+	release();
+}
+
+void TileBatchRenderer::release()
+{
+	for (GLuint buffer : { _indirectBuffer, _indexBuffer, _layerBuffer, _vertexBuffer })
+	{
+		if (buffer)
+			trackBuffer(buffer, 0);
+	}
+
+	if (_indirectBuffer)
+		glDeleteBuffers(1, &_indirectBuffer);
+
+	if (_indexBuffer)
+		glDeleteBuffers(1, &_indexBuffer);
+
+	if (_layerBuffer)
+		glDeleteBuffers(1, &_layerBuffer);
+
+	if (_vertexBuffer)
+		glDeleteBuffers(1, &_vertexBuffer);
+
+	if (_vao)
+		glDeleteVertexArrays(1, &_vao);
+
+	_vao = 0;
+	_vertexBuffer = 0;
+	_layerBuffer = 0;
+	_indexBuffer = 0;
+	_indirectBuffer = 0;
+
+	reset();
+}
+
+void TileBatchRenderer::reset()
+{
+	_vertices.clear();
+	_tileSlots.clear();
+	_commands.clear();
+	_pageOffsets.clear();
+}
+
+size_t TileBatchRenderer::addTile(const glm::vec3& ll, const glm::vec3& ur, const TileTextureSlot& slot, const glm::vec2& texCoordScale)
+{
+	float s = texCoordScale.x;
+	float t = texCoordScale.y;
+
+	/// corners ll, lr, ur, ul; t runs along x, s along y
+	GLfloat quad[__verticesPerTile * __floatsPerVertex] =
+	{
+		ll.x, ll.y, ll.z,	0.0f, 0.0f,
+		ur.x, ll.y, ll.z,	0.0f, t,
+		ur.x, ur.y, ur.z,	s,    t,
+		ll.x, ur.y, ur.z,	s,    0.0f,
+	};
+	///
+
+	_vertices.insert(_vertices.end(), quad, quad + __verticesPerTile * __floatsPerVertex);
+	_tileSlots.push_back(slot);
+
+	return _tileSlots.size() - 1;
+}
+
+void TileBatchRenderer::build()
+{
+	_multiDrawIndirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+	_baseInstance = _multiDrawIndirect || GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+
+	/// the vao and buffers of an earlier build() are respecified, not recreated
+	bool reused = _vao != 0;
+
+	if (!reused)
+		glGenVertexArrays(1, &_vao);
+
+	glBindVertexArray(_vao);
+	///
+
+	/// per vertex data
+	if (_vertexBuffer == 0)
+		glGenBuffers(1, &_vertexBuffer);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(GLfloat), _vertices.data(), GL_STATIC_DRAW);
+	trackBuffer(_vertexBuffer, _vertices.size() * sizeof(GLfloat));
+
+	glEnableVertexAttribArray(0); // position
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, __floatsPerVertex * sizeof(GLfloat), (void*)0);
+
+	glEnableVertexAttribArray(1); // tex coord
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, __floatsPerVertex * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+	///
+
+	/// per tile (instance) data, indexed by the base instance of the draw
+	vector<GLfloat> layers(_tileSlots.size());
+
+	for (size_t tile = 0; tile < _tileSlots.size(); tile++)
+		layers[tile] = (GLfloat)_tileSlots[tile].layer;
+
+	if (_layerBuffer == 0)
+		glGenBuffers(1, &_layerBuffer);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _layerBuffer);
+	glBufferData(GL_ARRAY_BUFFER, layers.size() * sizeof(GLfloat), layers.data(), GL_DYNAMIC_DRAW);
+	trackBuffer(_layerBuffer, layers.size() * sizeof(GLfloat));
+
+	glEnableVertexAttribArray(2); // layer
+	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat), (void*)0);
+	glVertexAttribDivisor(2, 1);
+	///
+
+	if (_indexBuffer == 0)
+	{
+		glGenBuffers(1, &_indexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer); // captured by the vao
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(__quadIndices), __quadIndices, GL_STATIC_DRAW);
+		trackBuffer(_indexBuffer, sizeof(__quadIndices));
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (_multiDrawIndirect)
+	{
+		if (_indirectBuffer == 0)
+			glGenBuffers(1, &_indirectBuffer);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, _tileSlots.size() * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		trackBuffer(_indirectBuffer, _tileSlots.size() * sizeof(DrawElementsIndirectCommand));
+	}
+
+	_commands.resize(_tileSlots.size());
+
+	cout << __FUNCTION__ << " batched " << _tileSlots.size() << " tiles, multi draw indirect: " 
+		 << (_multiDrawIndirect ? "yes" : "no") << (reused ? ", buffers reused" : "") << endl;
+
+	logGLError(__FUNCTION__);
+}
+
+void TileBatchRenderer::setTileSlot(size_t tile, const TileTextureSlot& slot)
+{
+	if (tile >= _tileSlots.size())
+		return;
+
+	_tileSlots[tile] = slot;
+
+	if (_layerBuffer)
+	{
+		GLfloat layer = (GLfloat)slot.layer;
+
+		glBindBuffer(GL_ARRAY_BUFFER, _layerBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, tile * sizeof(GLfloat), sizeof(GLfloat), &layer);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+void TileBatchRenderer::drawCommand(const DrawElementsIndirectCommand& command, GLenum mode)
+{
+	if (_baseInstance)
+	{
+		glDrawElementsInstancedBaseVertexBaseInstance(mode, (GLsizei)command.count, GL_UNSIGNED_INT, 
+			(void*)(command.firstIndex * sizeof(GLuint)), 1, (GLint)command.baseVertex, command.baseInstance);
+	}
+	else
+	{
+		/// no base instance, feed the layer as a constant attribute instead
+		glDisableVertexAttribArray(2);
+		glVertexAttrib1f(2, (GLfloat)_tileSlots[command.baseInstance].layer);
+
+		glDrawElementsBaseVertex(mode, (GLsizei)command.count, GL_UNSIGNED_INT, 
+			(void*)(command.firstIndex * sizeof(GLuint)), (GLint)command.baseVertex);
+
+		glEnableVertexAttribArray(2);
+		///
+	}
+}
+
+void TileBatchRenderer::render(const vector<size_t>& visibleTiles, TileTextureStore& textureStore)
+{
+	_drawCallCount = 0;
+
+	if (visibleTiles.empty() || _vao == 0)
+		return;
+
+	/// one command per visible tile, bucketed by texture array page (counting sort)
+	size_t pageCount = textureStore.getPageCount();
+
+	_pageOffsets.assign(pageCount + 1, 0);
+
+	for (size_t tile : visibleTiles)
+	{
+		if (_tileSlots[tile].isValid())
+			_pageOffsets[_tileSlots[tile].page + 1]++;
+	}
+
+	for (size_t page = 0; page < pageCount; page++)
+		_pageOffsets[page + 1] += _pageOffsets[page];
+
+	vector<size_t> nextCommand(_pageOffsets.begin(), _pageOffsets.end() - 1);
+
+	for (size_t tile : visibleTiles)
+	{
+		if (!_tileSlots[tile].isValid())
+			continue; // no texture yet
+
+		DrawElementsIndirectCommand& command = _commands[nextCommand[_tileSlots[tile].page]++];
+
+		command.count = __triangleIndexCount;
+		command.instanceCount = 1;
+		command.firstIndex = __triangleFirstIndex;
+		command.baseVertex = (GLuint)(tile * __verticesPerTile);
+		command.baseInstance = (GLuint)tile;
+	}
+	///
+
+	glBindVertexArray(_vao);
+
+	if (_multiDrawIndirect)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+
+		// orphan and refill, the driver hands out fresh storage instead of waiting on the last frame
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, _commands.size() * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, _pageOffsets[pageCount] * sizeof(DrawElementsIndirectCommand), _commands.data());
+	}
+
+	/// one submission per page
+	for (size_t page = 0; page < pageCount; page++)
+	{
+		size_t first = _pageOffsets[page];
+		size_t count = _pageOffsets[page + 1] - first;
+
+		if (count == 0)
+			continue;
+
+		textureStore.bindPage((GLuint)page);
+
+		if (_multiDrawIndirect)
+		{
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 
+				(const void*)(first * sizeof(DrawElementsIndirectCommand)), (GLsizei)count, 0);
+
+			_drawCallCount++;
+		}
+		else
+		{
+			for (size_t i = first; i < first + count; i++)
+				drawCommand(_commands[i], GL_TRIANGLES);
+
+			_drawCallCount += count;
+		}
+	}
+	///
+
+	if (_multiDrawIndirect)
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glBindVertexArray(0);
+}
+
+void TileBatchRenderer::renderBoundaries(const vector<size_t>& visibleTiles)
+{
+	if (visibleTiles.empty() || _vao == 0)
+		return;
+
+	glBindVertexArray(_vao);
+	glDepthFunc(GL_LEQUAL); // lines sit exactly on the tile quads
+
+	for (size_t tile : visibleTiles)
+	{
+		DrawElementsIndirectCommand command;
+
+		command.count = __lineIndexCount;
+		command.instanceCount = 1;
+		command.firstIndex = __lineFirstIndex;
+		command.baseVertex = (GLuint)(tile * __verticesPerTile);
+		command.baseInstance = (GLuint)tile;
+
+		drawCommand(command, GL_LINES);
+	}
+
+	glDepthFunc(GL_LESS);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "TileTextureStore.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// batched tile renderer
+///		- every tile quad lives in one shared vertex buffer (4 vertices per tile) behind one vao
+///		- all quads share one small index buffer, a tile is selected with its base vertex
+///		- the texture array layer of every tile sits in a per instance attribute; a tile's draw
+///		  uses its tile index as base instance, so the layer buffer is static
+///		- the visible set is submitted with one glMultiDrawElementsIndirect per texture array page;
+///		  per tile draws where mdi is not available
+///		- vertex layout matches TileArrayShader: location 0 position (vec3), location 1 tex coord (vec2),
+///		  location 2 layer (float, per instance)
+///		- the caller enables the shader and sets its uniforms
+///
+class TileBatchRenderer
+{
+public:
+	TileBatchRenderer();
+	~TileBatchRenderer();
+
+	/// returns the tile index
+	///		- tiles are placed row along x, col along y, so the layer's pixel rows (t) run along x
+	///		  and its pixel columns (s) along y, matching the tile order
+	///		- texCoordScale < 1 maps only part of the layer onto the quad
+	size_t	addTile(const glm::vec3& ll, const glm::vec3& ur, const TileTextureSlot& slot, const glm::vec2& texCoordScale = glm::vec2(1.0f, 1.0f));
+	void	build(); // upload the buffers, call once after the last addTile()
+	void	release();
+	void	reset(); // drops the tiles, keeps the gl buffers for the next build()
+
+	void	setTileSlot(size_t tile, const TileTextureSlot& slot);
+	const TileTextureSlot& getTileSlot(size_t tile) { return _tileSlots[tile]; };
+
+	void	render(const vector<size_t>& visibleTiles, TileTextureStore& textureStore);
+	void	renderBoundaries(const vector<size_t>& visibleTiles); // GL_LINES around every tile
+
+	/// begin - getters / accessors
+	size_t	getTileCount() { return _tileSlots.size(); };
+	size_t	getDrawCallCount() { return _drawCallCount; }; // of the last render()
+	bool	isMultiDrawIndirectSupported() { return _multiDrawIndirect; };
+	/// end - getters / accessors
+
+protected:
+	struct DrawElementsIndirectCommand
+	{
+		GLuint	count;
+		GLuint	instanceCount;
+		GLuint	firstIndex;
+		GLuint	baseVertex;
+		GLuint	baseInstance;
+	};
+
+	vector<GLfloat>			_vertices;		// x, y, z, u, v per vertex, 4 vertices per tile
+	vector<TileTextureSlot>	_tileSlots;
+
+	vector<DrawElementsIndirectCommand>	_commands;		// rebuilt every render(), grouped by page
+	vector<size_t>						_pageOffsets;	// first command of every page in _commands
+
+	GLuint	_vao;
+	GLuint	_vertexBuffer;
+	GLuint	_layerBuffer;
+	GLuint	_indexBuffer;
+	GLuint	_indirectBuffer;
+
+	bool	_multiDrawIndirect;
+	bool	_baseInstance;
+	size_t	_drawCallCount;
+
+	void	drawCommand(const DrawElementsIndirectCommand& command, GLenum mode);
+};
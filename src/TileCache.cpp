@@ -0,0 +1,399 @@
+#include "TileCache.h"
+#include "MosaicImageSource.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////
+uint32_t TileCacheHeader::getPixelFormat(TileCompression compression)
+{
+	switch (compression)
+	{
+		case TILE_COMPRESSION_BC1:	return BC1;
+		case TILE_COMPRESSION_BC7:	return BC7;
+		default:					return RGB8;
+	}
+}
+
+TileCompression TileCacheHeader::getCompression(uint32_t pixelFormat)
+{
+	switch (pixelFormat)
+	{
+		case BC1:	return TILE_COMPRESSION_BC1;
+		case BC7:	return TILE_COMPRESSION_BC7;
+		default:	return TILE_COMPRESSION_NONE;
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+TileCacheWriter::TileCacheWriter()
+{
+	_file = NULL;
+	_writeOffset = 0;
+
+	memset(&_header, 0, sizeof(_header));
+}
+
+TileCacheWriter::~TileCacheWriter()
+{
+	if (_file)
+		abort();
+}
+
+bool TileCacheWriter::create(const string& filename, const TileCacheHeader& header)
+{
+	_filename = filename;
+	_header = header;
+	_header.magic = 0; // until finish()
+	_header.version = TileCacheHeader::VERSION;
+	_header.indexOffset = 0;
+
+	_index.assign((size_t)header.nodeCount, TileCacheEntry());
+
+	for (TileCacheEntry& entry : _index)
+		memset(&entry, 0, sizeof(entry));
+
+	_file = fopen(filename.c_str(), "wb");
+
+	if (_file == NULL)
+	{
+		cout << __FUNCTION__ << "Error, can not create " << filename << endl;
+		return false;
+	}
+
+	/// placeholder header, the real one goes in at the end
+	if (fwrite(&_header, sizeof(_header), 1, _file) != 1)
+	{
+		abort();
+		return false;
+	}
+	///
+
+	_writeOffset = sizeof(_header);
+
+	return true;
+}
+
+bool TileCacheWriter::writeTile(size_t node, uint32_t level, uint32_t row, uint32_t col, const unsigned char* payload, size_t bytes)
+{
+	if (_file == NULL || node >= _index.size())
+		return false;
+
+	if (fwrite(payload, 1, bytes, _file) != bytes)
+	{
+		cout << __FUNCTION__ << "Error, writing " << _filename << " failed" << endl;
+		return false;
+	}
+
+	TileCacheEntry& entry = _index[node];
+
+	entry.level = level;
+	entry.row = row;
+	entry.col = col;
+	entry.bytes = (uint32_t)bytes;
+	entry.offset = _writeOffset;
+
+	_writeOffset += bytes;
+
+	return true;
+}
+
+bool TileCacheWriter::finish()
+{
+	if (_file == NULL)
+		return false;
+
+	/// every node needs its tile
+	for (size_t node = 0; node < _index.size(); node++)
+	{
+		if (_index[node].bytes == 0)
+		{
+			cout << __FUNCTION__ << "Error, tile " << node << " missing, " << _filename << " not written" << endl;
+
+			abort();
+			return false;
+		}
+	}
+	///
+
+	_header.indexOffset = _writeOffset;
+	_header.magic = TileCacheHeader::MAGIC;
+
+	bool written = fwrite(_index.data(), sizeof(TileCacheEntry), _index.size(), _file) == _index.size() &&
+				   fseek(_file, 0, SEEK_SET) == 0 &&
+				   fwrite(&_header, sizeof(_header), 1, _file) == 1;
+
+	written = (fclose(_file) == 0) && written;
+	_file = NULL;
+
+	if (!written)
+	{
+		cout << __FUNCTION__ << "Error, writing " << _filename << " failed" << endl;
+
+		remove(_filename.c_str());
+		return false;
+	}
+
+	cout << __FUNCTION__ << " wrote " << _filename << " " << _index.size() << " tiles ("
+		 << (_writeOffset + _index.size() * sizeof(TileCacheEntry)) / (1024 * 1024) << " MB)" << endl;
+
+	return true;
+}
+
+void TileCacheWriter::abort()
+{
+	if (_file)
+		fclose(_file);
+
+	_file = NULL;
+
+	remove(_filename.c_str());
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+TileCache::TileCache()
+{
+	_mapping = NULL;
+	_mappingSize = 0;
+	_index = NULL;
+
+	memset(&_header, 0, sizeof(_header));
+
+#ifdef _WIN32
+	_fileHandle = INVALID_HANDLE_VALUE;
+	_mappingHandle = NULL;
+#else
+	_fileDescriptor = -1;
+#endif
+}
+
+TileCache::~TileCache()
+{
+#ifdef _WIN32
+	if (_mapping)
+		UnmapViewOfFile(_mapping);
+
+	if (_mappingHandle)
+		CloseHandle(_mappingHandle);
+
+	if (_fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(_fileHandle);
+#else
+	if (_mapping)
+		munmap(_mapping, _mappingSize);
+
+	if (_fileDescriptor >= 0)
+		close(_fileDescriptor);
+#endif
+
+	_mapping = NULL;
+}
+
+string TileCache::getCacheFilename(const string& imageFilename)
+{
+	return imageFilename + ".tiles";
+}
+
+static bool getFileIdentity(const string& filename, uint64_t& bytes, int64_t& modified)
+{
+#ifdef _WIN32
+	struct _stat64 fileStat;
+
+	if (_stat64(filename.c_str(), &fileStat) != 0)
+		return false;
+#else
+	struct stat fileStat;
+
+	if (stat(filename.c_str(), &fileStat) != 0)
+		return false;
+#endif
+
+	bytes = (uint64_t)fileStat.st_size;
+	modified = (int64_t)fileStat.st_mtime;
+
+	return true;
+}
+
+bool TileCache::getSourceIdentity(const string& imageFilename, uint64_t& bytes, int64_t& modified, uint64_t& imagesDigest)
+{
+	imagesDigest = 0;
+
+	if (!getFileIdentity(imageFilename, bytes, modified))
+		return false;
+
+	/// a mosaic changes with any of its images: fnv-1a over the size and modification time of
+	/// each, in manifest order; one that is missing counts as size and time ~0
+	vector<string> imageFilenames;
+
+	if (!MosaicImageSource::isManifest(imageFilename) || !MosaicImageSource::getImageFilenames(imageFilename, imageFilenames))
+		return true;
+
+	imagesDigest = 14695981039346656037ULL;
+
+	for (const string& filename : imageFilenames)
+	{
+		uint64_t	imageBytes = ~0ULL;
+		int64_t		imageModified = ~0LL;
+
+		getFileIdentity(filename, imageBytes, imageModified);
+
+		uint64_t values[2] = { imageBytes, (uint64_t)imageModified };
+
+		for (uint64_t value : values)
+		{
+			for (size_t i = 0; i < 8; i++)
+				imagesDigest = (imagesDigest ^ ((value >> (i * 8)) & 0xff)) * 1099511628211ULL;
+		}
+	}
+	///
+
+	return true;
+}
+
+TileCache* TileCache::open(const string& cacheFilename, const string& imageFilename, size_t tileTexSize, TileCompression compression)
+{
+	TileCache*	cache = new TileCache();
+	size_t		fileSize = 0;
+
+#ifdef _WIN32
+	cache->_fileHandle = CreateFileA(cacheFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	LARGE_INTEGER size;
+
+	if (cache->_fileHandle != INVALID_HANDLE_VALUE && GetFileSizeEx(cache->_fileHandle, &size))
+		fileSize = (size_t)size.QuadPart;
+#else
+	cache->_fileDescriptor = ::open(cacheFilename.c_str(), O_RDONLY);
+
+	struct stat fileStat;
+
+	if (cache->_fileDescriptor >= 0 && fstat(cache->_fileDescriptor, &fileStat) == 0)
+		fileSize = (size_t)fileStat.st_size;
+#endif
+
+	if (fileSize < sizeof(TileCacheHeader))
+	{
+		delete cache; // no cache, not an error
+		return NULL;
+	}
+
+	/// map it, only the header and the index are read here
+#ifdef _WIN32
+	cache->_mappingHandle = CreateFileMappingA(cache->_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (cache->_mappingHandle)
+		cache->_mapping = (unsigned char*)MapViewOfFile(cache->_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, cache->_fileDescriptor, 0);
+
+	if (mapping != MAP_FAILED)
+	{
+		cache->_mapping = (unsigned char*)mapping;
+
+		madvise(mapping, fileSize, MADV_RANDOM); // tiles are read in lod order, not file order
+	}
+#endif
+	///
+
+	if (cache->_mapping == NULL)
+	{
+		cout << __FUNCTION__ << "Error, mapping " << cacheFilename << " failed" << endl;
+
+		delete cache;
+		return NULL;
+	}
+
+	cache->_mappingSize = fileSize;
+
+	memcpy(&cache->_header, cache->_mapping, sizeof(TileCacheHeader));
+
+	if (!cache->validate(imageFilename, tileTexSize, compression))
+	{
+		cout << __FUNCTION__ << " " << cacheFilename << " is stale, damaged or not " << BlockCompressor::getName(compression) << ", not used" << endl;
+
+		delete cache;
+		return NULL;
+	}
+
+	cache->_index = (const TileCacheEntry*)(cache->_mapping + cache->_header.indexOffset);
+
+	cout << __FUNCTION__ << " mapped " << cacheFilename << " " << cache->_header.nodeCount << " tiles, "
+		 << cache->_header.imageWidth << " x " << cache->_header.imageHeight << " (" << fileSize / (1024 * 1024) << " MB)" << endl;
+
+	return cache;
+}
+
+bool TileCache::validate(const string& imageFilename, size_t tileTexSize, TileCompression compression)
+{
+	/// the file itself
+	if (_header.magic != TileCacheHeader::MAGIC || _header.version != TileCacheHeader::VERSION)
+		return false;
+
+	if (_header.indexOffset < sizeof(TileCacheHeader) || _header.indexOffset % sizeof(uint64_t) != 0 ||
+		_header.nodeCount == 0 || _header.indexOffset + _header.nodeCount * sizeof(TileCacheEntry) > _mappingSize)
+		return false;
+	///
+
+	/// what it was built from; a cache without its source is still good, the source is not needed
+	uint64_t	sourceBytes;
+	int64_t		sourceModified;
+	uint64_t	imagesDigest;
+
+	if (getSourceIdentity(imageFilename, sourceBytes, sourceModified, imagesDigest) &&
+		(sourceBytes != _header.sourceBytes || sourceModified != _header.sourceModified || imagesDigest != _header.imagesDigest))
+		return false;
+
+	if (_header.tileTexSize != tileTexSize || _header.pixelFormat != TileCacheHeader::getPixelFormat(compression))
+		return false;
+	///
+
+	/// every payload has to be inside the file
+	const TileCacheEntry*	index = (const TileCacheEntry*)(_mapping + _header.indexOffset);
+	size_t					tileBytes = compression == TILE_COMPRESSION_NONE ? (size_t)tileTexSize * tileTexSize * _header.bytesPerPixel
+																			 : BlockCompressor::getCompressedSize(tileTexSize, tileTexSize, compression);
+
+	for (size_t node = 0; node < _header.nodeCount; node++)
+	{
+		if (index[node].bytes != tileBytes || index[node].offset + index[node].bytes > _header.indexOffset)
+			return false;
+	}
+	///
+
+	return true;
+}
+
+const unsigned char* TileCache::getTile(size_t node, size_t& bytes)
+{
+	bytes = _index[node].bytes;
+
+	return _mapping + _index[node].offset;
+}
+
+void TileCache::prefetchTile(size_t node)
+{
+	size_t first = (size_t)_index[node].offset;
+	size_t last  = first + _index[node].bytes;
+
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY range = { _mapping + first, last - first };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	first = first / pageSize * pageSize;
+
+	madvise(_mapping + first, last - first, MADV_WILLNEED);
+#endif
+}
+//////////////////////////////////////////////////////////////////////////////////
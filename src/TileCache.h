@@ -0,0 +1,133 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "BlockCompressor.h"
+
+#include <cstdint>
+#include <cstdio>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// on disk tile cache, the whole tile pyramid of one source image, ready for upload
+///		- layout: TileCacheHeader, tile payloads, TileCacheEntry index (one per pyramid node, in
+///		  TilePyramid node order), all little endian
+///		- the header carries the identity of the source file (size, modification time) and the
+///		  tile size; a cache whose identity does not match is stale and is not opened; a mosaic's
+///		  identity also covers every image of its manifest
+///		- payloads are in the upload format of the tile textures, rgb8 or bc1 / bc7 blocks; a cache
+///		  in another format than the texture store's is not opened either, a compression change
+///		  rebuilds the tiles from the source instead of re-encoding the cached ones on every launch
+///		- the header has no implicit padding, every byte of it is written from a field
+///		- the header is written last, a file whose build did not finish never validates
+///
+struct TileCacheHeader
+{
+	static const uint32_t MAGIC = 0x48435454;	// "TTCH"
+	static const uint32_t VERSION = 2;
+
+	enum PixelFormat { RGB8 = 0, BC1, BC7 };
+
+	static uint32_t			getPixelFormat(TileCompression compression);
+	static TileCompression	getCompression(uint32_t pixelFormat);
+
+	uint32_t	magic;
+	uint32_t	version;
+
+	/// source identity
+	uint64_t	sourceBytes;
+	int64_t		sourceModified;		// seconds since the epoch
+	uint64_t	imagesDigest;		// mosaic: size and modification time of its images, 0 otherwise
+	///
+
+	uint32_t	imageWidth, imageHeight;
+	uint32_t	bytesPerPixel;
+	uint32_t	tileTexSize;
+	uint32_t	pixelFormat;		// PixelFormat of the payloads
+	uint32_t	baseRows, baseCols;	// level 0 grid
+	uint32_t	levelCount;			// ends on 8 bytes, nodeCount needs no padding
+	uint64_t	nodeCount;
+	uint64_t	indexOffset;		// TileCacheEntry[nodeCount] from here
+};
+
+static_assert(sizeof(TileCacheHeader) == 80, "TileCacheHeader has implicit padding, its bytes would not all be written");
+
+struct TileCacheEntry
+{
+	uint32_t	level, row, col;
+	uint32_t	bytes;		// payload size
+	uint64_t	offset;		// payload, from the start of the file
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// writes a tile cache, tiles may come in any order
+///
+class TileCacheWriter
+{
+public:
+	TileCacheWriter();
+	~TileCacheWriter();
+
+	/// header carries the source identity and the pyramid layout, nodeCount entries are expected
+	bool	create(const string& filename, const TileCacheHeader& header);
+	bool	writeTile(size_t node, uint32_t level, uint32_t row, uint32_t col, const unsigned char* payload, size_t bytes);
+	bool	finish(); // index and header; the cache is valid after this only
+	void	abort(); // removes the partial file
+
+protected:
+	FILE*					_file;
+	string					_filename;
+	TileCacheHeader			_header;
+	vector<TileCacheEntry>	_index;
+	uint64_t				_writeOffset;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// read only, memory mapped tile cache
+///		- open() checks the header against the source file, the tile size and the tile compression,
+///		  it returns NULL if the cache is missing, stale, of another format or damaged; nothing but the header and the index is touched
+///		- getTile() points straight into the mapping, the pages come in as the tiles are read
+///
+class TileCache
+{
+public:
+	/// "<image>.tiles"
+	static string	getCacheFilename(const string& imageFilename);
+
+	/// size and modification time of the source file, false if it can not be stat-ed; a
+	/// mosaic manifest adds the digest of its images (imagesDigest is 0 for any other file)
+	static bool		getSourceIdentity(const string& imageFilename, uint64_t& bytes, int64_t& modified, uint64_t& imagesDigest);
+
+	static TileCache* open(const string& cacheFilename, const string& imageFilename, size_t tileTexSize, TileCompression compression);
+
+	~TileCache();
+
+	const unsigned char*	getTile(size_t node, size_t& bytes);
+	void					prefetchTile(size_t node); // the next getTile() of it does not fault
+
+	/// begin - getters / accessors
+	const TileCacheHeader&	getHeader() { return _header; };
+	const TileCacheEntry&	getEntry(size_t node) { return _index[node]; };
+	TileCompression			getCompression() { return TileCacheHeader::getCompression(_header.pixelFormat); };
+	size_t					getNodeCount() { return (size_t)_header.nodeCount; };
+	/// end - getters / accessors
+
+protected:
+	TileCache();
+
+	bool	validate(const string& imageFilename, size_t tileTexSize, TileCompression compression);
+
+	unsigned char*			_mapping;
+	size_t					_mappingSize;
+
+	TileCacheHeader			_header;
+	const TileCacheEntry*	_index;
+
+#ifdef _WIN32
+	void*					_fileHandle;
+	void*					_mappingHandle;
+#else
+	int						_fileDescriptor;
+#endif
+};
@@ -0,0 +1,397 @@
+#include "TilePyramid.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+//////////////////////////////////////////////////////////////////////////////////
+/// average 2x2 blocks of a size x size tile into one quadrant of a size x size tile
+///
+static void downsampleIntoQuadrant(const unsigned char* src, size_t size, size_t bytesPerPixel, 
+								   unsigned char* dst, size_t quadrantX, size_t quadrantY)
+{
+	size_t half  = size / 2;
+	size_t pitch = size * bytesPerPixel;
+
+	PixelKernels::downsample2x2(src, pitch, half, half, bytesPerPixel, dst + quadrantY * half * pitch + quadrantX * half * bytesPerPixel, pitch);
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+TilePyramid::TilePyramid()
+{
+	_pixelSize = 1.0f;
+	_tileTexSize = 0;
+	_residentNodes = NULL;
+	_missingNodes = NULL;
+}
+
+TilePyramid::~TilePyramid()
+{
+	release();
+}
+
+void TilePyramid::release()
+{
+	_nodes.clear();
+	_levelFirstNode.clear();
+	_levelRows.clear();
+	_levelCols.clear();
+}
+
+size_t TilePyramid::getNodeIndex(size_t level, size_t row, size_t col)
+{
+	if (level >= _levelFirstNode.size() || row >= _levelRows[level] || col >= _levelCols[level])
+		return TilePyramidNode::INVALID_NODE;
+
+	return _levelFirstNode[level] + row * _levelCols[level] + col;
+}
+
+void TilePyramid::getBaseGrid(size_t imageWidth, size_t imageHeight, size_t tileTexSize, size_t& baseRows, size_t& baseCols)
+{
+	baseRows = (imageHeight + tileTexSize - 1) / tileTexSize;
+	baseCols = (imageWidth + tileTexSize - 1) / tileTexSize;
+}
+
+void TilePyramid::build(size_t baseRows, size_t baseCols, const glm::vec3& baseTileDimension, float pixelSize, size_t tileTexSize)
+{
+	release();
+
+	if (baseRows == 0 || baseCols == 0)
+		return;
+
+	_baseTileDimension = baseTileDimension;
+	_pixelSize = pixelSize;
+	_tileTexSize = tileTexSize;
+
+	/// level sizes, halving (rounded up) until one node is left
+	size_t rows = baseRows;
+	size_t cols = baseCols;
+
+	while (true)
+	{
+		_levelFirstNode.push_back(_nodes.size());
+		_levelRows.push_back(rows);
+		_levelCols.push_back(cols);
+
+		_nodes.resize(_nodes.size() + rows * cols);
+
+		if (rows == 1 && cols == 1)
+			break;
+
+		rows = (rows + 1) / 2;
+		cols = (cols + 1) / 2;
+	}
+	///
+
+	/// node extents from integer grid positions, clipped to the level 0 grid
+	for (size_t level = 0; level < _levelFirstNode.size(); level++)
+	{
+		size_t span = (size_t)1 << level; // level 0 tiles per node side
+
+		for (size_t row = 0; row < _levelRows[level]; row++)
+		{
+			for (size_t col = 0; col < _levelCols[level]; col++)
+			{
+				TilePyramidNode& node = _nodes[getNodeIndex(level, row, col)];
+
+				size_t firstRow = row * span;
+				size_t firstCol = col * span;
+				size_t lastRow  = std::min(firstRow + span, baseRows);
+				size_t lastCol  = std::min(firstCol + span, baseCols);
+
+				node.level = level;
+				node.row = row;
+				node.col = col;
+				node.ll = glm::vec3(firstRow * baseTileDimension.x, firstCol * baseTileDimension.y, 0.0f);
+				node.ur = glm::vec3(lastRow  * baseTileDimension.x, lastCol  * baseTileDimension.y, 0.0f);
+				node.texCoordScale = glm::vec2((float)(lastCol - firstCol) / span, (float)(lastRow - firstRow) / span); // s: cols, t: rows
+				node.parent = getNodeIndex(level + 1, row / 2, col / 2);
+				node.hasChildren = false;
+
+				for (size_t q = 0; q < 4; q++)
+				{
+					node.children[q] = level == 0 ? TilePyramidNode::INVALID_NODE : getNodeIndex(level - 1, 2 * row + q / 2, 2 * col + q % 2);
+					node.hasChildren |= node.children[q] != TilePyramidNode::INVALID_NODE;
+				}
+			}
+		}
+	}
+	///
+
+	cout << __FUNCTION__ << " tile pyramid: " << _levelFirstNode.size() << " levels, " << _nodes.size() << " nodes" << endl;
+}
+
+bool TilePyramid::generatePixels(ImageSource& source, const function<bool(size_t, const unsigned char*)>& upload, vector<unsigned char>& rootPixels,
+								 JobSystem* jobSystem, const atomic<bool>* cancel)
+{
+	if (_nodes.empty())
+		return false;
+
+	size_t tileBytes = source.getRegionSize(_tileTexSize, _tileTexSize);
+
+	/// one row of tiles per level, plus a second level 0 row that is cut while the first one is uploaded
+	vector<vector<vector<unsigned char> > >	rowBuffers(_levelFirstNode.size());
+	vector<vector<unsigned char> >			nextRow(_levelCols[0]);
+
+	for (size_t level = 0; level < _levelFirstNode.size(); level++)
+	{
+		rowBuffers[level].resize(_levelCols[level]);
+
+		for (vector<unsigned char>& buffer : rowBuffers[level])
+			buffer.assign(tileBytes, 0); // missing children stay black
+	}
+
+	for (vector<unsigned char>& buffer : nextRow)
+		buffer.resize(tileBytes);
+	///
+
+	/// sweep level 0 front to back, the levels above fill in as their rows complete
+	readRow(0, source, rowBuffers[0], jobSystem, NULL);
+
+	for (size_t row = 0; row < _levelRows[0]; row++)
+	{
+		JobCounter nextRowRead;
+
+		if (jobSystem && row + 1 < _levelRows[0])
+			readRow(row + 1, source, nextRow, jobSystem, &nextRowRead);
+
+		bool completed = completeRow(0, row, source.getBytesPerPixel(), upload, rowBuffers, jobSystem);
+
+		if (!completed || (cancel && *cancel))
+		{
+			if (jobSystem)
+				jobSystem->wait(nextRowRead); // the jobs write into nextRow
+
+			return false;
+		}
+
+		if (row + 1 < _levelRows[0])
+		{
+			if (jobSystem)
+				jobSystem->wait(nextRowRead);
+			else
+				readRow(row + 1, source, nextRow, NULL, NULL);
+
+			rowBuffers[0].swap(nextRow);
+		}
+	}
+	///
+
+	rootPixels.swap(rowBuffers.back()[0]);
+
+	return true;
+}
+
+/// cut one level 0 row, one job per tile when there is a job system
+///		- with a counter the jobs are left running, without one this returns when the row is cut
+///
+void TilePyramid::readRow(size_t row, ImageSource& source, vector<vector<unsigned char> >& rowBuffer, JobSystem* jobSystem, JobCounter* counter)
+{
+	if (jobSystem == NULL)
+	{
+		for (size_t col = 0; col < rowBuffer.size(); col++)
+			source.readRegion(row * _tileTexSize, col * _tileTexSize, _tileTexSize, _tileTexSize, rowBuffer[col].data());
+
+		return;
+	}
+
+	JobCounter	localCounter;
+	JobCounter*	readCounter = counter ? counter : &localCounter;
+
+	for (size_t col = 0; col < rowBuffer.size(); col++)
+	{
+		unsigned char* pixels = rowBuffer[col].data();
+
+		jobSystem->submit([this, &source, row, col, pixels]()
+		{
+			source.readRegion(row * _tileTexSize, col * _tileTexSize, _tileTexSize, _tileTexSize, pixels);
+		}, readCounter);
+	}
+
+	if (counter == NULL)
+		jobSystem->wait(localCounter);
+}
+
+bool TilePyramid::completeRow(size_t level, size_t row, size_t bytesPerPixel, const function<bool(size_t, const unsigned char*)>& upload, 
+							  vector<vector<vector<unsigned char> > >& rowBuffers, JobSystem* jobSystem)
+{
+	bool isTop = level + 1 == _levelFirstNode.size();
+
+	/// downsample into the parent row on the workers while this thread uploads
+	JobCounter downsampled;
+
+	auto downsampleCols = [this, level, row, bytesPerPixel, &rowBuffers](size_t begin, size_t end)
+	{
+		// pixel rows follow the tile rows, so this is a plain downsample of the source region
+		for (size_t col = begin; col < end; col++)
+			downsampleIntoQuadrant(rowBuffers[level][col].data(), _tileTexSize, bytesPerPixel, rowBuffers[level + 1][col / 2].data(), col % 2, row % 2);
+	};
+
+	if (!isTop)
+	{
+		if (jobSystem)
+		{
+			for (size_t col = 0; col < _levelCols[level]; col++)
+				jobSystem->submit([downsampleCols, col]() { downsampleCols(col, col + 1); }, &downsampled);
+		}
+		else
+			downsampleCols(0, _levelCols[level]);
+	}
+
+	bool accepted = true;
+
+	for (size_t col = 0; col < _levelCols[level] && accepted; col++)
+		accepted = upload(getNodeIndex(level, row, col), rowBuffers[level][col].data());
+
+	if (jobSystem)
+		jobSystem->wait(downsampled);
+	///
+
+	if (!accepted)
+		return false;
+
+	if (isTop)
+		return true; // root pixels are kept for the caller
+
+	if (level > 0)
+	{
+		for (vector<unsigned char>& pixels : rowBuffers[level])
+			memset(pixels.data(), 0, pixels.size()); // ready for the next row of children
+	}
+
+	/// the parent row is complete after its second child row, or the last row of this level
+	if (row % 2 == 1 || row + 1 == _levelRows[level])
+		return completeRow(level + 1, row / 2, bytesPerPixel, upload, rowBuffers, jobSystem);
+	///
+
+	return true;
+}
+
+void TilePyramid::select(const Frustum& frustum, const glm::mat4& projection, const glm::mat4& modelView, size_t viewportHeight, 
+						 float errorThreshold, size_t maxNodes, vector<size_t>& selectedNodes, 
+						 const vector<unsigned char>* residentNodes, vector<size_t>* missingNodes)
+{
+	selectedNodes.clear();
+
+	if (missingNodes)
+		missingNodes->clear();
+
+	if (_nodes.empty())
+		return;
+
+	_residentNodes = residentNodes;
+	_missingNodes = missingNodes;
+
+	/// camera position in tile space, and the factor taking a world size at distance 1 to pixels
+	///		- projection[1][1] is 1/tan(fov/2) for perspective and 2/height for ortho
+	///		- projection[2][3] is -1 for perspective and 0 for ortho
+	glm::vec4	eye = glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float		texelToPixels = projection[1][1] * viewportHeight / 2.0f;
+	bool		ortho = projection[2][3] == 0.0f;
+	///
+
+	/// coarsen until the node budget holds, the root alone always fits
+	for (size_t attempt = 0; attempt < 16; attempt++)
+	{
+		_lodStats = TileLodStats();
+		_lodStats.finestLevel = _levelFirstNode.size() - 1;
+		_lodStats.errorThreshold = errorThreshold;
+
+		selectedNodes.clear();
+
+		if (_missingNodes)
+			_missingNodes->clear();
+
+		selectNode(getRootNode(), frustum, glm::vec3(eye.x, eye.y, eye.z), texelToPixels, ortho, errorThreshold, true, selectedNodes);
+
+		if (selectedNodes.size() <= maxNodes)
+			break;
+
+		errorThreshold *= 2.0f;
+	}
+	///
+
+	_lodStats.selectedNodes = selectedNodes.size();
+	_residentNodes = NULL;
+	_missingNodes = NULL;
+
+	for (size_t node : selectedNodes)
+		_lodStats.finestLevel = std::min(_lodStats.finestLevel, _nodes[node].level);
+}
+
+/// returns true when the node's area inside the frustum is fully covered by the selected nodes
+///
+bool TilePyramid::selectNode(size_t nodeIndex, const Frustum& frustum, const glm::vec3& eye, float texelToPixels, bool ortho, 
+							 float errorThreshold, bool allowFinerFallback, vector<size_t>& selectedNodes)
+{
+	const TilePyramidNode& node = _nodes[nodeIndex];
+
+	if (frustum.testBox(node.ll, node.ur) == Frustum::OUTSIDE)
+	{
+		_lodStats.culledNodes++;
+		return true;
+	}
+
+	bool refine = false;
+
+	if (node.hasChildren)
+	{
+		/// screen space error: size in pixels of one texel of this level at the closest point of the node
+		float texelSize = _pixelSize * (float)((size_t)1 << node.level);
+		float distance  = 1.0f;
+
+		if (!ortho)
+		{
+			glm::vec3 closest(glm::clamp(eye.x, node.ll.x, node.ur.x), glm::clamp(eye.y, node.ll.y, node.ur.y), glm::clamp(eye.z, node.ll.z, node.ur.z));
+
+			distance = glm::max(glm::distance(eye, closest), 1e-4f);
+		}
+
+		float screenError = texelSize * texelToPixels / distance;
+		///
+
+		refine = screenError > errorThreshold;
+	}
+
+	/// fine enough and there, done
+	if (!refine && isResident(nodeIndex))
+	{
+		selectedNodes.push_back(nodeIndex);
+
+		return true;
+	}
+
+	if (!refine && allowFinerFallback && _missingNodes)
+		_missingNodes->push_back(nodeIndex); // the lod wants exactly this one, not a fallback for it
+	///
+
+	/// too coarse, or missing: go to the children, a missing node only looks one level further down
+	if (node.hasChildren && (refine || allowFinerFallback))
+	{
+		size_t	firstChild = selectedNodes.size();
+		bool	covered = true;
+
+		_lodStats.refinedNodes++;
+
+		for (size_t child : node.children)
+		{
+			if (child != TilePyramidNode::INVALID_NODE)
+				covered &= selectNode(child, frustum, eye, texelToPixels, ortho, errorThreshold, refine, selectedNodes);
+		}
+
+		/// children leave holes, this node covers them all at a lower resolution
+		if (!covered && isResident(nodeIndex))
+		{
+			selectedNodes.resize(firstChild);
+			selectedNodes.push_back(nodeIndex);
+
+			return true;
+		}
+		///
+
+		return covered;
+	}
+	///
+
+	return false;
+}
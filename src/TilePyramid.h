@@ -0,0 +1,130 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "Culling.h"
+#include "ImageSource.h"
+#include "JobSystem.h"
+
+#include <functional>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// one tile of the pyramid
+///		- level 0 is the full resolution, every level up halves the resolution
+///		- a node at level k covers 2^k x 2^k level 0 tiles, its children are the 2x2 nodes below
+///		- texCoordScale < 1 on the nodes that hang over the edge of the level 0 grid, their
+///		  geometry is clipped to the grid and the tex coords follow (s: cols, t: rows)
+///		- the pixels of a node are the source region below it, downsampled 2^level times
+///		- known limitation: tiles have no border texels, the sampler clamps at every tile edge,
+///		  so linear filtering never blends across two tiles and a magnified view shows a faint
+///		  seam along them; a 1 texel gutter would need a layer of tileTexSize + 2 (off the 4x4
+///		  block grid of the compressed formats) and every parent built with its neighbours' edges
+///
+struct TilePyramidNode
+{
+	size_t		level, row, col;
+	glm::vec3	ll, ur;
+	glm::vec2	texCoordScale;
+	size_t		parent;
+	size_t		children[4];	// INVALID_NODE where the 2x2 block runs off the grid
+	bool		hasChildren;
+
+	static const size_t INVALID_NODE = (size_t)-1;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// counters of the last select()
+///
+struct TileLodStats
+{
+	size_t	selectedNodes;
+	size_t	culledNodes;	// nodes rejected by the frustum (their subtrees are not counted)
+	size_t	refinedNodes;	// nodes replaced by their children
+	size_t	finestLevel;	// lowest level that got selected
+	float	errorThreshold;	// threshold that was finally used, see maxNodes
+
+	TileLodStats() : selectedNodes(0), culledNodes(0), refinedNodes(0), finestLevel(0), errorThreshold(0.0f) {};
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// multi resolution tile pyramid
+///		- nodes are stored level by level, level 0 first in the row / col order of buildScene(),
+///		  so a level 0 node index equals the index of the tile it was built for
+///		- node corners are computed from integer grid positions, so neighbours of any levels share
+///		  bit identical edges and no cracks open at level boundaries
+///		- select() walks the pyramid top down, culls against the frustum and refines a node while
+///		  one of its texels projects to more than the error threshold in screen pixels
+///		- with a residency list, select() only returns nodes that have their texture: a missing
+///		  node is replaced by its children, and children that can not all be drawn are replaced
+///		  by their parent if it is there
+///
+class TilePyramid
+{
+public:
+	TilePyramid();
+	~TilePyramid();
+
+	/// level 0 grid of a width x height image, edge tiles partly filled
+	static void	getBaseGrid(size_t imageWidth, size_t imageHeight, size_t tileTexSize, size_t& baseRows, size_t& baseCols);
+
+	/// rows map to x and cols to y, same as the tile placement in buildScene()
+	void	build(size_t baseRows, size_t baseCols, const glm::vec3& baseTileDimension, float pixelSize, size_t tileTexSize);
+	void	release();
+
+	/// cut / downsample the pixels of every node
+	///		- level 0 is swept row by row, so the source is read front to back in tile row bands
+	///		- every level above accumulates one row of nodes, a finished row is uploaded and
+	///		  downsampled into the level above, so one tile row per level is held at a time
+	///		- with a job system, the next level 0 row is cut and the finished rows are downsampled on
+	///		  the workers while the calling thread uploads
+	///		- upload(node, pixels) gets tileTexSize x tileTexSize tightly packed pixels, always on
+	///		  the calling thread
+	///		- rootPixels receives the pixels of the root node
+	///		- stops early, returning false, once cancel is set or upload() returns false
+	bool	generatePixels(ImageSource& source, const function<bool(size_t, const unsigned char*)>& upload, vector<unsigned char>& rootPixels,
+						   JobSystem* jobSystem = NULL, const atomic<bool>* cancel = NULL);
+
+	/// residentNodes: one entry per node, non zero when the node's texture is there; NULL if all are
+	/// missingNodes: receives the nodes the lod wanted but could not draw, if not NULL
+	void	select(const Frustum& frustum, const glm::mat4& projection, const glm::mat4& modelView, size_t viewportHeight, 
+				   float errorThreshold, size_t maxNodes, vector<size_t>& selectedNodes, 
+				   const vector<unsigned char>* residentNodes = NULL, vector<size_t>* missingNodes = NULL);
+
+	/// begin - getters / accessors
+	size_t					getNodeCount() { return _nodes.size(); };
+	const TilePyramidNode&	getNode(size_t node) { return _nodes[node]; };
+	size_t					getLevelCount() { return _levelFirstNode.size(); };
+	size_t					getRootNode() { return _nodes.empty() ? TilePyramidNode::INVALID_NODE : _nodes.size() - 1; };
+	size_t					getLevelFirstNode(size_t level) { return _levelFirstNode[level]; };
+	size_t					getLevelRows(size_t level) { return _levelRows[level]; };
+	size_t					getLevelCols(size_t level) { return _levelCols[level]; };
+	const TileLodStats&		getLodStats() { return _lodStats; };
+	size_t					getReservedBytes() { return _nodes.capacity() * sizeof(TilePyramidNode); }; // release() keeps it
+	/// end - getters / accessors
+
+protected:
+	vector<TilePyramidNode>	_nodes;
+	vector<size_t>			_levelFirstNode;
+	vector<size_t>			_levelRows, _levelCols;
+
+	glm::vec3				_baseTileDimension;
+	float					_pixelSize;
+	size_t					_tileTexSize;
+
+	TileLodStats			_lodStats;
+	const vector<unsigned char>* _residentNodes; // only during select()
+	vector<size_t>*			_missingNodes;	// only during select()
+
+	size_t	getNodeIndex(size_t level, size_t row, size_t col);
+
+	void	readRow(size_t row, ImageSource& source, vector<vector<unsigned char> >& rowBuffer, JobSystem* jobSystem, JobCounter* counter);
+	bool	completeRow(size_t level, size_t row, size_t bytesPerPixel, const function<bool(size_t, const unsigned char*)>& upload, 
+						vector<vector<vector<unsigned char> > >& rowBuffers, JobSystem* jobSystem);
+
+	bool	isResident(size_t node) { return _residentNodes == NULL || (*_residentNodes)[node] != 0; };
+
+	bool	selectNode(size_t node, const Frustum& frustum, const glm::vec3& eye, float texelToPixels, bool ortho, 
+					   float errorThreshold, bool allowFinerFallback, vector<size_t>& selectedNodes);
+};
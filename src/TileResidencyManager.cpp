@@ -0,0 +1,248 @@
+#include "TileResidencyManager.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+TileResidencyManager::TileResidencyManager()
+{
+	_tileBytes = 0;
+	_maxResident = 0;
+	_maxInFlight = 0;
+
+	release();
+}
+
+void TileResidencyManager::initialize(size_t tileCount, size_t tileBytes, size_t budgetBytes, size_t maxInFlight)
+{
+	release();
+
+	_state.assign(tileCount, NOT_RESIDENT);
+	_resident.assign(tileCount, 0);
+	_pinned.assign(tileCount, 0);
+	_prefetched.assign(tileCount, 0);
+	_lastUsedFrame.assign(tileCount, 0);
+	_prev.assign(tileCount, NONE);
+	_next.assign(tileCount, NONE);
+
+	_tileBytes = tileBytes;
+	_maxResident = tileBytes > 0 ? budgetBytes / tileBytes : 0;
+	_maxInFlight = maxInFlight < 1 ? 1 : maxInFlight;
+
+	cout << __FUNCTION__ << " tile budget: " << budgetBytes / (1024 * 1024) << " MB, " << _maxResident << " of " << tileCount << " tiles" << endl;
+}
+
+void TileResidencyManager::release()
+{
+	_state.clear();
+	_resident.clear();
+	_pinned.clear();
+	_prefetched.clear();
+	_lastUsedFrame.clear();
+	_prev.clear();
+	_next.clear();
+
+	_head = _tail = NONE;
+	_residentCount = 0;
+	_pinnedCount = 0;
+	_inFlight = 0;
+	_prefetchInFlight = 0;
+	_frame = 1;
+	_stats = TileResidencyStats();
+}
+
+void TileResidencyManager::unlink(size_t tile)
+{
+	if (_prev[tile] != NONE)
+		_next[_prev[tile]] = _next[tile];
+	else
+		_head = _next[tile];
+
+	if (_next[tile] != NONE)
+		_prev[_next[tile]] = _prev[tile];
+	else
+		_tail = _prev[tile];
+
+	_prev[tile] = _next[tile] = NONE;
+}
+
+void TileResidencyManager::linkFront(size_t tile)
+{
+	_prev[tile] = NONE;
+	_next[tile] = _head;
+
+	if (_head != NONE)
+		_prev[_head] = tile;
+
+	_head = tile;
+
+	if (_tail == NONE)
+		_tail = tile;
+}
+
+void TileResidencyManager::pinTile(size_t tile)
+{
+	if (tile < _pinned.size() && !_pinned[tile])
+	{
+		_pinned[tile] = 1;
+		_pinnedCount++;
+	}
+}
+
+void TileResidencyManager::beginFrame()
+{
+	_frame++;
+}
+
+void TileResidencyManager::touch(const vector<size_t>& drawnTiles)
+{
+	for (size_t tile : drawnTiles)
+	{
+		if (_state[tile] != RESIDENT)
+			continue;
+
+		_lastUsedFrame[tile] = _frame;
+		_stats.hits++;
+
+		if (_prefetched[tile])
+		{
+			_prefetched[tile] = 0;
+			_stats.prefetchHits++;
+		}
+
+		if (_head != tile)
+		{
+			unlink(tile);
+			linkFront(tile);
+		}
+	}
+}
+
+void TileResidencyManager::request(size_t tile, const function<void(size_t)>& load, bool countInFlight)
+{
+	_state[tile] = REQUESTED;
+
+	if (countInFlight)
+		_inFlight++;
+
+	_stats.loadRequests++;
+
+	load(tile);
+}
+
+void TileResidencyManager::requestMissing(const vector<size_t>& missingTiles, const function<void(size_t)>& load)
+{
+	for (size_t tile : missingTiles)
+	{
+		if (_state[tile] == RESIDENT)
+			continue;
+
+		_stats.misses++;
+		_lastUsedFrame[tile] = _frame; // keeps it from being evicted the frame it arrives
+
+		if (_prefetched[tile])
+		{
+			_prefetched[tile] = 0; // on its way, but not in time; a visible load from now on
+			_prefetchInFlight--;
+			_stats.prefetchLate++;
+		}
+
+		if (_state[tile] == NOT_RESIDENT && _inFlight < _maxInFlight)
+			request(tile, load, !_pinned[tile]);
+	}
+}
+
+/// after requestMissing(), so the visible tiles always go first
+///
+void TileResidencyManager::requestPrefetch(const vector<size_t>& tiles, const function<void(size_t)>& load, size_t maxPrefetchInFlight)
+{
+	for (size_t tile : tiles)
+	{
+		if (_inFlight >= _maxInFlight || _prefetchInFlight >= maxPrefetchInFlight)
+			break;
+
+		if (_state[tile] != NOT_RESIDENT)
+			continue;
+
+		_prefetched[tile] = 1;
+		_prefetchInFlight++;
+		_stats.prefetchRequests++;
+
+		request(tile, load, true);
+	}
+}
+
+void TileResidencyManager::requestPinned(const function<void(size_t)>& load)
+{
+	for (size_t tile = _pinned.size(); tile-- > 0; ) // coarsest (last) first
+	{
+		if (_pinned[tile] && _state[tile] == NOT_RESIDENT)
+			request(tile, load, false); // pinned tiles do not hold back the visible ones
+	}
+}
+
+void TileResidencyManager::tileArrived(size_t tile)
+{
+	if (_state[tile] == REQUESTED && !_pinned[tile] && _inFlight > 0)
+		_inFlight--;
+
+	if (_state[tile] == REQUESTED && _prefetched[tile] && _prefetchInFlight > 0)
+		_prefetchInFlight--;
+
+	if (_state[tile] != RESIDENT)
+	{
+		_state[tile] = RESIDENT;
+		_resident[tile] = 1;
+		_residentCount++;
+
+		linkFront(tile);
+	}
+
+	_stats.loadsCompleted++;
+}
+
+void TileResidencyManager::loadCancelled(size_t tile)
+{
+	if (_state[tile] != REQUESTED)
+		return;
+
+	_state[tile] = NOT_RESIDENT;
+
+	if (!_pinned[tile] && _inFlight > 0)
+		_inFlight--;
+
+	if (_prefetched[tile] && _prefetchInFlight > 0)
+		_prefetchInFlight--;
+
+	_prefetched[tile] = 0;
+}
+
+void TileResidencyManager::evictOverBudget(const function<void(size_t)>& evict)
+{
+	size_t tile = _tail;
+
+	while (_residentCount > _maxResident && tile != NONE)
+	{
+		size_t prev = _prev[tile];
+
+		/// drawn tiles are skipped, not the end of the walk: this frame's arrivals (prefetched ones
+		/// too) are linked in front of them
+		if (!_pinned[tile] && _lastUsedFrame[tile] != _frame)
+		{
+			unlink(tile);
+
+			_state[tile] = NOT_RESIDENT;
+			_resident[tile] = 0;
+			_residentCount--;
+			_stats.evictions++;
+
+			if (_prefetched[tile])
+			{
+				_prefetched[tile] = 0;
+				_stats.prefetchWasted++;
+			}
+
+			evict(tile);
+		}
+
+		tile = prev;
+	}
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+#include <functional>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// residency counters, cumulative since initialize()
+///
+struct TileResidencyStats
+{
+	size_t	hits;			// drawn tiles that were resident
+	size_t	misses;			// tiles the lod wanted but were not resident
+	size_t	evictions;
+	size_t	loadRequests;
+	size_t	loadsCompleted;
+
+	size_t	prefetchRequests;	// loads asked for by the prefetch, not (yet) by the lod
+	size_t	prefetchHits;		// prefetched tiles that were drawn later
+	size_t	prefetchLate;		// prefetched tiles the lod wanted before they arrived
+	size_t	prefetchWasted;		// prefetched tiles evicted without ever being drawn
+
+	TileResidencyStats() : hits(0), misses(0), evictions(0), loadRequests(0), loadsCompleted(0), 
+						   prefetchRequests(0), prefetchHits(0), prefetchLate(0), prefetchWasted(0) {};
+
+	/// share of the prefetched tiles that got drawn, in time or late
+	double	getPrefetchHitRate() const { return prefetchRequests > 0 ? (double)(prefetchHits + prefetchLate) / (double)prefetchRequests : 0.0; };
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// gpu memory budgeted tile residency
+///		- tracks which tiles have a texture, in least recently used order
+///		- misses are turned into load requests (at most maxInFlight at a time), the caller loads
+///		  the tile and reports it back with tileArrived()
+///		- evictOverBudget() drops least recently used tiles until the budget holds; tiles drawn
+///		  in the current frame and pinned tiles are never evicted, the caller keeps the drawn
+///		  set within getMaxResidentCount() - getPinnedCount() for the budget to be a hard one
+///		- pinned tiles (the coarse levels) are requested up front, so there always is a lower
+///		  resolution fallback to draw while a tile reloads
+///		- prefetched tiles (requestPrefetch()) only take the load slots the misses of the frame
+///		  left over, and at most maxPrefetchInFlight of them; they are followed until drawn or
+///		  evicted for the hit rate
+///		- everything here runs on the gl thread
+///
+class TileResidencyManager
+{
+public:
+	TileResidencyManager();
+
+	void	initialize(size_t tileCount, size_t tileBytes, size_t budgetBytes, size_t maxInFlight);
+	void	release();
+
+	void	pinTile(size_t tile); // before the first frame
+
+	/// begin - per frame, in this order
+	void	beginFrame();
+	void	touch(const vector<size_t>& drawnTiles);
+	void	requestMissing(const vector<size_t>& missingTiles, const function<void(size_t)>& load);
+	void	requestPrefetch(const vector<size_t>& tiles, const function<void(size_t)>& load, size_t maxPrefetchInFlight);
+	void	tileArrived(size_t tile);
+	void	evictOverBudget(const function<void(size_t)>& evict);
+	/// end - per frame, in this order
+
+	void	requestPinned(const function<void(size_t)>& load);
+	void	loadCancelled(size_t tile); // a requested tile that will never arrive
+
+	/// begin - getters / accessors
+	const vector<unsigned char>&	getResidentFlags() { return _resident; };
+	const TileResidencyStats&		getStats() { return _stats; };
+	size_t	getResidentCount() { return _residentCount; };
+	size_t	getMaxResidentCount() { return _maxResident; };
+	size_t	getPinnedCount() { return _pinnedCount; };
+	bool	isPinned(size_t tile) { return tile < _pinned.size() && _pinned[tile]; };
+	size_t	getInFlightCount() { return _inFlight; };
+	size_t	getBudgetBytes() { return _maxResident * _tileBytes; };
+	/// end - getters / accessors
+
+protected:
+	enum TileState { NOT_RESIDENT = 0, REQUESTED, RESIDENT };
+
+	static const size_t NONE = (size_t)-1;
+
+	vector<unsigned char>	_state;		// TileState
+	vector<unsigned char>	_resident;	// 1 when RESIDENT, handed to the lod selection
+	vector<unsigned char>	_pinned;
+	vector<unsigned char>	_prefetched;	// requested by the prefetch, not drawn yet
+	vector<size_t>			_lastUsedFrame;
+
+	/// lru list of the resident tiles, head is the most recently used
+	vector<size_t>			_prev, _next;
+	size_t					_head, _tail;
+	///
+
+	size_t					_tileBytes;
+	size_t					_maxResident;
+	size_t					_maxInFlight;
+	size_t					_residentCount;
+	size_t					_pinnedCount;
+	size_t					_inFlight;
+	size_t					_prefetchInFlight;	// part of _inFlight
+	size_t					_frame;
+
+	TileResidencyStats		_stats;
+
+	void	unlink(size_t tile);
+	void	linkFront(size_t tile);
+	void	request(size_t tile, const function<void(size_t)>& load, bool countInFlight);
+};
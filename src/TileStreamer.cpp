@@ -0,0 +1,294 @@
+#include "TileStreamer.h"
+#include "MemoryTracker.h"
+
+#include <cstring>
+
+//////////////////////////////////////////////////////////////////////////////////
+TileStreamer::TileStreamer()
+{
+	_tileBytes = 0;
+	_maxQueuedTiles = 0;
+	_cancelled = false;
+
+	_persistent = false;
+	_persistentBuffer = 0;
+	_persistentMapping = NULL;
+	_nextSlot = 0;
+	_uploadedTiles = 0;
+}
+
+TileStreamer::~TileStreamer()
+{
+	release();
+}
+
+void TileStreamer::initialize(size_t tileBytes, size_t ringSlots, size_t maxQueuedTiles)
+{
+	/// same layout as before, keep the ring
+	if (tileBytes == _tileBytes && ringSlots == _ring.size() && maxQueuedTiles == _maxQueuedTiles)
+		return;
+	///
+
+	release();
+
+	_tileBytes = tileBytes;
+	_maxQueuedTiles = maxQueuedTiles < 1 ? 1 : maxQueuedTiles;
+	_persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+	_ring.resize(ringSlots < 2 ? 2 : ringSlots);
+
+	if (_persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glGenBuffers(1, &_persistentBuffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _persistentBuffer);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, _ring.size() * _tileBytes, NULL, flags);
+
+		_persistentMapping = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, _ring.size() * _tileBytes, flags);
+
+		MemoryTracker::getInstance().allocate(MEMORY_UPLOAD_RING, MemoryTracker::getGLOwner(GL_BUFFER, _persistentBuffer), _ring.size() * _tileBytes);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	for (size_t i = 0; i < _ring.size(); i++)
+	{
+		RingSlot& slot = _ring[i];
+
+		slot.fence = NULL;
+
+		if (_persistent)
+		{
+			slot.buffer = _persistentBuffer;
+			slot.offset = i * _tileBytes;
+		}
+		else
+		{
+			glGenBuffers(1, &slot.buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, _tileBytes, NULL, GL_STREAM_DRAW);
+
+			MemoryTracker::getInstance().allocate(MEMORY_UPLOAD_RING, MemoryTracker::getGLOwner(GL_BUFFER, slot.buffer), _tileBytes);
+
+			slot.offset = 0;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	cout << __FUNCTION__ << " upload ring: " << _ring.size() << " slots of " << _tileBytes << " bytes, persistently mapped: " 
+		 << (_persistent ? "yes" : "no") << endl;
+
+	logGLError(__FUNCTION__);
+}
+
+void TileStreamer::release()
+{
+	cancel();
+
+	for (RingSlot& slot : _ring)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+
+		if (!_persistent && slot.buffer)
+		{
+			MemoryTracker::getInstance().releaseOwner(MEMORY_UPLOAD_RING, MemoryTracker::getGLOwner(GL_BUFFER, slot.buffer));
+			glDeleteBuffers(1, &slot.buffer);
+		}
+	}
+
+	if (_persistentBuffer)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _persistentBuffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		MemoryTracker::getInstance().releaseOwner(MEMORY_UPLOAD_RING, MemoryTracker::getGLOwner(GL_BUFFER, _persistentBuffer));
+		glDeleteBuffers(1, &_persistentBuffer);
+	}
+
+	_ring.clear();
+	_persistentBuffer = 0;
+	_persistentMapping = NULL;
+	_nextSlot = 0;
+	_tileBytes = 0;
+
+	reset();
+}
+
+bool TileStreamer::push(size_t tile, const unsigned char* pixels)
+{
+	unique_lock<mutex> guard(_queueLock);
+
+	_queueSpace.wait(guard, [this]() { return _cancelled || _queue.size() < _maxQueuedTiles; });
+
+	if (_cancelled)
+		return false;
+
+	_queue.push_back(PendingTile());
+
+	PendingTile& pending = _queue.back();
+
+	pending.tile = tile;
+
+	if (!_freePixelBuffers.empty())
+	{
+		pending.pixels.swap(_freePixelBuffers.back());
+		_freePixelBuffers.pop_back();
+	}
+
+	pending.pixels.assign(pixels, pixels + _tileBytes);
+
+	MemoryTracker::getInstance().allocate(MEMORY_TILE_UPLOADS, tile, _tileBytes);
+
+	return true;
+}
+
+void TileStreamer::cancel()
+{
+	{
+		lock_guard<mutex> guard(_queueLock);
+
+		_cancelled = true;
+		clearQueue();
+	}
+
+	_queueSpace.notify_all();
+}
+
+void TileStreamer::reset()
+{
+	lock_guard<mutex> guard(_queueLock);
+
+	_cancelled = false;
+	clearQueue();
+	_uploadedTiles = 0;
+}
+
+/// _queueLock held
+///
+void TileStreamer::clearQueue()
+{
+	for (const PendingTile& pending : _queue)
+		MemoryTracker::getInstance().release(MEMORY_TILE_UPLOADS, pending.tile, _tileBytes);
+
+	_queue.clear();
+}
+
+size_t TileStreamer::getQueuedTileCount()
+{
+	lock_guard<mutex> guard(_queueLock);
+
+	return _queue.size();
+}
+
+bool TileStreamer::isSlotFree(RingSlot& slot)
+{
+	if (slot.fence == NULL)
+		return true;
+
+	GLenum status = glClientWaitSync(slot.fence, 0, 0); // poll, never wait
+
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+	{
+		glDeleteSync(slot.fence);
+		slot.fence = NULL;
+
+		return true;
+	}
+
+	return false;
+}
+
+size_t TileStreamer::pump(size_t bytesPerFrame, TileTextureStore& textureStore, GLenum format, GLenum type,
+						  const function<void(size_t, const TileTextureSlot&)>& uploaded)
+{
+	size_t uploadedBytes = 0;
+	size_t uploadedTiles = 0;
+
+	if (_ring.empty())
+		return 0;
+
+	while (uploadedBytes + _tileBytes <= bytesPerFrame || uploadedTiles == 0) // at least one tile per frame
+	{
+		RingSlot& slot = _ring[_nextSlot];
+
+		if (!isSlotFree(slot))
+			break; // gpu is still reading the oldest slot
+
+		{
+			lock_guard<mutex> guard(_queueLock);
+
+			if (_queue.empty())
+				break;
+		}
+
+		/// the texture layer before the pop (only this thread pops), with every layer taken the tile
+		/// waits in the queue until the eviction frees one
+		TileTextureSlot textureSlot = textureStore.allocateLayer();
+
+		if (!textureSlot.isValid())
+			break;
+		///
+
+		PendingTile pending;
+
+		{
+			lock_guard<mutex> guard(_queueLock);
+
+			pending.tile = _queue.front().tile;
+			pending.pixels.swap(_queue.front().pixels);
+			_queue.pop_front();
+		}
+
+		_queueSpace.notify_one();
+
+		MemoryTracker::getInstance().release(MEMORY_TILE_UPLOADS, pending.tile, _tileBytes);
+
+		/// fill the slot
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+
+		if (_persistent)
+			memcpy(_persistentMapping + slot.offset, pending.pixels.data(), _tileBytes);
+		else
+		{
+			void* mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, _tileBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+			if (mapping)
+			{
+				memcpy(mapping, pending.pixels.data(), _tileBytes);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+		}
+		///
+
+		/// texture upload sources the bound pbo, the pixel pointer is an offset into it
+		textureStore.upload(textureSlot, (const void*)slot.offset, format, type);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		///
+
+		uploaded(pending.tile, textureSlot);
+
+		/// keep the pixel vector for the next push
+		{
+			lock_guard<mutex> guard(_queueLock);
+			_freePixelBuffers.push_back(vector<unsigned char>());
+			_freePixelBuffers.back().swap(pending.pixels);
+		}
+		///
+
+		_nextSlot = (_nextSlot + 1) % _ring.size();
+
+		uploadedBytes += _tileBytes;
+		uploadedTiles++;
+		_uploadedTiles++;
+	}
+
+	return uploadedTiles;
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "TileTextureStore.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// streaming tile upload
+///		- producers (any thread) queue tile pixels with push(), the queue is bounded so a fast
+///		  producer waits instead of buffering the whole image
+///		- the gl thread calls pump() once per frame: it copies queued tiles into a ring of pixel
+///		  buffer slots and starts glTexSubImage3D from there, so the copy to the gpu runs async
+///		- every ring slot is fenced, a slot whose upload is still in flight is not reused,
+///		  pump() returns instead of stalling
+///		- at most bytesPerFrame are uploaded per pump()
+///		- the ring is one persistently mapped buffer with ARB_buffer_storage, otherwise one pbo
+///		  per slot mapped per upload
+///
+class TileStreamer
+{
+public:
+	TileStreamer();
+	~TileStreamer();
+
+	void	initialize(size_t tileBytes, size_t ringSlots, size_t maxQueuedTiles);
+	void	release(); // gl side, call on the gl thread
+
+	/// begin - producer side, any thread
+	bool	push(size_t tile, const unsigned char* pixels); // false if cancelled
+	void	cancel();	// wakes and rejects blocked producers, drops queued tiles
+	void	reset();	// accept tiles again after cancel()
+	/// end - producer side, any thread
+
+	/// uploaded(tile, slot) is called for every tile whose upload was started
+	size_t	pump(size_t bytesPerFrame, TileTextureStore& textureStore, GLenum format, GLenum type,
+				 const function<void(size_t, const TileTextureSlot&)>& uploaded);
+
+	/// begin - getters / accessors
+	size_t	getQueuedTileCount();
+	size_t	getUploadedTileCount() { return _uploadedTiles; };
+	bool	isPersistentlyMapped() { return _persistent; };
+	/// end - getters / accessors
+
+protected:
+	struct PendingTile
+	{
+		size_t					tile;
+		vector<unsigned char>	pixels;
+	};
+
+	struct RingSlot
+	{
+		GLuint		buffer;	// own pbo, or the shared one when persistent
+		size_t		offset;	// into buffer
+		GLsync		fence;
+	};
+
+	size_t				_tileBytes;
+	size_t				_maxQueuedTiles;
+
+	/// begin - producer / consumer queue
+	mutex				_queueLock;
+	condition_variable	_queueSpace;
+	deque<PendingTile>	_queue;
+	vector<vector<unsigned char> > _freePixelBuffers; // recycled pixel vectors
+	bool				_cancelled;
+	/// end - producer / consumer queue
+
+	/// begin - gl side
+	bool				_persistent;
+	GLuint				_persistentBuffer;
+	unsigned char*		_persistentMapping;
+	vector<RingSlot>	_ring;
+	size_t				_nextSlot;
+	size_t				_uploadedTiles;
+	/// end - gl side
+
+	bool	isSlotFree(RingSlot& slot);
+	void	clearQueue();
+};
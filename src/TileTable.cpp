@@ -0,0 +1,371 @@
+#include "TileTable.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+
+/// x86 with gcc / clang: both extents loops are compiled in, each for its own target, and the
+/// wider one the cpu has is picked at run time (as in PixelKernels); elsewhere only the loop the
+/// compiler flags enable
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TILE_TABLE_RUNTIME_DISPATCH	1
+#define TILE_TABLE_SSE2				1
+#define TILE_TABLE_AVX2				1
+#define TARGET_SSE2					__attribute__((target("sse2")))
+#define TARGET_AVX2					__attribute__((target("avx2")))
+#include <immintrin.h>
+#else
+#define TILE_TABLE_RUNTIME_DISPATCH	0
+#define TARGET_SSE2
+#define TARGET_AVX2
+#if defined(__AVX2__)
+#define TILE_TABLE_SSE2				1
+#define TILE_TABLE_AVX2				1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define TILE_TABLE_SSE2				1
+#define TILE_TABLE_AVX2				0
+#include <emmintrin.h>
+#else
+#define TILE_TABLE_SSE2				0
+#define TILE_TABLE_AVX2				0
+#endif
+#endif
+///
+
+//////////////////////////////////////////////////////////////////////////////////
+TileArena::TileArena(size_t blockSize)
+{
+	_blockSize = blockSize;
+	_currentBlock = 0;
+	_offset = 0;
+	_reservedBytes = 0;
+}
+
+TileArena::~TileArena()
+{
+	release();
+}
+
+void* TileArena::allocate(size_t bytes, size_t alignment)
+{
+	/// the current block, or the next kept one that is big enough
+	while (_currentBlock < _blocks.size())
+	{
+		ArenaBlock&	block = _blocks[_currentBlock];
+		uintptr_t	address = (uintptr_t)(block.memory + _offset);
+		size_t		padding = (alignment - address % alignment) % alignment;
+
+		if (_offset + padding + bytes <= block.size)
+		{
+			void* memory = block.memory + _offset + padding;
+
+			_offset += padding + bytes;
+
+			return memory;
+		}
+
+		_currentBlock++;
+		_offset = 0;
+	}
+	///
+
+	/// none left, a new block
+	ArenaBlock block;
+
+	block.size = max(_blockSize, bytes + alignment);
+	block.memory = new unsigned char[block.size];
+
+	_blocks.push_back(block);
+	_reservedBytes += block.size;
+	///
+
+	return allocate(bytes, alignment);
+}
+
+void TileArena::reset()
+{
+	_currentBlock = 0;
+	_offset = 0;
+}
+
+void TileArena::release()
+{
+	for (ArenaBlock& block : _blocks)
+		delete [] block.memory;
+
+	_blocks.clear();
+	_reservedBytes = 0;
+
+	reset();
+}
+
+size_t TileArena::getUsedBytes()
+{
+	size_t used = _offset;
+
+	for (size_t block = 0; block < _currentBlock && block < _blocks.size(); block++)
+		used += _blocks[block].size;
+
+	return used;
+}
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+/// the vector loops run the whole blocks from tile on and return where they stopped, the next
+/// narrower loop, and the scalar one last, finish the range
+///
+static PixelInstructionSet detectInstructionSet()
+{
+#if TILE_TABLE_RUNTIME_DISPATCH
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return PIXEL_AVX2;
+
+	if (__builtin_cpu_supports("sse2"))
+		return PIXEL_SSE2;
+
+	return PIXEL_SCALAR;
+#elif TILE_TABLE_AVX2
+	return PIXEL_AVX2;
+#elif TILE_TABLE_SSE2
+	return PIXEL_SSE2;
+#else
+	return PIXEL_SCALAR;
+#endif
+}
+
+static PixelInstructionSet& activeInstructionSet()
+{
+	static PixelInstructionSet active = detectInstructionSet();
+
+	return active;
+}
+
+#if TILE_TABLE_AVX2
+TARGET_AVX2 static size_t getExtentsAVX2(float* const* mins, float* const* maxs, size_t tile, size_t end, glm::vec3& ll, glm::vec3& ur)
+{
+	if (tile + 8 > end)
+		return tile;
+
+	__m256 lo[3], hi[3];
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		lo[axis] = _mm256_set1_ps(ll[(int)axis]);
+		hi[axis] = _mm256_set1_ps(ur[(int)axis]);
+	}
+
+	for (; tile + 8 <= end; tile += 8)
+	{
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			lo[axis] = _mm256_min_ps(lo[axis], _mm256_loadu_ps(&mins[axis][tile]));
+			hi[axis] = _mm256_max_ps(hi[axis], _mm256_loadu_ps(&maxs[axis][tile]));
+		}
+	}
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		alignas(32) float lanesLo[8], lanesHi[8];
+
+		_mm256_store_ps(lanesLo, lo[axis]);
+		_mm256_store_ps(lanesHi, hi[axis]);
+
+		for (size_t lane = 0; lane < 8; lane++)
+		{
+			ll[(int)axis] = min(ll[(int)axis], lanesLo[lane]);
+			ur[(int)axis] = max(ur[(int)axis], lanesHi[lane]);
+		}
+	}
+
+	return tile;
+}
+#endif
+
+#if TILE_TABLE_SSE2
+TARGET_SSE2 static size_t getExtentsSSE2(float* const* mins, float* const* maxs, size_t tile, size_t end, glm::vec3& ll, glm::vec3& ur)
+{
+	if (tile + 4 > end)
+		return tile;
+
+	__m128 lo[3], hi[3];
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		lo[axis] = _mm_set1_ps(ll[(int)axis]);
+		hi[axis] = _mm_set1_ps(ur[(int)axis]);
+	}
+
+	for (; tile + 4 <= end; tile += 4)
+	{
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			lo[axis] = _mm_min_ps(lo[axis], _mm_loadu_ps(&mins[axis][tile]));
+			hi[axis] = _mm_max_ps(hi[axis], _mm_loadu_ps(&maxs[axis][tile]));
+		}
+	}
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		alignas(16) float lanesLo[4], lanesHi[4];
+
+		_mm_store_ps(lanesLo, lo[axis]);
+		_mm_store_ps(lanesHi, hi[axis]);
+
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			ll[(int)axis] = min(ll[(int)axis], lanesLo[lane]);
+			ur[(int)axis] = max(ur[(int)axis], lanesHi[lane]);
+		}
+	}
+
+	return tile;
+}
+#endif
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+TileTable::TileTable()
+{
+	reset();
+}
+
+TileTable::~TileTable()
+{
+}
+
+void TileTable::reserve(size_t capacity)
+{
+	_arena.reset();
+
+	_count = 0;
+	_capacity = (capacity + 7) & ~(size_t)7; // whole blocks of 8 for the kernels
+
+	/// padding boxes are empty, min above max, so no query ever hits them
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		_min[axis] = _arena.allocateArray<float>(_capacity);
+		_max[axis] = _arena.allocateArray<float>(_capacity);
+
+		fill(_min[axis], _min[axis] + _capacity,  FLT_MAX);
+		fill(_max[axis], _max[axis] + _capacity, -FLT_MAX);
+	}
+	///
+
+	_pages  = _arena.allocateArray<GLuint>(_capacity);
+	_layers = _arena.allocateArray<GLuint>(_capacity);
+	_levels = _arena.allocateArray<unsigned char>(_capacity);
+	_flags  = _arena.allocateArray<unsigned char>(_capacity);
+
+	fill(_pages,  _pages  + _capacity, TileTextureSlot::INVALID);
+	fill(_layers, _layers + _capacity, TileTextureSlot::INVALID);
+	memset(_levels, 0, _capacity);
+	memset(_flags,  0, _capacity);
+}
+
+size_t TileTable::add(const glm::vec3& ll, const glm::vec3& ur, size_t level, unsigned char flags)
+{
+	if (_count == _capacity)
+	{
+		cout << __FUNCTION__ << "Error, tile table full at " << _capacity << " tiles" << endl;
+		return (size_t)-1;
+	}
+
+	size_t tile = _count++;
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		_min[axis][tile] = min(ll[(int)axis], ur[(int)axis]);
+		_max[axis][tile] = max(ll[(int)axis], ur[(int)axis]);
+	}
+
+	_levels[tile] = (unsigned char)level;
+	_flags[tile] = flags;
+
+	return tile;
+}
+
+void TileTable::reset()
+{
+	_arena.reset();
+
+	_count = 0;
+	_capacity = 0;
+
+	for (size_t axis = 0; axis < 3; axis++)
+		_min[axis] = _max[axis] = NULL;
+
+	_pages = _layers = NULL;
+	_levels = _flags = NULL;
+}
+
+void TileTable::release()
+{
+	reset();
+
+	_arena.release();
+}
+
+void TileTable::setTexture(size_t tile, const TileTextureSlot& slot)
+{
+	_pages[tile] = slot.page;
+	_layers[tile] = slot.layer;
+
+	if (slot.isValid())
+		_flags[tile] |= TILE_FLAG_TEXTURED;
+	else
+		_flags[tile] &= ~TILE_FLAG_TEXTURED;
+}
+
+void TileTable::getExtents(size_t begin, size_t end, glm::vec3& ll, glm::vec3& ur) const
+{
+	end = min(end, _count);
+
+	PixelInstructionSet	instructionSet = activeInstructionSet();
+	size_t				tile = begin;
+
+#if TILE_TABLE_AVX2
+	if (instructionSet >= PIXEL_AVX2)
+		tile = getExtentsAVX2(_min, _max, tile, end, ll, ur);
+#endif
+
+#if TILE_TABLE_SSE2
+	if (instructionSet >= PIXEL_SSE2)
+		tile = getExtentsSSE2(_min, _max, tile, end, ll, ur);
+#endif
+
+	/// the tail, or all of it without simd
+	for (; tile < end; tile++)
+	{
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			ll[(int)axis] = min(ll[(int)axis], _min[axis][tile]);
+			ur[(int)axis] = max(ur[(int)axis], _max[axis][tile]);
+		}
+	}
+	///
+
+	(void)instructionSet;
+}
+
+const char* TileTable::getInstructionSet()
+{
+	return PixelKernels::getInstructionSetName(activeInstructionSet());
+}
+
+PixelInstructionSet TileTable::getSupportedInstructionSet()
+{
+	return detectInstructionSet();
+}
+
+void TileTable::limitInstructionSet(PixelInstructionSet instructionSet)
+{
+	PixelInstructionSet supported = detectInstructionSet();
+
+	activeInstructionSet() = instructionSet < supported ? instructionSet : supported;
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "PixelKernels.h"
+#include "TileTextureStore.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// bump allocator
+///		- memory comes in blocks of at least blockSize bytes, allocate() takes from the current
+///		  block and moves on to the next (or a new) one when it does not fit
+///		- reset() only rewinds, the blocks are kept for the next round; release() frees them
+///		- no destructors are run, plain data only
+///
+class TileArena
+{
+public:
+	TileArena(size_t blockSize = 1 << 20);
+	~TileArena();
+
+	void*	allocate(size_t bytes, size_t alignment = 32);
+	void	reset();
+	void	release();
+
+	template <class T>
+	T*		allocateArray(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T) > 32 ? alignof(T) : 32)); };
+
+	/// begin - getters / accessors
+	size_t	getReservedBytes() { return _reservedBytes; };
+	size_t	getUsedBytes();
+	/// end - getters / accessors
+
+protected:
+	struct ArenaBlock
+	{
+		unsigned char*	memory;
+		size_t			size;
+	};
+
+	vector<ArenaBlock>	_blocks;
+	size_t				_blockSize;
+	size_t				_currentBlock;
+	size_t				_offset;		// into the current block
+	size_t				_reservedBytes;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// state of a tile in the TileTable
+///
+enum TileFlags
+{
+	TILE_FLAG_BASE		= 1,	// level 0, full resolution
+	TILE_FLAG_PARTIAL	= 2,	// hangs over the edge of the grid, texCoordScale < 1
+	TILE_FLAG_TEXTURED	= 4		// has a texture array layer
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// all tiles of a scene in one structure of arrays
+///		- min / max extents per axis, texture page / layer, level and flags, each a contiguous
+///		  array carved out of one arena; reset() is O(1), whatever the tile count
+///		- getExtents() runs over the extent arrays 8 (avx2) or 4 (sse2) tiles at a time, the path
+///		  picked at run time as in PixelKernels, tails go scalar; the results are the same on
+///		  every path (the frustum culling is the pyramid's, hierarchical, see TilePyramid::select())
+///		- the arrays are padded to a multiple of 8 with empty boxes (min > max), they never hit
+///		- tile index is the index of the pyramid node it was added for
+///
+class TileTable
+{
+public:
+	TileTable();
+	~TileTable();
+
+	void	reserve(size_t capacity); // drops the tiles, the arrays hold capacity tiles from now on
+	size_t	add(const glm::vec3& ll, const glm::vec3& ur, size_t level, unsigned char flags);
+	void	reset();	// O(1), keeps the arena blocks
+	void	release();	// frees the arena
+
+	void	setTexture(size_t tile, const TileTextureSlot& slot);
+	TileTextureSlot	getTexture(size_t tile) const { return TileTextureSlot(_pages[tile], _layers[tile]); };
+
+	/// union of the boxes of tiles [begin, end), ll / ur are grown, not overwritten
+	void	getExtents(size_t begin, size_t end, glm::vec3& ll, glm::vec3& ur) const;
+
+	/// the path of getExtents() in use, as PixelKernels::getInstructionSet(); the limit is for
+	/// checking the narrower paths, not thread safe
+	static const char*			getInstructionSet();
+	static PixelInstructionSet	getSupportedInstructionSet();
+	static void					limitInstructionSet(PixelInstructionSet instructionSet);
+
+	/// begin - getters / accessors
+	size_t	getCount() const { return _count; };
+	size_t	getCapacity() const { return _capacity; };
+	unsigned char	getFlags(size_t tile) const { return _flags[tile]; };
+	size_t	getLevel(size_t tile) const { return _levels[tile]; };
+	glm::vec3	getLL(size_t tile) const { return glm::vec3(_min[0][tile], _min[1][tile], _min[2][tile]); };
+	glm::vec3	getUR(size_t tile) const { return glm::vec3(_max[0][tile], _max[1][tile], _max[2][tile]); };
+	size_t	getReservedBytes() { return _arena.getReservedBytes(); };
+	/// end - getters / accessors
+
+protected:
+	TileArena		_arena;
+
+	size_t			_count;
+	size_t			_capacity;
+
+	float*			_min[3];	// x, y, z
+	float*			_max[3];
+	GLuint*			_pages;
+	GLuint*			_layers;
+	unsigned char*	_levels;
+	unsigned char*	_flags;
+};
@@ -0,0 +1,219 @@
+#include "TileTextureStore.h"
+#include "MemoryTracker.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+TileTextureStore::TileTextureStore()
+{
+	_layerSize = 0;
+	_layersPerPage = 0;
+	_internalFormat = GL_RGB8;
+	_compression = TILE_COMPRESSION_NONE;
+	_layerBytes = 0;
+	_maxPages = 0;
+	_nextLayer = 0;
+	_usedLayers = 0;
+	_anisotropy = 1.0f;
+}
+
+TileTextureStore::~TileTextureStore()
+{
+	release();
+}
+
+void TileTextureStore::initialize(size_t layerSize, GLenum internalFormat, size_t layersPerPage)
+{
+	/// same layout as before, keep the pages and their layers
+	if (layerSize == _layerSize && internalFormat == _internalFormat && !_pages.empty())
+		return;
+	///
+
+	release();
+
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	_layerSize = layerSize;
+	_internalFormat = internalFormat;
+	_compression = TILE_COMPRESSION_NONE;
+
+	if (internalFormat == getInternalFormat(TILE_COMPRESSION_BC1))
+		_compression = TILE_COMPRESSION_BC1;
+	else if (internalFormat == getInternalFormat(TILE_COMPRESSION_BC7))
+		_compression = TILE_COMPRESSION_BC7;
+
+	_layerBytes = _compression != TILE_COMPRESSION_NONE ? BlockCompressor::getCompressedSize(layerSize, layerSize, _compression) : layerSize * layerSize * 3;
+	_layersPerPage = layersPerPage > (size_t)maxLayers ? (size_t)maxLayers : layersPerPage;
+
+	if (_layersPerPage == 0)
+		_layersPerPage = 1;
+
+	cout << __FUNCTION__ << " layer size: " << _layerSize << " layers per page: " << _layersPerPage 
+		 << " compression: " << BlockCompressor::getName(_compression) << endl;
+}
+
+void TileTextureStore::initialize(size_t layerSize, TileCompression compression, size_t layersPerPage)
+{
+	initialize(layerSize, getInternalFormat(isCompressionSupported(compression) ? compression : TILE_COMPRESSION_NONE), layersPerPage);
+}
+
+bool TileTextureStore::keepsLayout(size_t layerSize, TileCompression compression)
+{
+	GLenum internalFormat = getInternalFormat(isCompressionSupported(compression) ? compression : TILE_COMPRESSION_NONE);
+
+	return layerSize == _layerSize && internalFormat == _internalFormat && !_pages.empty();
+}
+
+bool TileTextureStore::isCompressionSupported(TileCompression compression)
+{
+	switch (compression)
+	{
+		case TILE_COMPRESSION_NONE:	return true;
+		case TILE_COMPRESSION_BC1:	return GLEW_EXT_texture_compression_s3tc != 0;
+		case TILE_COMPRESSION_BC7:	return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+		default:					return false;
+	}
+}
+
+GLenum TileTextureStore::getInternalFormat(TileCompression compression)
+{
+	switch (compression)
+	{
+		case TILE_COMPRESSION_BC1:	return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case TILE_COMPRESSION_BC7:	return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		default:					return GL_RGB8;
+	}
+}
+
+void TileTextureStore::release()
+{
+	for (GLuint page : _pages)
+		MemoryTracker::getInstance().releaseOwner(MEMORY_TILE_TEXTURES, MemoryTracker::getGLOwner(GL_TEXTURE, page));
+
+	if (!_pages.empty())
+		glDeleteTextures((GLsizei)_pages.size(), _pages.data());
+
+	_pages.clear();
+	_freeSlots.clear();
+	_nextLayer = 0;
+	_usedLayers = 0;
+}
+
+void TileTextureStore::createPage()
+{
+	GLuint texId = 0;
+
+	glGenTextures(1, &texId);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texId);
+
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, _internalFormat, (GLsizei)_layerSize, (GLsizei)_layerSize, (GLsizei)_layersPerPage);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	/// a layer is one whole tile without a border, the edge texel stands in for the neighbour's
+	/// (the seam limitation, see TilePyramidNode)
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	///
+
+	if (GLEW_EXT_texture_filter_anisotropic)
+		glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, _anisotropy);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	_pages.push_back(texId);
+	_nextLayer = 0;
+
+	MemoryTracker::getInstance().allocate(MEMORY_TILE_TEXTURES, MemoryTracker::getGLOwner(GL_TEXTURE, texId), _layerBytes * _layersPerPage);
+
+	cout << __FUNCTION__ << " texture array page " << _pages.size() - 1 << " created" << endl;
+
+	logGLError(__FUNCTION__);
+}
+
+void TileTextureStore::setAnisotropy(float anisotropy)
+{
+	GLfloat maxAnisotropy = 1.0f;
+
+	if (GLEW_EXT_texture_filter_anisotropic)
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+
+	anisotropy = anisotropy < 1.0f ? 1.0f : (anisotropy > maxAnisotropy ? maxAnisotropy : anisotropy);
+
+	if (anisotropy == _anisotropy)
+		return;
+
+	_anisotropy = anisotropy;
+
+	for (GLuint page : _pages)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, page);
+		glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, _anisotropy);
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	logGLError(__FUNCTION__);
+}
+
+TileTextureSlot TileTextureStore::allocateLayer()
+{
+	TileTextureSlot slot;
+
+	if (!_freeSlots.empty())
+	{
+		slot = _freeSlots.back();
+		_freeSlots.pop_back();
+	}
+	else
+	{
+		if (_pages.empty() || _nextLayer >= _layersPerPage)
+		{
+			if (_maxPages > 0 && _pages.size() >= _maxPages)
+				return slot;
+
+			createPage();
+		}
+
+		slot = TileTextureSlot((GLuint)_pages.size() - 1, _nextLayer++);
+	}
+
+	_usedLayers++;
+
+	return slot;
+}
+
+void TileTextureStore::releaseLayer(const TileTextureSlot& slot)
+{
+	if (!slot.isValid() || slot.page >= _pages.size())
+		return;
+
+	_freeSlots.push_back(slot);
+	_usedLayers--;
+}
+
+void TileTextureStore::upload(const TileTextureSlot& slot, const void* pixels, GLenum format, GLenum type)
+{
+	if (!slot.isValid() || slot.page >= _pages.size())
+		return;
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _pages[slot.page]);
+
+	if (_compression != TILE_COMPRESSION_NONE)
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)slot.layer, (GLsizei)_layerSize, (GLsizei)_layerSize, 1, 
+								  _internalFormat, (GLsizei)_layerBytes, pixels);
+	else
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rgb rows are not 4 byte aligned in general
+
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)slot.layer, (GLsizei)_layerSize, (GLsizei)_layerSize, 1, format, type, pixels);
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TileTextureStore::bindPage(GLuint page, GLenum textureUnit)
+{
+	glActiveTexture(textureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, page < _pages.size() ? _pages[page] : 0);
+}
+//////////////////////////////////////////////////////////////////////////////////
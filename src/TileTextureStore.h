@@ -0,0 +1,93 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "BlockCompressor.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// address of one tile texture inside the store
+///
+struct TileTextureSlot
+{
+	GLuint	page;	// index of the texture array
+	GLuint	layer;	// layer inside that array
+
+	TileTextureSlot() : page(INVALID), layer(INVALID) {};
+	TileTextureSlot(GLuint p, GLuint l) : page(p), layer(l) {};
+
+	bool	isValid() const { return page != INVALID; };
+
+	static const GLuint INVALID = 0xffffffff;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// tile texture store
+///		- tiles live in GL_TEXTURE_2D_ARRAY pages, every layer is layerSize x layerSize texels
+///		- a new page is created when all layers of the existing pages are taken, up to the
+///		  setMaxPages() limit; allocateLayer() returns an invalid slot once that is reached
+///		- released layers go on a free list and are handed out again before a new page is created
+///		- pages survive releaseLayer(), they are only deleted by release()
+///		- layers may be block compressed (bc1 / bc7), upload() then takes the compressed blocks
+///
+class TileTextureStore
+{
+public:
+	TileTextureStore();
+	~TileTextureStore();
+
+	void	initialize(size_t layerSize, GLenum internalFormat = GL_RGB8, size_t layersPerPage = 256);
+	void	initialize(size_t layerSize, TileCompression compression, size_t layersPerPage = 256);
+	void	release();
+
+	/// initialize() with these keeps the pages and the layers handed out
+	bool	keepsLayout(size_t layerSize, TileCompression compression);
+
+	/// 0: no limit (the default); initialize() keeps the limit
+	void			setMaxPages(size_t maxPages) { _maxPages = maxPages; };
+
+	TileTextureSlot	allocateLayer(); // invalid when every layer of maxPages pages is taken
+	void			releaseLayer(const TileTextureSlot& slot);
+
+	/// pixels: layerSize x layerSize, tightly packed, format/type as for glTexSubImage3D
+	///		- compressed layers take getLayerBytes() of blocks instead, format/type are ignored
+	///		- with a GL_PIXEL_UNPACK_BUFFER bound, pixels is an offset into that buffer
+	void	upload(const TileTextureSlot& slot, const void* pixels, GLenum format = GL_RGB, GLenum type = GL_UNSIGNED_BYTE);
+
+	void	bindPage(GLuint page, GLenum textureUnit = GL_TEXTURE0);
+
+	/// max anisotropy of the filtering, of the existing pages and the ones created later; clamped
+	/// to what the driver allows, 1 (plain bilinear) without EXT_texture_filter_anisotropic
+	void	setAnisotropy(float anisotropy);
+
+	/// the driver can sample it (and take it for glCompressedTexSubImage3D)
+	static bool		isCompressionSupported(TileCompression compression);
+	static GLenum	getInternalFormat(TileCompression compression);
+
+	/// begin - getters / accessors
+	size_t	getLayerSize() { return _layerSize; };
+	size_t	getLayerBytes() { return _layerBytes; };
+	TileCompression getCompression() { return _compression; };
+	size_t	getLayersPerPage() { return _layersPerPage; };
+	size_t	getPageCount() { return _pages.size(); };
+	size_t	getUsedLayerCount() { return _usedLayers; };
+	float	getAnisotropy() { return _anisotropy; };
+	/// end - getters / accessors
+
+protected:
+	size_t				_layerSize;
+	size_t				_layersPerPage;
+	GLenum				_internalFormat;
+	TileCompression		_compression;
+	size_t				_layerBytes;	// of one uploaded layer
+
+	vector<GLuint>		_pages;			// texture array ids
+	size_t				_maxPages;
+	GLuint				_nextLayer;		// next never used layer of the last page
+	vector<TileTextureSlot>	_freeSlots;	// recycled layers
+	size_t				_usedLayers;
+	float				_anisotropy;
+
+	void	createPage();
+};
@@ -0,0 +1,220 @@
+#include "TiledTiffWriter.h"
+
+#include <cstring>
+
+//////////////////////////////////////////////////////////////////////////////////
+/// BigTIFF, little endian
+///
+static const size_t		TIFF_HEADER_BYTES = 16;
+static const size_t		TIFF_ENTRY_BYTES = 20;
+
+static const uint16_t	TIFF_SHORT = 3;
+static const uint16_t	TIFF_LONG = 4;
+static const uint16_t	TIFF_LONG8 = 16;
+
+/// one IFD entry; values of up to 8 bytes are stored in it, larger ones at valueOrOffset
+///
+static void appendTiffEntry(vector<unsigned char>& ifd, uint16_t tag, uint16_t type, uint64_t count, uint64_t valueOrOffset)
+{
+	unsigned char entry[TIFF_ENTRY_BYTES];
+
+	memcpy(entry + 0, &tag, 2);
+	memcpy(entry + 2, &type, 2);
+	memcpy(entry + 4, &count, 8);
+	memcpy(entry + 12, &valueOrOffset, 8);
+
+	ifd.insert(ifd.end(), entry, entry + TIFF_ENTRY_BYTES);
+}
+///
+
+//////////////////////////////////////////////////////////////////////////////////
+TiledTiffWriter::TiledTiffWriter()
+{
+	_file = NULL;
+	_width = _height = 0;
+	_tileSize = 0;
+	_tilesAcross = _tilesDown = 0;
+	_rowsWritten = 0;
+	_writeOffset = 0;
+}
+
+TiledTiffWriter::~TiledTiffWriter()
+{
+	if (_file)
+		abort();
+}
+
+bool TiledTiffWriter::create(const string& filename, size_t width, size_t height, size_t tileSize)
+{
+	if (width == 0 || height == 0 || tileSize == 0 || tileSize % 16 != 0)
+	{
+		cout << __FUNCTION__ << "Error, " << width << " x " << height << " in " << tileSize << " tiles can not be written" << endl;
+		return false;
+	}
+
+	_filename = filename;
+	_width = width;
+	_height = height;
+	_tileSize = tileSize;
+	_tilesAcross = (width + tileSize - 1) / tileSize;
+	_tilesDown = (height + tileSize - 1) / tileSize;
+	_rowsWritten = 0;
+
+	_tileOffsets.assign(_tilesAcross * _tilesDown, 0);
+	_tile.assign(tileSize * tileSize * 3, 0);
+
+	_file = fopen(filename.c_str(), "wb");
+
+	if (_file == NULL)
+	{
+		cout << __FUNCTION__ << "Error, can not create " << filename << endl;
+		return false;
+	}
+
+	/// header without an IFD yet, finish() fills in its offset
+	const unsigned char header[TIFF_HEADER_BYTES] = { 'I', 'I', 43, 0, 8, 0, 0, 0 };
+
+	if (fwrite(header, 1, TIFF_HEADER_BYTES, _file) != TIFF_HEADER_BYTES)
+	{
+		abort();
+		return false;
+	}
+	///
+
+	_writeOffset = TIFF_HEADER_BYTES;
+
+	return true;
+}
+
+bool TiledTiffWriter::writeRows(const unsigned char* rows, size_t rowCount)
+{
+	if (_file == NULL)
+		return false;
+
+	if (_rowsWritten + rowCount > _height || (rowCount % _tileSize != 0 && _rowsWritten + rowCount != _height))
+	{
+		cout << __FUNCTION__ << "Error, " << rowCount << " rows at row " << _rowsWritten << " do not fit the tiles of " << _filename << endl;
+		return false;
+	}
+
+	size_t pitch = _width * 3;
+	size_t tilePitch = _tileSize * 3;
+
+	for (size_t bandRow = 0; bandRow < rowCount; bandRow += _tileSize)
+	{
+		size_t tileRow = (_rowsWritten + bandRow) / _tileSize;
+		size_t tileRows = min(_tileSize, rowCount - bandRow);
+
+		for (size_t tileCol = 0; tileCol < _tilesAcross; tileCol++)
+		{
+			size_t x = tileCol * _tileSize;
+			size_t tileColumns = min(_tileSize, _width - x);
+
+			/// edge tiles keep black padding, only the image part is copied
+			if (tileRows < _tileSize || tileColumns < _tileSize)
+				fill(_tile.begin(), _tile.end(), (unsigned char)0);
+
+			for (size_t y = 0; y < tileRows; y++)
+				memcpy(&_tile[y * tilePitch], rows + (bandRow + y) * pitch + x * 3, tileColumns * 3);
+			///
+
+			if (fwrite(_tile.data(), 1, _tile.size(), _file) != _tile.size())
+			{
+				cout << __FUNCTION__ << "Error, writing " << _filename << " failed" << endl;
+				return false;
+			}
+
+			_tileOffsets[tileRow * _tilesAcross + tileCol] = _writeOffset;
+			_writeOffset += _tile.size();
+		}
+	}
+
+	_rowsWritten += rowCount;
+
+	return true;
+}
+
+bool TiledTiffWriter::finish()
+{
+	if (_file == NULL)
+		return false;
+
+	if (_rowsWritten != _height)
+	{
+		cout << __FUNCTION__ << "Error, " << _rowsWritten << " of " << _height << " rows written, " << _filename << " not finished" << endl;
+
+		abort();
+		return false;
+	}
+
+	/// offset and byte count arrays, stored in the entry itself when there is one tile only
+	size_t		tileCount = _tileOffsets.size();
+	uint64_t	offsetsAt = _writeOffset;
+	uint64_t	countsAt = offsetsAt + tileCount * sizeof(uint64_t);
+	uint64_t	ifdAt = tileCount > 1 ? countsAt + tileCount * sizeof(uint64_t) : _writeOffset;
+
+	vector<uint64_t> byteCounts(tileCount, (uint64_t)_tile.size());
+	///
+
+	/// the IFD, tags in ascending order
+	vector<unsigned char>	ifd;
+	uint64_t				entryCount = 11;
+	uint64_t				bitsPerSample = 8 | (8 << 16) | ((uint64_t)8 << 32); // 3 shorts
+	uint64_t				noNextIfd = 0;
+
+	ifd.insert(ifd.end(), (const unsigned char*)&entryCount, (const unsigned char*)&entryCount + 8);
+
+	appendTiffEntry(ifd, 256, TIFF_LONG, 1, _width);			// ImageWidth
+	appendTiffEntry(ifd, 257, TIFF_LONG, 1, _height);			// ImageLength
+	appendTiffEntry(ifd, 258, TIFF_SHORT, 3, bitsPerSample);	// BitsPerSample
+	appendTiffEntry(ifd, 259, TIFF_SHORT, 1, 1);				// Compression: none
+	appendTiffEntry(ifd, 262, TIFF_SHORT, 1, 2);				// PhotometricInterpretation: rgb
+	appendTiffEntry(ifd, 277, TIFF_SHORT, 1, 3);				// SamplesPerPixel
+	appendTiffEntry(ifd, 284, TIFF_SHORT, 1, 1);				// PlanarConfiguration: interleaved
+	appendTiffEntry(ifd, 322, TIFF_LONG, 1, _tileSize);			// TileWidth
+	appendTiffEntry(ifd, 323, TIFF_LONG, 1, _tileSize);			// TileLength
+	appendTiffEntry(ifd, 324, TIFF_LONG8, tileCount, tileCount > 1 ? offsetsAt : _tileOffsets[0]);	// TileOffsets
+	appendTiffEntry(ifd, 325, TIFF_LONG8, tileCount, tileCount > 1 ? countsAt : byteCounts[0]);		// TileByteCounts
+
+	ifd.insert(ifd.end(), (const unsigned char*)&noNextIfd, (const unsigned char*)&noNextIfd + 8);
+	///
+
+	bool written = true;
+
+	if (tileCount > 1)
+	{
+		written = fwrite(_tileOffsets.data(), sizeof(uint64_t), tileCount, _file) == tileCount &&
+				  fwrite(byteCounts.data(), sizeof(uint64_t), tileCount, _file) == tileCount;
+	}
+
+	written = written && fwrite(ifd.data(), 1, ifd.size(), _file) == ifd.size() &&
+			  fseek(_file, 8, SEEK_SET) == 0 &&
+			  fwrite(&ifdAt, sizeof(ifdAt), 1, _file) == 1;
+
+	written = (fclose(_file) == 0) && written;
+	_file = NULL;
+
+	if (!written)
+	{
+		cout << __FUNCTION__ << "Error, writing " << _filename << " failed" << endl;
+
+		remove(_filename.c_str());
+		return false;
+	}
+
+	cout << __FUNCTION__ << " wrote " << _filename << " " << _width << " x " << _height << " in " << tileCount << " tiles ("
+		 << (ifdAt + ifd.size()) / (1024 * 1024) << " MB)" << endl;
+
+	return true;
+}
+
+void TiledTiffWriter::abort()
+{
+	if (_file)
+		fclose(_file);
+
+	_file = NULL;
+
+	remove(_filename.c_str());
+}
+//////////////////////////////////////////////////////////////////////////////////
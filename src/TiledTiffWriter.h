@@ -0,0 +1,53 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+
+#include <cstdint>
+#include <cstdio>
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// streams an rgb image of any size into a tiled BigTIFF, rows top down
+///		- uncompressed 8 bit rgb, tileSize x tileSize tiles (a multiple of 16); the tiles of the
+///		  right and bottom edge are padded with black
+///		- writeRows() takes the next band of image rows; a band is cut into tiles and written
+///		  right away, so nothing but one tile is buffered
+///		- layout: header, tile payloads in row major tile order, tile offset / byte count arrays,
+///		  the one IFD; the header is patched last, a file whose export did not finish has no IFD
+///		- BigTIFF (64 bit offsets) always, a 32k x 32k export is past what classic TIFF addresses
+///
+class TiledTiffWriter
+{
+public:
+	TiledTiffWriter();
+	~TiledTiffWriter();
+
+	bool	create(const string& filename, size_t width, size_t height, size_t tileSize = 256);
+
+	/// rows: rowCount x width pixels, tightly packed, continuing where the last call ended;
+	/// rowCount is a multiple of the tile size but for the last band of the image
+	bool	writeRows(const unsigned char* rows, size_t rowCount);
+
+	bool	finish(); // offsets and IFD; the file is valid after this only
+	void	abort(); // removes the partial file
+
+	/// begin - getters / accessors
+	size_t	getWidth() { return _width; };
+	size_t	getHeight() { return _height; };
+	size_t	getTileSize() { return _tileSize; };
+	size_t	getRowsWritten() { return _rowsWritten; };
+	/// end - getters / accessors
+
+protected:
+	FILE*					_file;
+	string					_filename;
+	size_t					_width, _height;
+	size_t					_tileSize;
+	size_t					_tilesAcross, _tilesDown;
+	size_t					_rowsWritten;
+	vector<uint64_t>		_tileOffsets;	// row major
+	vector<unsigned char>	_tile;			// one padded tile
+	uint64_t				_writeOffset;
+};
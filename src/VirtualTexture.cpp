@@ -0,0 +1,364 @@
+#include "VirtualTexture.h"
+#include "MemoryTracker.h"
+
+//////////////////////////////////////////////////////////////////////////////////
+VirtualTexture::VirtualTexture()
+{
+	_pyramid = NULL;
+	_feedbackScale = 8;
+	_pageTableDirty = false;
+
+	_pageTable = 0;
+	_pageTableHeight = 0;
+
+	_vao = 0;
+	_vertexBuffer = 0;
+
+	_feedbackFramebuffer = 0;
+	_feedbackColor = _feedbackDepth = 0;
+	_feedbackWidth = _feedbackHeight = 0;
+	_feedbackBuffer = 0;
+	_feedbackFence = 0;
+	_readbackWidth = _readbackHeight = 0;
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	release();
+}
+
+void VirtualTexture::initialize(TilePyramid& pyramid, size_t feedbackScale)
+{
+	release();
+
+	_pyramid = &pyramid;
+	_feedbackScale = feedbackScale < 1 ? 1 : feedbackScale;
+
+	size_t nodeCount = pyramid.getNodeCount();
+
+	if (nodeCount == 0)
+		return;
+
+	_layers.assign(nodeCount, (GLuint)NO_PAGE);
+	_entries.assign(nodeCount, (GLuint)NO_PAGE);
+	_feedbackSeen.assign(nodeCount, 0);
+
+	/// page table, one texel per node
+	_pageTableHeight = (GLsizei)((nodeCount + PAGE_TABLE_WIDTH - 1) / PAGE_TABLE_WIDTH);
+
+	_entries.resize(PAGE_TABLE_WIDTH * _pageTableHeight, (GLuint)NO_PAGE); // the tail of the last row too
+
+	glGenTextures(1, &_pageTable);
+	glBindTexture(GL_TEXTURE_2D, _pageTable);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, (GLsizei)PAGE_TABLE_WIDTH, _pageTableHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	MemoryTracker::getInstance().allocate(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_TEXTURE, _pageTable), _entries.size() * sizeof(GLuint));
+
+	_pageTableDirty = true;
+	///
+
+	/// one quad over the level 0 grid, tex coords in level 0 tiles
+	const TilePyramidNode& root = pyramid.getNode(pyramid.getRootNode());
+
+	GLfloat rows = (GLfloat)pyramid.getLevelRows(0);
+	GLfloat cols = (GLfloat)pyramid.getLevelCols(0);
+
+	GLfloat vertices[] =
+	{
+		root.ll.x, root.ll.y, 0.0f,		0.0f, 0.0f,
+		root.ur.x, root.ll.y, 0.0f,		rows, 0.0f,
+		root.ll.x, root.ur.y, 0.0f,		0.0f, cols,
+		root.ur.x, root.ur.y, 0.0f,		rows, cols,
+	};
+
+	glGenVertexArrays(1, &_vao);
+	glBindVertexArray(_vao);
+
+	glGenBuffers(1, &_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	MemoryTracker::getInstance().allocate(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_BUFFER, _vertexBuffer), sizeof(vertices));
+
+	glEnableVertexAttribArray(0); // position
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)0);
+
+	glEnableVertexAttribArray(1); // tex coord, level 0 tiles
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	///
+
+	glGenBuffers(1, &_feedbackBuffer);
+
+	logGLError(__FUNCTION__);
+
+	cout << __FUNCTION__ << " page table: " << nodeCount << " nodes, " << PAGE_TABLE_WIDTH << " x " << _pageTableHeight << endl;
+}
+
+void VirtualTexture::release()
+{
+	releaseFeedbackTarget();
+
+	if (_feedbackFence)
+		glDeleteSync(_feedbackFence);
+
+	MemoryTracker& tracker = MemoryTracker::getInstance();
+
+	if (_feedbackBuffer)
+	{
+		tracker.releaseOwner(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_BUFFER, _feedbackBuffer));
+		glDeleteBuffers(1, &_feedbackBuffer);
+	}
+
+	if (_pageTable)
+	{
+		tracker.releaseOwner(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_TEXTURE, _pageTable));
+		glDeleteTextures(1, &_pageTable);
+	}
+
+	if (_vertexBuffer)
+	{
+		tracker.releaseOwner(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_BUFFER, _vertexBuffer));
+		glDeleteBuffers(1, &_vertexBuffer);
+	}
+
+	if (_vao)
+		glDeleteVertexArrays(1, &_vao);
+
+	_feedbackFence = 0;
+	_feedbackBuffer = 0;
+	_pageTable = 0;
+	_pageTableHeight = 0;
+	_vertexBuffer = 0;
+	_vao = 0;
+
+	_layers.clear();
+	_entries.clear();
+	_feedbackSeen.clear();
+	_pageTableDirty = false;
+	_pyramid = NULL;
+}
+
+void VirtualTexture::setPage(size_t node, const TileTextureSlot& slot)
+{
+	_layers[node] = slot.isValid() && slot.page == 0 ? slot.layer : (GLuint)NO_PAGE; // render() binds page 0 only
+	_pageTableDirty = true;
+}
+
+void VirtualTexture::clearPage(size_t node)
+{
+	_layers[node] = NO_PAGE;
+	_pageTableDirty = true;
+}
+
+/// the entries are resolved root down: nodes are stored level by level with the root last, so
+/// walking the indices backwards sees every parent before its children
+///
+void VirtualTexture::updatePageTable()
+{
+	if (!_pageTableDirty || _pageTable == 0)
+		return;
+
+	for (size_t node = _layers.size(); node-- > 0; )
+	{
+		const TilePyramidNode& tileNode = _pyramid->getNode(node);
+
+		if (_layers[node] != NO_PAGE)
+			_entries[node] = encodeEntry(_layers[node], tileNode.level);
+		else
+			_entries[node] = tileNode.parent == TilePyramidNode::INVALID_NODE ? (GLuint)NO_PAGE : _entries[tileNode.parent];
+	}
+
+	glBindTexture(GL_TEXTURE_2D, _pageTable);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)PAGE_TABLE_WIDTH, _pageTableHeight, GL_RED_INTEGER, GL_UNSIGNED_INT, _entries.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	_pageTableDirty = false;
+
+	logGLError(__FUNCTION__);
+}
+
+void VirtualTexture::createFeedbackTarget(GLsizei width, GLsizei height)
+{
+	releaseFeedbackTarget();
+
+	glGenTextures(1, &_feedbackColor);
+	glBindTexture(GL_TEXTURE_2D, _feedbackColor);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &_feedbackDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, _feedbackDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	size_t texelBytes = (size_t)width * height * 4; // r32ui, and the 24 bit depth in 4 bytes
+
+	MemoryTracker::getInstance().allocate(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_TEXTURE, _feedbackColor), texelBytes);
+	MemoryTracker::getInstance().allocate(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_RENDERBUFFER, _feedbackDepth), texelBytes);
+
+	glGenFramebuffers(1, &_feedbackFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, _feedbackFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _feedbackColor, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _feedbackDepth);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cout << __FUNCTION__ << "Error, feedback framebuffer incomplete" << endl;
+
+	_feedbackWidth = width;
+	_feedbackHeight = height;
+}
+
+void VirtualTexture::releaseFeedbackTarget()
+{
+	if (_feedbackFramebuffer)
+		glDeleteFramebuffers(1, &_feedbackFramebuffer);
+
+	if (_feedbackColor)
+	{
+		MemoryTracker::getInstance().releaseOwner(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_TEXTURE, _feedbackColor));
+		glDeleteTextures(1, &_feedbackColor);
+	}
+
+	if (_feedbackDepth)
+	{
+		MemoryTracker::getInstance().releaseOwner(MEMORY_VIRTUAL_TEXTURE, MemoryTracker::getGLOwner(GL_RENDERBUFFER, _feedbackDepth));
+		glDeleteRenderbuffers(1, &_feedbackDepth);
+	}
+
+	_feedbackFramebuffer = 0;
+	_feedbackColor = _feedbackDepth = 0;
+	_feedbackWidth = _feedbackHeight = 0;
+}
+
+bool VirtualTexture::renderFeedback(size_t width, size_t height, GLuint drawFramebuffer)
+{
+	if (_vao == 0 || _feedbackFence != 0) // the last readback is still on its way
+		return false;
+
+	GLsizei feedbackWidth  = (GLsizei)max((size_t)1, width / _feedbackScale);
+	GLsizei feedbackHeight = (GLsizei)max((size_t)1, height / _feedbackScale);
+
+	if (feedbackWidth != _feedbackWidth || feedbackHeight != _feedbackHeight)
+		createFeedbackTarget(feedbackWidth, feedbackHeight);
+
+	/// every texel the node it wants, NO_PAGE where the map is not
+	glBindFramebuffer(GL_FRAMEBUFFER, _feedbackFramebuffer);
+	glViewport(0, 0, _feedbackWidth, _feedbackHeight);
+
+	const GLuint	noPage[] = { NO_PAGE, NO_PAGE, NO_PAGE, NO_PAGE };
+	const GLfloat	farDepth = 1.0f;
+
+	glClearBufferuiv(GL_COLOR, 0, noPage);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+	glBindVertexArray(_vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+	///
+
+	/// readback into the pbo, fenced, collected in a later frame
+	size_t bytes = (size_t)_feedbackWidth * _feedbackHeight * sizeof(GLuint);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _feedbackBuffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+
+	MemoryTracker&	tracker = MemoryTracker::getInstance();
+	uint64_t		owner = MemoryTracker::getGLOwner(GL_BUFFER, _feedbackBuffer);
+
+	if (tracker.getBytes(MEMORY_VIRTUAL_TEXTURE, owner) != bytes)
+	{
+		tracker.releaseOwner(MEMORY_VIRTUAL_TEXTURE, owner);
+		tracker.allocate(MEMORY_VIRTUAL_TEXTURE, owner, bytes);
+	}
+
+	glReadPixels(0, 0, _feedbackWidth, _feedbackHeight, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	_feedbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_readbackWidth = _feedbackWidth;
+	_readbackHeight = _feedbackHeight;
+	///
+
+	glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+	glViewport(0, 0, (GLsizei)width, (GLsizei)height);
+
+	logGLError(__FUNCTION__);
+
+	return true;
+}
+
+bool VirtualTexture::collectFeedback(vector<size_t>& nodes)
+{
+	if (_feedbackFence == 0)
+		return false;
+
+	GLenum status = glClientWaitSync(_feedbackFence, 0, 0); // poll, never wait
+
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	glDeleteSync(_feedbackFence);
+	_feedbackFence = 0;
+
+	nodes.clear();
+
+	size_t texels = (size_t)_readbackWidth * _readbackHeight;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _feedbackBuffer);
+
+	const GLuint* feedback = (const GLuint*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, texels * sizeof(GLuint), GL_MAP_READ_BIT);
+
+	if (feedback)
+	{
+		/// distinct nodes, in the order first seen
+		for (size_t texel = 0; texel < texels; texel++)
+		{
+			GLuint node = feedback[texel];
+
+			if (node < _feedbackSeen.size() && !_feedbackSeen[node])
+			{
+				_feedbackSeen[node] = 1;
+				nodes.push_back(node);
+			}
+		}
+
+		for (size_t node : nodes)
+			_feedbackSeen[node] = 0;
+		///
+
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	logGLError(__FUNCTION__);
+
+	return feedback != NULL;
+}
+
+void VirtualTexture::render(TileTextureStore& textureStore)
+{
+	if (_vao == 0 || textureStore.getPageCount() == 0)
+		return;
+
+	textureStore.bindPage(0, GL_TEXTURE0); // the physical page cache
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, _pageTable);
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindVertexArray(_vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+//////////////////////////////////////////////////////////////////////////////////
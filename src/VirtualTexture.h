@@ -0,0 +1,89 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "TilePyramid.h"
+#include "TileTextureStore.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// sparse virtual texture over the tile pyramid
+///		- the whole map is one quad, its tex coords are in level 0 tiles (x: rows, y: cols);
+///		  the shader picks the pyramid node a fragment wants and looks it up in the page table
+///		- the physical page cache is one texture array page of the TileTextureStore, sized once,
+///		  so the gpu memory does not grow with the map; the store hands out no second page and the
+///		  caller coarsens the feedback to what fits, a slot on another page is never mapped
+///		- the page table is an R32UI texture with one texel per pyramid node, PAGE_TABLE_WIDTH
+///		  nodes per row: the layer of the node, or of its closest resident ancestor, and the level
+///		  of that node (see encodeEntry()); NO_PAGE while not even the root is resident
+///		- the feedback pass renders the quad at 1 / feedbackScale of the viewport into an R32UI
+///		  target, every texel the node it wanted; it is read back through a pbo and picked up
+///		  with collectFeedback() a frame or more later, a readback in flight is never waited on
+///		- the page loader is the one of the tiles: the caller turns the feedback into residency
+///		  requests and reports the arrivals / evictions with setPage() / clearPage()
+///
+class VirtualTexture
+{
+public:
+	VirtualTexture();
+	~VirtualTexture();
+
+	void	initialize(TilePyramid& pyramid, size_t feedbackScale);
+	void	release();
+
+	/// begin - page table, uploaded by updatePageTable() when it changed
+	void	setPage(size_t node, const TileTextureSlot& slot);
+	void	clearPage(size_t node);
+	void	updatePageTable();
+	/// end - page table
+
+	/// the caller enables the shader in feedback mode and sets its matrices; leaves the
+	/// drawFramebuffer bound and the viewport at width x height; false while the last readback
+	/// is still in flight, nothing is rendered then
+	bool	renderFeedback(size_t width, size_t height, GLuint drawFramebuffer);
+
+	/// the distinct nodes of the last finished readback; false if none finished since the last call
+	bool	collectFeedback(vector<size_t>& nodes);
+
+	/// physical pages on texture unit 0, page table on unit 1; the caller enables the shader
+	void	render(TileTextureStore& textureStore);
+
+	static GLuint	encodeEntry(GLuint layer, size_t level) { return layer | ((GLuint)level << 16); };
+
+	/// begin - getters / accessors
+	bool	isInitialized() { return _vao != 0; };
+	bool	isFeedbackPending() { return _feedbackFence != 0; };
+	size_t	getFeedbackScale() { return _feedbackScale; };
+	/// end - getters / accessors
+
+	static const GLuint	NO_PAGE = 0xffffffff;
+	static const size_t	PAGE_TABLE_WIDTH = 4096;
+
+protected:
+	TilePyramid*		_pyramid;
+	size_t				_feedbackScale;
+
+	vector<GLuint>		_layers;		// by node, NO_PAGE when not resident
+	vector<GLuint>		_entries;		// page table texels, by node
+	bool				_pageTableDirty;
+
+	GLuint				_pageTable;
+	GLsizei				_pageTableHeight;
+
+	GLuint				_vao;
+	GLuint				_vertexBuffer;
+
+	/// begin - feedback target and its readback
+	GLuint				_feedbackFramebuffer;
+	GLuint				_feedbackColor, _feedbackDepth;
+	GLsizei				_feedbackWidth, _feedbackHeight;
+	GLuint				_feedbackBuffer;	// pbo
+	GLsync				_feedbackFence;
+	GLsizei				_readbackWidth, _readbackHeight;
+	vector<unsigned char>	_feedbackSeen;	// by node, dedupe while collecting
+	/// end - feedback target and its readback
+
+	void	createFeedbackTarget(GLsizei width, GLsizei height);
+	void	releaseFeedbackTarget();
+};
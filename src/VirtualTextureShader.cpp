@@ -0,0 +1,184 @@
+#include "VirtualTextureShader.h"
+#include "ShaderCompiler.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+//////////////////////////////////////////////////////////////////////////////////
+static const char* __vertexShaderSource = R"(
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texCoord;
+
+uniform mat4 projection;
+uniform mat4 modelView;
+
+out vec2 tileCoord;
+
+void main()
+{
+	tileCoord = texCoord;
+	gl_Position = projection * modelView * vec4(position, 1.0);
+}
+)";
+
+static const char* __fragmentShaderSource = R"(
+const uint	NO_PAGE = 0xffffffffu;
+const uint	PAGE_TABLE_WIDTH = 4096u;
+const int	MAX_LEVELS = 32;
+
+in vec2 tileCoord; // level 0 tiles, x: rows, y: cols
+
+uniform sampler2DArray	physicalPages;
+uniform usampler2D		pageTable;
+uniform int				levelFirstNode[MAX_LEVELS];
+uniform int				levelRows[MAX_LEVELS];
+uniform int				levelCols[MAX_LEVELS];
+uniform int				levelCount;
+uniform float			tileTexSize;
+uniform float			lodErrorThreshold;
+uniform float			lodBias;
+
+#ifdef FEEDBACK
+out uint feedback;
+#else
+out vec4 fragColor;
+#endif
+
+/// coarsest level whose texels stay within lodErrorThreshold screen pixels
+int wantedLevel()
+{
+	vec2  texels = tileCoord * tileTexSize; // level 0 texels
+	float footprint = max(length(dFdx(texels)), length(dFdy(texels)));
+	float level = floor(log2(max(footprint * lodErrorThreshold, 1.0e-6)) + lodBias);
+
+	return int(clamp(level, 0.0, float(levelCount - 1)));
+}
+
+uint wantedNode(int level)
+{
+	float span = exp2(float(level));
+	int   row = min(int(tileCoord.x / span), levelRows[level] - 1);
+	int   col = min(int(tileCoord.y / span), levelCols[level] - 1);
+
+	return uint(levelFirstNode[level] + row * levelCols[level] + col);
+}
+
+void main()
+{
+	uint node = wantedNode(wantedLevel());
+
+#ifdef FEEDBACK
+	feedback = node;
+#else
+	uint entry = texelFetch(pageTable, ivec2(int(node % PAGE_TABLE_WIDTH), int(node / PAGE_TABLE_WIDTH)), 0).r;
+
+	if (entry == NO_PAGE)
+	{
+		fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	/// the entry may be an ancestor, its layer covers a larger span of level 0 tiles
+	vec2 uv = fract(tileCoord / exp2(float(entry >> 16u))); // x: row fraction (t), y: col fraction (s)
+
+	fragColor = vec4(texture(physicalPages, vec3(uv.y, uv.x, float(entry & 0xffffu))).rgb, 1.0);
+#endif
+}
+)";
+//////////////////////////////////////////////////////////////////////////////////
+
+VirtualTextureShader::VirtualTextureShader()
+{
+	_active = NULL;
+	_levelCount = 0;
+	_tileTexSize = 1.0f;
+	_lodErrorThreshold = 1.0f;
+
+	for (size_t level = 0; level < MAX_LEVELS; level++)
+		_levelFirstNode[level] = _levelRows[level] = _levelCols[level] = 0;
+
+	buildProgram(_programs[0], "#version 330 core\n");
+	buildProgram(_programs[1], "#version 330 core\n#define FEEDBACK\n");
+
+	logGLError(__FUNCTION__);
+}
+
+VirtualTextureShader::~VirtualTextureShader()
+{
+	for (Program& program : _programs)
+	{
+		if (program.program)
+			glDeleteProgram(program.program);
+
+		program.program = 0;
+	}
+}
+
+void VirtualTextureShader::buildProgram(Program& program, const char* defines)
+{
+	program.program = ShaderCompiler::buildProgram(__vertexShaderSource, __fragmentShaderSource, defines); // defines has the #version
+
+	GLuint id = program.program;
+
+	program.projectionLocation        = id ? glGetUniformLocation(id, "projection")        : -1;
+	program.modelViewLocation         = id ? glGetUniformLocation(id, "modelView")         : -1;
+	program.physicalPagesLocation     = id ? glGetUniformLocation(id, "physicalPages")     : -1;
+	program.pageTableLocation         = id ? glGetUniformLocation(id, "pageTable")         : -1;
+	program.levelFirstNodeLocation    = id ? glGetUniformLocation(id, "levelFirstNode")    : -1;
+	program.levelRowsLocation         = id ? glGetUniformLocation(id, "levelRows")         : -1;
+	program.levelColsLocation         = id ? glGetUniformLocation(id, "levelCols")         : -1;
+	program.levelCountLocation        = id ? glGetUniformLocation(id, "levelCount")        : -1;
+	program.tileTexSizeLocation       = id ? glGetUniformLocation(id, "tileTexSize")       : -1;
+	program.lodErrorThresholdLocation = id ? glGetUniformLocation(id, "lodErrorThreshold") : -1;
+	program.lodBiasLocation           = id ? glGetUniformLocation(id, "lodBias")           : -1;
+}
+
+void VirtualTextureShader::setPyramid(TilePyramid& pyramid, size_t tileTexSize)
+{
+	_levelCount = (GLint)min(pyramid.getLevelCount(), (size_t)MAX_LEVELS);
+	_tileTexSize = (GLfloat)tileTexSize;
+
+	for (GLint level = 0; level < _levelCount; level++)
+	{
+		_levelFirstNode[level] = (GLint)pyramid.getLevelFirstNode(level);
+		_levelRows[level] = (GLint)pyramid.getLevelRows(level);
+		_levelCols[level] = (GLint)pyramid.getLevelCols(level);
+	}
+}
+
+void VirtualTextureShader::enable(bool feedbackMode, size_t feedbackScale)
+{
+	_active = &_programs[feedbackMode ? 1 : 0];
+
+	glUseProgram(_active->program);
+
+	glUniform1i(_active->physicalPagesLocation, 0);	// texture unit 0
+	glUniform1i(_active->pageTableLocation, 1);		// texture unit 1
+
+	glUniform1iv(_active->levelFirstNodeLocation, (GLsizei)MAX_LEVELS, _levelFirstNode);
+	glUniform1iv(_active->levelRowsLocation, (GLsizei)MAX_LEVELS, _levelRows);
+	glUniform1iv(_active->levelColsLocation, (GLsizei)MAX_LEVELS, _levelCols);
+	glUniform1i(_active->levelCountLocation, _levelCount);
+	glUniform1f(_active->tileTexSizeLocation, _tileTexSize);
+	glUniform1f(_active->lodErrorThresholdLocation, _lodErrorThreshold);
+
+	/// a feedback pixel spans feedbackScale screen pixels, so do its derivatives
+	glUniform1f(_active->lodBiasLocation, feedbackMode ? -log2((float)max(feedbackScale, (size_t)1)) : 0.0f);
+}
+
+void VirtualTextureShader::disable()
+{
+	glUseProgram(0);
+
+	_active = NULL;
+}
+
+void VirtualTextureShader::setProjectionMatrix(const glm::mat4& projection)
+{
+	glUniformMatrix4fv(_active->projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+}
+
+void VirtualTextureShader::setModelViewMatrix(const glm::mat4& modelView)
+{
+	glUniformMatrix4fv(_active->modelViewLocation, 1, GL_FALSE, glm::value_ptr(modelView));
+}
+//////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "UtilityFunctions.h"
+#include "TilePyramid.h"
+
+using namespace UtilityFunctions;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// map shader for the VirtualTexture
+///		- same projection / model view uniforms as BasicShader
+///		- vertex layout: location 0 position (vec3), location 1 tex coord in level 0 tiles (vec2)
+///		- every fragment picks the pyramid level whose texels stay within lodErrorThreshold
+///		  screen pixels, the same rule TilePyramid::select() refines by, and the node there
+///		- render mode looks the node up in the page table (unit 1) and samples the layer it
+///		  names in the physical pages (unit 0), scaled to the level the entry is for
+///		- feedback mode writes the node index instead, into an R32UI target; lodBias makes up
+///		  for the lower resolution of that target
+///		- the two modes are two programs built from one source
+///
+class VirtualTextureShader
+{
+public:
+	VirtualTextureShader();
+	~VirtualTextureShader();
+
+	/// level layout of the pyramid and the rule, kept and set on every enable()
+	void	setPyramid(TilePyramid& pyramid, size_t tileTexSize);
+	void	setLodErrorThreshold(float lodErrorThreshold) { _lodErrorThreshold = lodErrorThreshold; };
+
+	/// feedbackScale: the feedback target is 1 / feedbackScale of the viewport
+	void	enable(bool feedbackMode = false, size_t feedbackScale = 1);
+	void	disable();
+
+	void	setProjectionMatrix(const glm::mat4& projection);
+	void	setModelViewMatrix(const glm::mat4& modelView);
+
+	bool	isValid() { return _programs[0].program != 0 && _programs[1].program != 0; };
+
+	static const size_t	MAX_LEVELS = 32;
+
+protected:
+	struct Program
+	{
+		GLuint	program;
+
+		GLint	projectionLocation;
+		GLint	modelViewLocation;
+		GLint	physicalPagesLocation;
+		GLint	pageTableLocation;
+		GLint	levelFirstNodeLocation;
+		GLint	levelRowsLocation;
+		GLint	levelColsLocation;
+		GLint	levelCountLocation;
+		GLint	tileTexSizeLocation;
+		GLint	lodErrorThresholdLocation;
+		GLint	lodBiasLocation;
+	};
+
+	Program		_programs[2];	// render, feedback
+	Program*	_active;
+
+	GLint		_levelFirstNode[MAX_LEVELS];
+	GLint		_levelRows[MAX_LEVELS];
+	GLint		_levelCols[MAX_LEVELS];
+	GLint		_levelCount;
+	GLfloat		_tileTexSize;
+	GLfloat		_lodErrorThreshold;
+
+	void	buildProgram(Program& program, const char* defines);
+};
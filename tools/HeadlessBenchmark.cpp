@@ -0,0 +1,52 @@
+/// renders a scene headless along a scripted camera flight and reports the frame times
+///		usage: HeadlessBenchmark <image> [frames] [cameraScript|-] [report.json|-] [width] [height] [name=value ...]
+///		- name=value arguments set RenderSettings, e.g. tileTextureBudgetBytes=268435456,
+///		  uploadBytesPerFrame=4194304, tileCompression=bc7, tileCompressionQuality=2, targetFrameMs=16.7
+///		- no display or gpu needed, runs on llvmpipe through egl (or osmesa)
+///		- "-" as the script flies the built in path, "-" as the report prints it to stdout
+///		- the report has min / mean / p50 / p99 per pass, see BenchmarkRecorder
+///
+#include "Application.h"
+
+#include <cstdlib>
+
+int main(int argc, char** argv)
+{
+	/// name=value arguments go to the settings, the others are the positional ones
+	RenderSettings	renderSettings;
+	vector<string>	args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+
+		if (arg.find('=') == string::npos)
+			args.push_back(arg);
+		else if (!renderSettings.set(arg))
+		{
+			cout << "Error, unknown render setting " << arg << endl;
+			return 1;
+		}
+	}
+	///
+
+	if (args.empty())
+	{
+		cout << "usage: " << argv[0] << " <image> [frames] [cameraScript|-] [report.json|-] [width] [height] [name=value ...]" << endl;
+		return 1;
+	}
+
+	string	imageFilename = args[0];
+	size_t	frames = args.size() > 1 ? (size_t)atoi(args[1].c_str()) : 600;
+	string	scriptFilename = args.size() > 2 && args[2] != "-" ? args[2] : "";
+	string	reportFilename = args.size() > 3 ? args[3] : "benchmark.json";
+	size_t	width = args.size() > 4 ? (size_t)atoi(args[4].c_str()) : 1280;
+	size_t	height = args.size() > 5 ? (size_t)atoi(args[5].c_str()) : 720;
+
+	GLApplication application("HeadlessBenchmark", 0, 0, width, height, true);
+
+	application.setRenderSettings(renderSettings);
+	application.buildScene(imageFilename);
+
+	return application.runBenchmark(scriptFilename, frames, reportFilename) ? 0 : 1;
+}
@@ -0,0 +1,856 @@
+/// microbenchmarks of the cpu side imagery pipeline, no gl context needed
+///		usage: PipelineBenchmark [maxImageSize] [baseline.json|-] [report.json|-] [filter]
+///		- synthetic images from 1k x 1k up to maxImageSize (16384 by default, 65536 for the full
+///		  run); their pixels are generated while they are read, so a 64k x 64k image takes no memory
+///		- the pixel work is measured without the gl upload: tiles are cut / downsampled into
+///		  memory and dropped, the way the scene build thread hands them to the streamer
+///		- every case repeats until it ran __minSeconds, in batches of at least a millisecond; the
+///		  median iteration is reported as ms, MB/s of source pixels and tiles/s
+///		- with a baseline (PipelineBenchmark.baseline.json is the stored one) every case is
+///		  compared to it, a tiles/s drop beyond the tolerance is a regression and the exit code
+///		  is 2; write a new baseline with "-" as baseline and the baseline file as report
+///		- the baseline stores the vector path and the thread count it was measured with, a run
+///		  on another vector path only shows the changes; on another thread count the single
+///		  threaded cases are still checked, only the job system ones are not; record it from the
+///		  shipping build flags (no -march), the kernels pick their path at run time
+///		- filter: only the cases whose name contains it
+///		- before anything is timed, the pixel kernels are checked byte for byte against plain
+///		  scalar loops, and so are the tile table extents and every block compressor path, a
+///		  mismatch exits with 3
+///
+#include "ImageSource.h"
+#include "TilePyramid.h"
+#include "TileTable.h"
+#include "JobSystem.h"
+#include "BlockCompressor.h"
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////////////
+static const double	__minSeconds = 0.5;		// per case
+static const double	__minSampleSeconds = 0.001;
+static const size_t	__maxSamples = 1000;
+static const double	__tolerance = 0.15;		// tiles/s drop that counts as a regression
+static const size_t	__tileTexSize = 256;
+
+static volatile size_t __sink = 0; // keeps the results of the cases alive
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// rgb image whose pixels are a function of their position, made up on every read
+///
+class SyntheticImageSource : public ImageSource
+{
+public:
+	SyntheticImageSource(size_t width, size_t height) : _width(width), _height(height) {};
+
+	void	getDimension(size_t& width, size_t& height) { width = _width; height = _height; };
+	size_t	getBytesPerPixel() { return 3; };
+
+	void	readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst)
+	{
+		for (size_t y = 0; y < height; y++)
+		{
+			unsigned char*	out = dst + y * width * 3;
+			size_t			r = row + y;
+
+			for (size_t x = 0; x < width; x++, out += 3)
+			{
+				size_t c = col + x;
+
+				if (r >= _height || c >= _width)
+				{
+					out[0] = out[1] = out[2] = 0;
+					continue;
+				}
+
+				out[0] = (unsigned char)(r + c);
+				out[1] = (unsigned char)(r * 3 + (c >> 2));
+				out[2] = (unsigned char)((r >> 3) ^ c);
+			}
+		}
+	};
+
+	/// the same pixels, tightly packed
+	void	fill(vector<unsigned char>& pixels)
+	{
+		pixels.resize(_width * _height * 3);
+
+		readRegion(0, 0, _width, _height, pixels.data());
+	};
+
+protected:
+	size_t	_width, _height;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// rgb image held in memory, the path ImageBuffer::getTile() takes
+///
+class BufferImageSource : public ImageSource
+{
+public:
+	BufferImageSource(const vector<unsigned char>& pixels, size_t width, size_t height) : _pixels(pixels), _width(width), _height(height) {};
+
+	void	getDimension(size_t& width, size_t& height) { width = _width; height = _height; };
+	size_t	getBytesPerPixel() { return 3; };
+
+	void	readRegion(size_t row, size_t col, size_t width, size_t height, unsigned char* dst)
+	{
+		copyRegion(_pixels.data(), _width, _height, 3, row, col, width, height, dst);
+	};
+
+protected:
+	const vector<unsigned char>&	_pixels;
+	size_t							_width, _height;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+/// PixelKernels against straight scalar loops, every width up to a few vector steps and the
+/// tails after them, padded pitches, in place swaps; every path the cpu runs, widest first
+///
+static size_t checkKernel(const string& name, const vector<unsigned char>& result, const vector<unsigned char>& reference, size_t size)
+{
+	if (result == reference)
+		return 0;
+
+	cout << "Error, " << name << " (" << PixelKernels::getInstructionSet() << ") differs from the scalar reference at size " << size << endl;
+
+	return 1;
+}
+
+static size_t verifyKernelPath()
+{
+	mt19937					random(7);
+	vector<unsigned char>	src(70000);
+	size_t					failures = 0;
+
+	for (unsigned char& value : src)
+		value = (unsigned char)random();
+
+	vector<size_t> sizes;
+
+	for (size_t size = 0; size <= 70; size++)
+		sizes.push_back(size);
+
+	sizes.push_back(255);
+	sizes.push_back(256);
+	sizes.push_back(4099);
+
+	for (size_t count : sizes)
+	{
+		/// expand / contract / swap over count pixels
+		vector<unsigned char> rgba(count * 4), rgbaReference(count * 4);
+
+		PixelKernels::expandRGBToRGBA(src.data(), count, rgba.data(), 200);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			rgbaReference[i * 4 + 0] = src[i * 3 + 0];
+			rgbaReference[i * 4 + 1] = src[i * 3 + 1];
+			rgbaReference[i * 4 + 2] = src[i * 3 + 2];
+			rgbaReference[i * 4 + 3] = 200;
+		}
+
+		failures += checkKernel("expandRGBToRGBA", rgba, rgbaReference, count);
+
+		vector<unsigned char> rgb(count * 3), rgbReference(count * 3);
+
+		PixelKernels::contractRGBAToRGB(src.data(), count, rgb.data());
+
+		for (size_t i = 0; i < count * 3; i++)
+			rgbReference[i] = src[i / 3 * 4 + i % 3];
+
+		failures += checkKernel("contractRGBAToRGB", rgb, rgbReference, count);
+
+		for (size_t i = 0; i < count * 3; i++)
+			rgbReference[i] = src[i - i % 3 + 2 - i % 3];
+
+		PixelKernels::swapRedBlue(src.data(), count, rgb.data());
+		failures += checkKernel("swapRedBlue", rgb, rgbReference, count);
+
+		rgb.assign(src.begin(), src.begin() + count * 3);
+
+		PixelKernels::swapRedBlue(rgb.data(), count, rgb.data());
+		failures += checkKernel("swapRedBlue in place", rgb, rgbReference, count);
+		///
+
+		/// 2x2 downsample of a count x 3 region and the strided copy, pitches padded by a pixel
+		for (size_t bytesPerPixel = 1; bytesPerPixel <= 4 && count <= 256; bytesPerPixel++)
+		{
+			size_t					height = 3;
+			size_t					srcPitch = (count * 2 + 1) * bytesPerPixel;
+			size_t					dstPitch = (count + 1) * bytesPerPixel;
+			vector<unsigned char>	dst(height * dstPitch, 0), dstReference(height * dstPitch, 0);
+
+			PixelKernels::downsample2x2(src.data(), srcPitch, count, height, bytesPerPixel, dst.data(), dstPitch);
+
+			for (size_t y = 0; y < height; y++)
+			{
+				for (size_t i = 0; i < count * bytesPerPixel; i++)
+				{
+					const unsigned char* src0 = &src[2 * y * srcPitch + i / bytesPerPixel * 2 * bytesPerPixel + i % bytesPerPixel];
+
+					dstReference[y * dstPitch + i] = (unsigned char)((src0[0] + src0[bytesPerPixel] + src0[srcPitch] + src0[srcPitch + bytesPerPixel] + 2) / 4);
+				}
+			}
+
+			failures += checkKernel("downsample2x2/" + to_string(bytesPerPixel), dst, dstReference, count);
+
+			fill(dst.begin(), dst.end(), 0);
+
+			PixelKernels::copyRect(src.data() + bytesPerPixel, srcPitch, dst.data(), dstPitch, count * bytesPerPixel, height);
+
+			for (size_t y = 0; y < height; y++)
+			{
+				for (size_t i = 0; i < count * bytesPerPixel; i++)
+					dstReference[y * dstPitch + i] = src[y * srcPitch + bytesPerPixel + i];
+			}
+
+			failures += checkKernel("copyRect/" + to_string(bytesPerPixel), dst, dstReference, count);
+		}
+		///
+	}
+
+	return failures;
+}
+
+static bool verifyKernels()
+{
+	PixelInstructionSet	supported = PixelKernels::getSupportedInstructionSet();
+	size_t				failures = 0;
+
+	for (int instructionSet = supported; instructionSet >= PIXEL_SCALAR; instructionSet--)
+	{
+		PixelKernels::limitInstructionSet((PixelInstructionSet)instructionSet);
+
+		failures += verifyKernelPath();
+	}
+
+	PixelKernels::limitInstructionSet(supported);
+
+	return failures == 0;
+}
+
+/// TileTable::getExtents() of every path the cpu runs against a plain loop, over ranges that
+/// start and end anywhere within the vector blocks
+///
+static bool verifyTileTable()
+{
+	mt19937								random(13);
+	uniform_real_distribution<float>	coordinate(-1000.0f, 1000.0f);
+	TileTable							tileTable;
+	size_t								count = 103;
+	size_t								failures = 0;
+
+	tileTable.reserve(count);
+
+	for (size_t tile = 0; tile < count; tile++)
+		tileTable.add(glm::vec3(coordinate(random), coordinate(random), coordinate(random)), glm::vec3(coordinate(random), coordinate(random), coordinate(random)), 0, 0);
+
+	PixelInstructionSet supported = TileTable::getSupportedInstructionSet();
+
+	for (int instructionSet = supported; instructionSet >= PIXEL_SCALAR; instructionSet--)
+	{
+		TileTable::limitInstructionSet((PixelInstructionSet)instructionSet);
+
+		for (size_t begin = 0; begin < 20; begin++)
+		{
+			for (size_t end = begin; end <= count; end++)
+			{
+				glm::vec3 ll(1.0e30f), ur(-1.0e30f), llReference(1.0e30f), urReference(-1.0e30f);
+
+				tileTable.getExtents(begin, end, ll, ur);
+
+				for (size_t tile = begin; tile < end; tile++)
+				{
+					llReference = glm::min(llReference, tileTable.getLL(tile));
+					urReference = glm::max(urReference, tileTable.getUR(tile));
+				}
+
+				if (ll != llReference || ur != urReference)
+				{
+					cout << "Error, getExtents (" << TileTable::getInstructionSet() << ") differs from the scalar reference on " << begin << " - " << end << endl;
+					failures++;
+				}
+			}
+		}
+	}
+
+	TileTable::limitInstructionSet(supported);
+
+	return failures == 0;
+}
+
+/// BlockCompressor: every path the cpu runs against its scalar one, noise and smooth gradients
+/// (near ties in the palette search), bc1 and bc7 at every quality
+///
+static bool verifyBlockCompressor()
+{
+	mt19937					random(11);
+	size_t					size = 64;
+	vector<unsigned char>	pixels(size * size * 3);
+	size_t					failures = 0;
+
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = i < pixels.size() / 2 ? (unsigned char)random() : (unsigned char)((i / 3) % size * 4 + i % 3);
+
+	BlockInstructionSet supported = BlockCompressor::getSupportedInstructionSet();
+
+	for (TileCompression compression : { TILE_COMPRESSION_BC1, TILE_COMPRESSION_BC7 })
+	{
+		for (int quality = 0; quality <= 2; quality++)
+		{
+			vector<unsigned char> reference(BlockCompressor::getCompressedSize(size, size, compression));
+
+			BlockCompressor::limitInstructionSet(BLOCK_SCALAR);
+			BlockCompressor::compress(pixels.data(), size, size, 3, compression, quality, reference.data());
+
+			for (int instructionSet = supported; instructionSet > BLOCK_SCALAR; instructionSet--)
+			{
+				vector<unsigned char> blocks(reference.size());
+
+				BlockCompressor::limitInstructionSet((BlockInstructionSet)instructionSet);
+				BlockCompressor::compress(pixels.data(), size, size, 3, compression, quality, blocks.data());
+
+				if (blocks != reference)
+				{
+					cout << "Error, " << BlockCompressor::getName(compression) << " quality " << quality << " (" << BlockCompressor::getInstructionSet() 
+						 << ") differs from the scalar path" << endl;
+					failures++;
+				}
+			}
+		}
+	}
+
+	BlockCompressor::limitInstructionSet(supported);
+
+	return failures == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+struct BenchmarkCase
+{
+	string				name;
+	double				bytes;	// source bytes one iteration works through, 0 if none
+	double				tiles;	// tiles one iteration produces
+	function<void()>	run;
+	bool				threaded = false;	// runs on the job system, compared on the baseline's thread count only
+};
+
+struct BenchmarkResult
+{
+	string	name;
+	size_t	iterations;
+	double	ms;				// median iteration
+	double	mbPerSecond;
+	double	tilesPerSecond;
+};
+
+/// what the stored numbers were measured on, and the numbers
+struct Baseline
+{
+	size_t				hardwareThreads;
+	string				instructionSet;
+	map<string, double>	tilesPerSecond;
+};
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+static BenchmarkResult runCase(const BenchmarkCase& benchmarkCase)
+{
+	typedef chrono::steady_clock Clock;
+
+	/// warm up (page faults, arena blocks, worker threads), it also sizes the batches: cases
+	/// shorter than __minSampleSeconds run several times per sample so timer noise stays small
+	Clock::time_point warmUp = Clock::now();
+
+	benchmarkCase.run();
+
+	double	once = chrono::duration<double>(Clock::now() - warmUp).count();
+	size_t	batch = once > 0.0 ? max((size_t)1, (size_t)(__minSampleSeconds / once)) : 1000;
+	///
+
+	vector<double>	samples;
+	double			total = 0.0;
+
+	while (samples.empty() || (total < __minSeconds && samples.size() < __maxSamples))
+	{
+		Clock::time_point start = Clock::now();
+
+		for (size_t i = 0; i < batch; i++)
+			benchmarkCase.run();
+
+		double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+		samples.push_back(seconds / batch);
+		total += seconds;
+	}
+
+	sort(samples.begin(), samples.end());
+
+	double median = samples[samples.size() / 2];
+
+	BenchmarkResult result;
+
+	result.name = benchmarkCase.name;
+	result.iterations = samples.size() * batch;
+	result.ms = median * 1000.0;
+	result.mbPerSecond = median > 0.0 ? benchmarkCase.bytes / (1024.0 * 1024.0) / median : 0.0;
+	result.tilesPerSecond = median > 0.0 ? benchmarkCase.tiles / median : 0.0;
+
+	return result;
+}
+
+/// one value or benchmark per line, see writeReport(); only the tiles/s are compared
+///
+static Baseline loadBaseline(const string& filename)
+{
+	Baseline	baseline;
+	ifstream	in(filename);
+	string		line;
+
+	baseline.hardwareThreads = 0;
+
+	while (getline(in, line))
+	{
+		size_t threads = line.find("\"hardwareThreads\": ");
+		size_t instructionSet = line.find("\"instructionSet\": \"");
+
+		if (threads != string::npos)
+			baseline.hardwareThreads = (size_t)atoll(line.c_str() + threads + strlen("\"hardwareThreads\": "));
+
+		if (instructionSet != string::npos)
+		{
+			instructionSet += strlen("\"instructionSet\": \"");
+			baseline.instructionSet = line.substr(instructionSet, line.find('"', instructionSet) - instructionSet);
+		}
+
+		size_t name = line.find("\"name\": \"");
+		size_t tiles = line.find("\"tilesPerSecond\": ");
+
+		if (name == string::npos || tiles == string::npos)
+			continue;
+
+		name += strlen("\"name\": \"");
+
+		baseline.tilesPerSecond[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + tiles + strlen("\"tilesPerSecond\": "));
+	}
+
+	return baseline;
+}
+
+static void writeReport(ostream& out, const vector<BenchmarkResult>& results, size_t maxImageSize)
+{
+	out << fixed << setprecision(4);
+	out << "{" << endl;
+	out << "\t\"hardwareThreads\": " << thread::hardware_concurrency() << "," << endl;
+	out << "\t\"instructionSet\": \"" << PixelKernels::getInstructionSet() << "\"," << endl;
+	out << "\t\"maxImageSize\": " << maxImageSize << "," << endl;
+	out << "\t\"benchmarks\": [" << endl;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+
+		out << "\t\t{ \"name\": \"" << result.name << "\", \"iterations\": " << result.iterations << ", \"ms\": " << result.ms
+			<< ", \"mbPerSecond\": " << result.mbPerSecond << ", \"tilesPerSecond\": " << result.tilesPerSecond << " }"
+			<< (i + 1 < results.size() ? "," : "") << endl;
+	}
+
+	out << "\t]" << endl;
+	out << "}" << endl;
+}
+
+/// the cases, smallest images first
+///
+static void addCases(vector<BenchmarkCase>& cases, size_t maxImageSize, JobSystem& jobSystem,
+					 map<size_t, vector<unsigned char> >& images, TileTable& tileTable, TilePyramid& pyramid)
+{
+	/// in memory tile cut (ImageBuffer::getTile), all level 0 tiles of the image
+	for (size_t size : { (size_t)1024, (size_t)4096, (size_t)8192 })
+	{
+		if (size > maxImageSize)
+			continue;
+
+		SyntheticImageSource(size, size).fill(images[size]);
+
+		size_t rows, cols;
+
+		TilePyramid::getBaseGrid(size, size, __tileTexSize, rows, cols);
+
+		const vector<unsigned char>& pixels = images[size];
+
+		cases.push_back({ "readRegion/memory/" + to_string(size), (double)pixels.size(), (double)(rows * cols), [&pixels, size, rows, cols]()
+		{
+			BufferImageSource		source(pixels, size, size);
+			vector<unsigned char>	tile(source.getRegionSize(__tileTexSize, __tileTexSize));
+
+			for (size_t row = 0; row < rows; row++)
+			{
+				for (size_t col = 0; col < cols; col++)
+				{
+					source.readRegion(row * __tileTexSize, col * __tileTexSize, __tileTexSize, __tileTexSize, tile.data());
+					__sink += tile[0];
+				}
+			}
+		}});
+	}
+	///
+
+	/// box filtered tiles of one coarser level (tile reloads), from a 4096 image in memory
+	if (maxImageSize >= 4096)
+	{
+		const vector<unsigned char>& pixels = images[4096];
+
+		for (size_t factor : { (size_t)2, (size_t)4, (size_t)8 })
+		{
+			size_t tiles = 4096 / (__tileTexSize * factor);
+
+			cases.push_back({ "readRegionDownsampled/x" + to_string(factor), (double)pixels.size(), (double)(tiles * tiles), [&pixels, factor, tiles]()
+			{
+				BufferImageSource		source(pixels, 4096, 4096);
+				vector<unsigned char>	tile(source.getRegionSize(__tileTexSize, __tileTexSize));
+
+				for (size_t row = 0; row < tiles; row++)
+				{
+					for (size_t col = 0; col < tiles; col++)
+					{
+						source.readRegionDownsampled(row * __tileTexSize * factor, col * __tileTexSize * factor, __tileTexSize, __tileTexSize, factor, tile.data());
+						__sink += tile[0];
+					}
+				}
+			}});
+		}
+	}
+	///
+
+	/// the scene build: every pyramid tile cut and downsampled, uploads dropped
+	for (size_t size : { (size_t)1024, (size_t)4096, (size_t)16384, (size_t)65536 })
+	{
+		if (size > maxImageSize)
+			continue;
+
+		size_t rows, cols;
+
+		TilePyramid::getBaseGrid(size, size, __tileTexSize, rows, cols);
+
+		TilePyramid layout;
+
+		layout.build(rows, cols, glm::vec3(1.0f, 1.0f, 0.0f), 1.0f, __tileTexSize);
+
+		cases.push_back({ "generatePixels/" + to_string(size), (double)size * size * 3, (double)layout.getNodeCount(), [size, rows, cols, &jobSystem]()
+		{
+			SyntheticImageSource	source(size, size);
+			TilePyramid				tilePyramid;
+			vector<unsigned char>	rootPixels;
+
+			tilePyramid.build(rows, cols, glm::vec3(1.0f, 1.0f, 0.0f), 1.0f, __tileTexSize);
+
+			tilePyramid.generatePixels(source, [](size_t node, const unsigned char* pixels) { __sink += pixels[0]; return true; }, rootPixels, &jobSystem);
+		}, true});
+	}
+	///
+
+	/// the buildScene() tiling loop without gl: pyramid layout and tile table, up to 256k x 256k
+	for (size_t size : { (size_t)4096, (size_t)65536, (size_t)262144 })
+	{
+		size_t rows, cols;
+
+		TilePyramid::getBaseGrid(size, size, __tileTexSize, rows, cols);
+
+		pyramid.build(rows, cols, glm::vec3(1.0f, 1.0f, 0.0f), 1.0f, __tileTexSize);
+
+		cases.push_back({ "sceneLayout/" + to_string(size), 0.0, (double)pyramid.getNodeCount(), [rows, cols, &tileTable, &pyramid]()
+		{
+			pyramid.build(rows, cols, glm::vec3(1.0f, 1.0f, 0.0f), 1.0f, __tileTexSize);
+
+			tileTable.reserve(pyramid.getNodeCount());
+
+			for (size_t node = 0; node < pyramid.getNodeCount(); node++)
+			{
+				const TilePyramidNode& tileNode = pyramid.getNode(node);
+
+				tileTable.add(tileNode.ll, tileNode.ur, tileNode.level, tileNode.level == 0 ? TILE_FLAG_BASE : 0);
+			}
+
+			__sink += tileTable.getCount();
+		}});
+	}
+	///
+
+	/// computeBoundingBox(): extents of every tile table entry, chunked over the job system
+	for (size_t size : { (size_t)4096, (size_t)65536, (size_t)262144 })
+	{
+		size_t rows, cols;
+
+		TilePyramid::getBaseGrid(size, size, __tileTexSize, rows, cols);
+
+		size_t tiles = 0;
+
+		for (size_t levelRows = rows, levelCols = cols; ; levelRows = (levelRows + 1) / 2, levelCols = (levelCols + 1) / 2)
+		{
+			tiles += levelRows * levelCols;
+
+			if (levelRows == 1 && levelCols == 1)
+				break;
+		}
+
+		cases.push_back({ "boundingBox/" + to_string(size), 0.0, (double)tiles, [rows, cols, &tileTable, &pyramid, &jobSystem]()
+		{
+			if (pyramid.getLevelCount() == 0 || pyramid.getLevelRows(0) != rows || pyramid.getLevelCols(0) != cols || tileTable.getCount() != pyramid.getNodeCount())
+			{
+				/// the table of this size, not timed after the warm up run
+				pyramid.build(rows, cols, glm::vec3(1.0f, 1.0f, 0.0f), 1.0f, __tileTexSize);
+
+				tileTable.reserve(pyramid.getNodeCount());
+
+				for (size_t node = 0; node < pyramid.getNodeCount(); node++)
+					tileTable.add(pyramid.getNode(node).ll, pyramid.getNode(node).ur, pyramid.getNode(node).level, 0);
+				///
+			}
+
+			size_t				grain = 16384;
+			size_t				chunkCount = (tileTable.getCount() + grain - 1) / grain;
+			vector<glm::vec3>	chunkLL(chunkCount, glm::vec3(1.0e30f, 1.0e30f, 1.0e30f));
+			vector<glm::vec3>	chunkUR(chunkCount, glm::vec3(-1.0e30f, -1.0e30f, -1.0e30f));
+
+			jobSystem.parallelFor(tileTable.getCount(), grain, [&](size_t begin, size_t end)
+			{
+				tileTable.getExtents(begin, end, chunkLL[begin / grain], chunkUR[begin / grain]);
+			});
+
+			__sink += (size_t)chunkUR[0].x;
+		}, true});
+	}
+	///
+
+	/// the pixel kernels over a 1k x 1k image (16 tiles)
+	if (maxImageSize >= 1024)
+	{
+		const vector<unsigned char>&	pixels = images[1024];
+		double							bytes = (double)pixels.size();
+		double							tiles = 1024.0 * 1024.0 / (__tileTexSize * __tileTexSize);
+
+		cases.push_back({ "kernel/copyRect", bytes, tiles, [&pixels]()
+		{
+			static thread_local vector<unsigned char> tile(__tileTexSize * __tileTexSize * 3);
+
+			for (size_t i = 0; i < 16; i++)
+			{
+				PixelKernels::copyRect(&pixels[((i / 4) * __tileTexSize * 1024 + (i % 4) * __tileTexSize) * 3], 1024 * 3,
+									   tile.data(), __tileTexSize * 3, __tileTexSize * 3, __tileTexSize);
+				__sink += tile[0];
+			}
+		}});
+
+		cases.push_back({ "kernel/expandRGBToRGBA", bytes, tiles, [&pixels]()
+		{
+			static thread_local vector<unsigned char> rgba(1024 * 1024 * 4);
+
+			PixelKernels::expandRGBToRGBA(pixels.data(), 1024 * 1024, rgba.data());
+			__sink += rgba[0];
+		}});
+
+		cases.push_back({ "kernel/contractRGBAToRGB", bytes / 3 * 4, tiles, [&pixels]()
+		{
+			static thread_local vector<unsigned char> rgba, rgb(1024 * 1024 * 3);
+
+			if (rgba.empty())
+			{
+				rgba.resize(1024 * 1024 * 4);
+				PixelKernels::expandRGBToRGBA(pixels.data(), 1024 * 1024, rgba.data());
+			}
+
+			PixelKernels::contractRGBAToRGB(rgba.data(), 1024 * 1024, rgb.data());
+			__sink += rgb[0];
+		}});
+
+		cases.push_back({ "kernel/swapRedBlue", bytes, tiles, [&pixels]()
+		{
+			static thread_local vector<unsigned char> bgr(1024 * 1024 * 3);
+
+			PixelKernels::swapRedBlue(pixels.data(), 1024 * 1024, bgr.data());
+			__sink += bgr[0];
+		}});
+
+		cases.push_back({ "kernel/downsample2x2/rgb", bytes, tiles / 4, [&pixels]()
+		{
+			static thread_local vector<unsigned char> half(512 * 512 * 3);
+
+			PixelKernels::downsample2x2(pixels.data(), 1024 * 3, 512, 512, 3, half.data(), 512 * 3);
+			__sink += half[0];
+		}});
+
+		cases.push_back({ "kernel/downsample2x2/rgba", bytes / 3 * 4, tiles / 4, [&pixels]()
+		{
+			static thread_local vector<unsigned char> rgba, half(512 * 512 * 4);
+
+			if (rgba.empty())
+			{
+				rgba.resize(1024 * 1024 * 4);
+				PixelKernels::expandRGBToRGBA(pixels.data(), 1024 * 1024, rgba.data());
+			}
+
+			PixelKernels::downsample2x2(rgba.data(), 1024 * 4, 512, 512, 4, half.data(), 512 * 4);
+			__sink += half[0];
+		}});
+	}
+	///
+
+	/// block compression of one tile, as a reload compresses it (no job system)
+	if (maxImageSize >= 1024)
+	{
+		const vector<unsigned char>& pixels = images[1024];
+
+		for (TileCompression compression : { TILE_COMPRESSION_BC1, TILE_COMPRESSION_BC7 })
+		{
+			cases.push_back({ string("compress/") + BlockCompressor::getName(compression), (double)(__tileTexSize * __tileTexSize * 3), 1.0, [&pixels, compression]()
+			{
+				static thread_local vector<unsigned char> tile(__tileTexSize * __tileTexSize * 3);
+				static thread_local vector<unsigned char> blocks;
+
+				BufferImageSource(pixels, 1024, 1024).readRegion(256, 256, __tileTexSize, __tileTexSize, tile.data());
+
+				blocks.resize(BlockCompressor::getCompressedSize(__tileTexSize, __tileTexSize, compression));
+
+				BlockCompressor::compress(tile.data(), __tileTexSize, __tileTexSize, 3, compression, 1, blocks.data());
+
+				__sink += blocks[0];
+			}});
+		}
+	}
+	///
+}
+
+int main(int argc, char** argv)
+{
+	size_t	maxImageSize = argc > 1 ? (size_t)atoll(argv[1]) : 16384;
+	string	baselineFilename = argc > 2 && string(argv[2]) != "-" ? argv[2] : "";
+	string	reportFilename = argc > 3 ? argv[3] : "-";
+	string	filter = argc > 4 ? argv[4] : "";
+
+	if (maxImageSize < 1024)
+	{
+		cout << "usage: " << argv[0] << " [maxImageSize >= 1024] [baseline.json|-] [report.json|-] [filter]" << endl;
+		return 1;
+	}
+
+	if (!verifyKernels() || !verifyTileTable() || !verifyBlockCompressor())
+		return 3;
+
+	JobSystem								jobSystem;
+	map<size_t, vector<unsigned char> >		images;
+	TileTable								tileTable;
+	TilePyramid								pyramid;
+	vector<BenchmarkCase>					cases;
+
+	/// the pipeline logs every pyramid it builds, kept out of the table
+	ostringstream	pipelineLog;
+	streambuf*		console = cout.rdbuf();
+	///
+
+	cout.rdbuf(pipelineLog.rdbuf());
+	addCases(cases, maxImageSize, jobSystem, images, tileTable, pyramid);
+	cout.rdbuf(console);
+
+	Baseline				stored = baselineFilename.empty() ? Baseline() : loadBaseline(baselineFilename);
+	map<string, double>&	baseline = stored.tilesPerSecond;
+	vector<BenchmarkResult>	results;
+	size_t					regressions = 0;
+	bool					comparable = true;
+	bool					threadsComparable = true;
+
+	if (!baselineFilename.empty() && baseline.empty())
+		cout << "Error, no baseline in " << baselineFilename << endl;
+
+	/// numbers from another vector path are shown, but are no regression; another core count
+	/// only leaves out the cases on the job system
+	if (!baseline.empty() && stored.instructionSet != PixelKernels::getInstructionSet())
+	{
+		cout << "the baseline was recorded with " << stored.instructionSet << ", this run is " << PixelKernels::getInstructionSet() 
+			 << ", changes are not checked" << endl;
+
+		comparable = false;
+	}
+
+	if (!baseline.empty() && stored.hardwareThreads != thread::hardware_concurrency())
+	{
+		cout << "the baseline was recorded on " << stored.hardwareThreads << " thread(s), this run is on " << thread::hardware_concurrency() 
+			 << ", changes of the job system cases are not checked" << endl;
+
+		threadsComparable = false;
+	}
+	///
+
+	cout << left << setw(32) << "case" << right << setw(8) << "iters" << setw(12) << "ms" << setw(12) << "MB/s"
+		 << setw(14) << "tiles/s" << setw(12) << "baseline" << endl;
+
+	for (const BenchmarkCase& benchmarkCase : cases)
+	{
+		if (!filter.empty() && benchmarkCase.name.find(filter) == string::npos)
+			continue;
+
+		cout.rdbuf(pipelineLog.rdbuf());
+
+		BenchmarkResult result = runCase(benchmarkCase);
+
+		cout.rdbuf(console);
+		pipelineLog.str("");
+
+		results.push_back(result);
+
+		/// change against the baseline, in tiles/s
+		string change = "-";
+
+		if (baseline.count(result.name) && baseline[result.name] > 0.0)
+		{
+			double ratio = result.tilesPerSecond / baseline[result.name];
+
+			ostringstream text;
+
+			text << showpos << fixed << setprecision(1) << (ratio - 1.0) * 100.0 << "%";
+
+			change = text.str();
+
+			if (comparable && (threadsComparable || !benchmarkCase.threaded) && ratio < 1.0 - __tolerance)
+			{
+				change += " !";
+				regressions++;
+			}
+		}
+		///
+
+		cout << left << setw(32) << result.name << right << setw(8) << result.iterations << fixed << setprecision(4) << setw(12) << result.ms
+			 << setprecision(1) << setw(12) << result.mbPerSecond << setw(14) << result.tilesPerSecond << setw(12) << change << endl;
+	}
+
+	if (reportFilename == "-")
+		writeReport(cout, results, maxImageSize);
+	else
+	{
+		ofstream out(reportFilename);
+
+		if (!out.is_open())
+		{
+			cout << "Error, can not write " << reportFilename << endl;
+			return 1;
+		}
+
+		writeReport(out, results, maxImageSize);
+	}
+
+	if (regressions > 0)
+		cout << regressions << " case(s) more than " << (int)(__tolerance * 100.0) << "% below the baseline" << endl;
+
+	return regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,155 @@
+/// builds the tile cache of a source image, see TileCache.h
+///		usage: TileCacheBuilder <image> <tileTexSize> [cacheFile] [tileCompression=none|bc1|bc7] [tileCompressionQuality=0..2]
+///		- <image> may be a mosaic manifest, see MosaicImageSource.h
+///		- the cache goes next to the image ("<image>.tiles") unless a file is given; the viewer
+///		  picks it up at startup as long as the image (every image of a mosaic), the tile size
+///		  and the tile compression are unchanged
+///		- the tiles are stored block compressed as the viewer uploads them, with the render
+///		  settings' default compression unless one is given; tileCompression=none for a viewer
+///		  whose driver lacks it
+///		- runs without gl, the tiles are the same ones the viewer builds itself
+///
+#include "RenderSettings.h"
+#include "ImageSource.h"
+#include "MosaicImageSource.h"
+#include "TilePyramid.h"
+#include "TileCache.h"
+#include "JobSystem.h"
+
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char** argv)
+{
+	/// name=value arguments go to the settings, the others are the positional ones
+	RenderSettings	renderSettings;
+	vector<string>	args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+
+		if (arg.find('=') == string::npos)
+			args.push_back(arg);
+		else if (!renderSettings.set(arg))
+		{
+			cout << "Error, unknown render setting " << arg << endl;
+			return 1;
+		}
+	}
+	///
+
+	if (args.size() < 2)
+	{
+		cout << "usage: " << argv[0] << " <image> <tileTexSize> [cacheFile] [tileCompression=none|bc1|bc7] [tileCompressionQuality=0..2]" << endl;
+		return 1;
+	}
+
+	string	imageFilename = args[0];
+	size_t	tileTexSize = (size_t)atoi(args[1].c_str());
+	string	cacheFilename = args.size() > 2 ? args[2] : TileCache::getCacheFilename(imageFilename);
+
+	if (tileTexSize == 0)
+	{
+		cout << "Error, tile size has to be > 0" << endl;
+		return 1;
+	}
+
+	/// the viewer only compresses tiles made of whole blocks
+	TileCompression compression = tileTexSize % 4 == 0 ? renderSettings.tileCompression : TILE_COMPRESSION_NONE;
+
+	/// same source as the viewer: mapped if the layout is known, decoded otherwise
+	ImageBuffer*	imageBuffer = NULL;
+	ImageSource*	source = MosaicImageSource::isManifest(imageFilename) ? (ImageSource*)MosaicImageSource::open(imageFilename) 
+																		  : (ImageSource*)MappedImageSource::open(imageFilename);
+
+	if (source == NULL && MosaicImageSource::isManifest(imageFilename))
+		return 1;
+
+	if (source == NULL)
+	{
+		imageBuffer = ImageFactory::getImage(imageFilename);
+
+		if (imageBuffer == NULL || imageBuffer->getBuffer() == NULL)
+		{
+			cout << "Error, input image file " << imageFilename << " not read properly" << endl;
+			return 1;
+		}
+
+		source = new MemoryImageSource(imageBuffer);
+	}
+	///
+
+	TileCacheHeader header;
+
+	memset(&header, 0, sizeof(header));
+
+	if (!TileCache::getSourceIdentity(imageFilename, header.sourceBytes, header.sourceModified, header.imagesDigest))
+	{
+		cout << "Error, can not stat " << imageFilename << endl;
+		return 1;
+	}
+
+	/// pyramid layout, geometry does not matter here
+	size_t width, height, baseRows, baseCols;
+
+	source->getDimension(width, height);
+
+	TilePyramid::getBaseGrid(width, height, tileTexSize, baseRows, baseCols);
+
+	TilePyramid pyramid;
+
+	pyramid.build(baseRows, baseCols, glm::vec3((float)tileTexSize, (float)tileTexSize, 0.0f), 1.0f, tileTexSize);
+	///
+
+	header.imageWidth = (uint32_t)width;
+	header.imageHeight = (uint32_t)height;
+	header.bytesPerPixel = (uint32_t)source->getBytesPerPixel();
+	header.tileTexSize = (uint32_t)tileTexSize;
+	header.pixelFormat = TileCacheHeader::getPixelFormat(compression);
+	header.baseRows = (uint32_t)baseRows;
+	header.baseCols = (uint32_t)baseCols;
+	header.levelCount = (uint32_t)pyramid.getLevelCount();
+	header.nodeCount = pyramid.getNodeCount();
+
+	TileCacheWriter writer;
+
+	if (!writer.create(cacheFilename, header))
+		return 1;
+
+	/// tiles come out of the row sweep in upload order, the writer puts them in any order
+	JobSystem				jobSystem;
+	vector<unsigned char>	rootPixels;
+	size_t					tileBytes = compression == TILE_COMPRESSION_NONE ? source->getRegionSize(tileTexSize, tileTexSize)
+																			 : BlockCompressor::getCompressedSize(tileTexSize, tileTexSize, compression);
+	vector<unsigned char>	blocks(compression == TILE_COMPRESSION_NONE ? 0 : tileBytes);
+
+	auto writeTile = [&](size_t node, const unsigned char* pixels)
+	{
+		const TilePyramidNode& tileNode = pyramid.getNode(node);
+
+		if (compression != TILE_COMPRESSION_NONE)
+		{
+			BlockCompressor::compress(pixels, tileTexSize, tileTexSize, source->getBytesPerPixel(), compression,
+									  renderSettings.tileCompressionQuality, blocks.data(), &jobSystem);
+			pixels = blocks.data();
+		}
+
+		return writer.writeTile(node, (uint32_t)tileNode.level, (uint32_t)tileNode.row, (uint32_t)tileNode.col, pixels, tileBytes);
+	};
+
+	source->setSequential(true); // one sweep, top down
+
+	bool completed = pyramid.generatePixels(*source, writeTile, rootPixels, &jobSystem) && writer.finish();
+	///
+
+	if (!completed)
+		writer.abort();
+
+	delete source;
+
+	if (imageBuffer)
+		delete imageBuffer;
+
+	return completed ? 0 : 1;
+}
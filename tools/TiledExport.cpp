@@ -0,0 +1,56 @@
+/// renders the home view of a scene headless at any resolution into a tiled BigTIFF
+///		usage: TiledExport <image> <output.tif> [width] [height] [ortho|perspective] [name=value ...]
+///		- name=value arguments set RenderSettings, e.g. exportTileSize=2048, exportSettleSeconds=30,
+///		  tileTextureBudgetBytes=1073741824, tileCompression=none
+///		- no display or gpu needed, runs on llvmpipe through egl (or osmesa)
+///		- the output is rendered square by square, memory holds one row of squares, see
+///		  GLApplication::exportView()
+///
+#include "Application.h"
+
+#include <cstdlib>
+
+int main(int argc, char** argv)
+{
+	/// name=value arguments go to the settings, the others are the positional ones
+	RenderSettings	renderSettings;
+	vector<string>	args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+
+		if (arg.find('=') == string::npos)
+			args.push_back(arg);
+		else if (!renderSettings.set(arg))
+		{
+			cout << "Error, unknown render setting " << arg << endl;
+			return 1;
+		}
+	}
+	///
+
+	if (args.size() < 2)
+	{
+		cout << "usage: " << argv[0] << " <image> <output.tif> [width] [height] [ortho|perspective] [name=value ...]" << endl;
+		return 1;
+	}
+
+	string	imageFilename = args[0];
+	string	outputFilename = args[1];
+	size_t	width = args.size() > 2 ? (size_t)atoi(args[2].c_str()) : 8192;
+	size_t	height = args.size() > 3 ? (size_t)atoi(args[3].c_str()) : width;
+	bool	perspective = args.size() > 4 && args[4] == "perspective";
+
+	/// the window is never shown, the export has its own size
+	GLApplication application("TiledExport", 0, 0, 1024, 1024, true);
+
+	application.setRenderSettings(renderSettings);
+	application.buildScene(imageFilename);
+	application.gotoHomePositionAndView();
+
+	if (perspective)
+		application.handleKey(GLFW_KEY_SPACE); // the projection switch
+
+	return application.exportView(outputFilename, width, height) ? 0 : 1;
+}